@@ -0,0 +1,81 @@
+#pragma once
+
+#include <stdint.h>
+
+// Аналоговое задание скорости: медиана по окну + IIR в фиксированной
+// точке, мёртвые зоны на краях шкалы и гистерезис на выходе.
+// Выход меняется только когда фильтрованное значение ушло от
+// принятого дальше, чем на hyst, — шум АЦП не вызывает перепланирования.
+
+#define AIN_MEDIAN 5
+#define AIN_FULL   4095
+
+struct AinParams {
+  uint8_t  iirShift;   // alpha = 1 / 2^iirShift
+  uint16_t deadband;   // отсчёты у 0 и у полной шкалы
+  uint16_t hyst;       // отсчёты
+  uint32_t fMin;       // Гц при 0
+  uint32_t fMax;       // Гц при полной шкале
+};
+
+struct AinFilter {
+  uint16_t win[AIN_MEDIAN];
+  uint8_t  winN;
+  int32_t  acc;        // Q16
+  bool     primed;
+  uint16_t held;       // принятое значение, отсчёты
+  bool     heldValid;
+};
+
+static inline void ainReset(AinFilter& f) {
+  f.winN = 0;
+  f.acc = 0;
+  f.primed = false;
+  f.held = 0;
+  f.heldValid = false;
+}
+
+static inline uint16_t ainMedian(const uint16_t* v) {
+  uint16_t t[AIN_MEDIAN];
+  for (uint8_t i = 0; i < AIN_MEDIAN; i++) {
+    uint16_t x = v[i];
+    int8_t j = i - 1;
+    while (j >= 0 && t[j] > x) { t[j + 1] = t[j]; j--; }
+    t[j + 1] = x;
+  }
+  return t[AIN_MEDIAN / 2];
+}
+
+static inline uint16_t ainValue(const AinFilter& f) {
+  return (uint16_t)((f.acc + 32768) >> 16);
+}
+
+// Один отсчёт АЦП. true — принятое значение изменилось.
+static inline bool ainPush(AinFilter& f, const AinParams& p, uint16_t raw) {
+  f.win[f.winN++] = raw;
+  if (f.winN < AIN_MEDIAN) return false;
+  f.winN = 0;
+
+  int32_t m = (int32_t)ainMedian(f.win) << 16;
+  if (!f.primed) { f.acc = m; f.primed = true; }
+  else f.acc += (m - f.acc) >> p.iirShift;
+
+  uint16_t v = ainValue(f);
+  if (v <= p.deadband) v = 0;
+  else if (v >= AIN_FULL - p.deadband) v = AIN_FULL;
+
+  if (f.heldValid) {
+    uint16_t d = (v > f.held) ? (v - f.held) : (f.held - v);
+    // края шкалы принимаем сразу, иначе до них не дойти через гистерезис
+    bool edge = (v == 0 || v == AIN_FULL) && v != f.held;
+    if (d <= p.hyst && !edge) return false;
+  }
+  f.held = v;
+  f.heldValid = true;
+  return true;
+}
+
+static inline uint32_t ainFreq(const AinFilter& f, const AinParams& p) {
+  if (p.fMax <= p.fMin) return p.fMin;
+  return p.fMin + (uint32_t)((uint64_t)(p.fMax - p.fMin) * f.held / AIN_FULL);
+}
@@ -0,0 +1,162 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <math.h>
+#include <float.h>
+
+// Круговая (и винтовая с третьей осью) интерполяция, как G2/G3:
+// старт в (0,0,0), конец (x,y,z) и центр (i,j) относительно старта,
+// всё в шагах. Дуга режется на хорды равной длины так, чтобы стрелка
+// прогиба хорды r*(1 - cos(θ/2)) не превышала tol; ось Z делится
+// пропорционально углу. Конец приходит в целых шагах и лежит на
+// радиусе чуть другом, чем старт, — радиус тоже ведётся линейно по углу,
+// чтобы последняя хорда не ломалась. Позицию на пути s (0..len) даёт arcEval() —
+// точка на текущей хорде, так что планировщик получает те же отрезки,
+// что прислал бы хост, только без передачи каждого.
+//
+// Плата ведёт одну ось: каждая берёт из дуги свою координату
+// (ARC_AXIS в main.cpp), общая команда и одновременный старт
+// дают согласованное движение.
+//
+// Геометрия считается во float: на радиусах до 10^5 шагов ошибка
+// округления — сотые доли шага. Она вычитается из допуска при выборе
+// числа хорд (arcFloatErr), так что стрелка с ней вместе не больше tol;
+// допуск меньше этой ошибки (0.05 шага на радиусе 10^5) — дуга не
+// принимается.
+
+#define ARC_MAX_SEG   100000
+#define ARC_END_TOL   2.0f     // шагов: расхождение радиусов старта и конца
+
+enum ArcAxis : uint8_t { ARC_X, ARC_Y, ARC_Z };
+
+struct Arc {
+  float    cx, cy;     // центр
+  float    r;          // радиус старта
+  float    dr;         // радиус конца минус радиус старта
+  float    a0;         // угол старта относительно центра, рад
+  float    sweep;      // рад, > 0 — против часовой
+  float    z;          // подъём винта на всю дугу
+  float    ex, ey;     // конец
+  uint32_t n;          // хорд
+  float    seg;        // длина хорды (с учётом Z)
+  float    len;        // длина пути
+};
+
+// Допустимый угол хорды для радиуса r и стрелки tol.
+static inline float arcChordAngle(float r, float tol) {
+  if (tol >= r) return (float)M_PI;
+  return 2.0f * acosf(1.0f - tol / r);
+}
+
+// Ошибка округления вершины во float: пара ulp самой большой координаты.
+static inline float arcFloatErr(float cx, float cy, float r) {
+  return 4.0f * FLT_EPSILON * (fmaxf(fabsf(cx), fabsf(cy)) + r);
+}
+
+// Проверяет геометрию и режет дугу. Совпадение конца со стартом — полный круг.
+static inline bool arcPrepare(Arc& a, float x, float y, float z, float i, float j, bool cw, float tol) {
+  float r0 = hypotf(i, j);
+  float r1 = hypotf(x - i, y - j);
+  if (r0 < 1.0f || fabsf(r0 - r1) > ARC_END_TOL || !(tol > 0)) return false;
+
+  a.cx = i;
+  a.cy = j;
+  a.r = r0;
+  a.dr = r1 - r0;
+  a.z = z;
+  a.ex = x;
+  a.ey = y;
+  a.a0 = atan2f(-j, -i);
+
+  float a1 = atan2f(y - j, x - i);
+  float sw = a1 - a.a0;
+  if (cw) {
+    if (sw >= 0) sw -= 2.0f * (float)M_PI;
+  } else {
+    if (sw <= 0) sw += 2.0f * (float)M_PI;
+  }
+  a.sweep = sw;
+
+  float tolChord = tol - arcFloatErr(i, j, fmaxf(r0, r1));
+  if (!(tolChord > 0)) return false;
+  float n = ceilf(fabsf(sw) / arcChordAngle(r0, tolChord));
+  if (n < 1) n = 1;
+  if (n > ARC_MAX_SEG) return false;
+  a.n = (uint32_t)n;
+
+  float chord = 2.0f * r0 * sinf(fabsf(sw) / (2.0f * n));
+  float dz = z / n;
+  a.seg = sqrtf(chord * chord + dz * dz);
+  a.len = a.seg * n;
+  return a.len > 0;
+}
+
+// Вершина k (0..n). Последняя — точно заданный конец.
+static inline void arcVertex(const Arc& a, uint32_t k, float p[3]) {
+  if (k >= a.n) {
+    p[0] = a.ex;
+    p[1] = a.ey;
+    p[2] = a.z;
+    return;
+  }
+  float f = (float)k / a.n;
+  float t = a.a0 + a.sweep * f;
+  float r = a.r + a.dr * f;
+  p[0] = a.cx + r * cosf(t);
+  p[1] = a.cy + r * sinf(t);
+  p[2] = a.z * f;
+}
+
+// Точка на пути s (0..len) — на хорде, в которую попал s.
+static inline void arcEval(const Arc& a, float s, float p[3]) {
+  if (s <= 0) s = 0;
+  if (s >= a.len) {
+    arcVertex(a, a.n, p);
+    return;
+  }
+  float q = s / a.seg;
+  uint32_t k = (uint32_t)q;
+  if (k >= a.n) k = a.n - 1;
+  float f = q - k;
+
+  float v0[3], v1[3];
+  arcVertex(a, k, v0);
+  arcVertex(a, k + 1, v1);
+  for (int i = 0; i < 3; i++) p[i] = v0[i] + (v1[i] - v0[i]) * f;
+}
+
+// Подача вдоль пути: трапеция по скорости, торможение к концу дуги.
+struct ArcFeed {
+  float s;   // пройдено, шаги
+  float v;   // шаг/с
+};
+
+static inline void arcFeedTick(ArcFeed& f, float len, float feed, float accel, float dt) {
+  float left = len - f.s;
+  float vStop = sqrtf(2.0f * accel * (left > 0 ? left : 0));
+  float v = f.v + accel * dt;
+  if (v > feed) v = feed;
+  if (v > vStop) v = vStop;
+  if (v < accel * dt && left > 0) v = accel * dt;   // не застревать у самого конца
+  f.v = v;
+  f.s += v * dt;
+  if (f.s > len) f.s = len;
+}
+
+// "x y z i j cw|ccw" — всё в шагах.
+static inline bool arcParse(Arc& a, const char* s, float tol) {
+  char* e;
+  float v[5];
+  for (int k = 0; k < 5; k++) {
+    v[k] = strtof(s, &e);
+    if (e == s) return false;
+    s = e;
+  }
+  while (*s == ' ' || *s == '\t') s++;
+  bool cw;
+  if (s[0] == 'c' && s[1] == 'w') cw = true;
+  else if (s[0] == 'c' && s[1] == 'c' && s[2] == 'w') cw = false;
+  else return false;
+  return arcPrepare(a, v[0], v[1], v[2], v[3], v[4], cw, tol);
+}
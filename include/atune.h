@@ -0,0 +1,106 @@
+#pragma once
+
+#include <stdint.h>
+#include <math.h>
+
+// Подбор ускорения: серия ходов туда-обратно с растущим ускорением,
+// каждый ход проверяется по энкодеру (ошибка слежения не больше допуска
+// во время хода и после остановки). Рост — в growthPm/1000 раз до первого
+// срыва, затем несколько делений пополам между последним надёжным и
+// сорвавшимся значением. Итог — надёжное минус запас (marginPm), он ещё
+// раз проверяется reps ходами; срыв на проверке — подбор неудачен.
+//
+// Сорвалось уже исходное ускорение — тоже неудача: вниз не ищем,
+// исходное значение и так ненадёжно, разбираться надо руками.
+
+enum AtunePhase : uint8_t { AT_SEARCH, AT_BISECT, AT_VERIFY, AT_DONE, AT_FAIL };
+
+struct AtuneCfg {
+  uint32_t a0;         // первое ускорение, Гц/с (обычно текущее g_accel)
+  uint32_t aMax;
+  uint16_t growthPm;   // шаг роста, промилле (1250 = x1.25)
+  uint8_t  reps;       // ходов на одно значение
+  uint8_t  bisect;     // делений пополам после срыва
+  uint16_t marginPm;   // итог = надёжное * marginPm / 1000
+};
+
+struct Atune {
+  AtuneCfg c;
+  uint8_t  phase;
+  uint8_t  rep;
+  uint8_t  iter;
+  uint32_t accel;      // ускорение следующего хода
+  uint32_t lo;         // наибольшее надёжное (0 — ещё нет)
+  uint32_t hi;         // наименьшее сорвавшееся (0 — ещё нет)
+  uint32_t result;
+  uint16_t trials;
+};
+
+static inline void atuneBegin(Atune& t, const AtuneCfg& c) {
+  t.c = c;
+  t.phase = AT_SEARCH;
+  t.rep = 0;
+  t.iter = 0;
+  t.accel = c.a0;
+  t.lo = 0;
+  t.hi = 0;
+  t.result = 0;
+  t.trials = 0;
+}
+
+// Итог очередного хода. true — нужен ещё ход с ускорением t.accel,
+// false — подбор закончен (AT_DONE, итог в t.result, или AT_FAIL).
+static inline bool atuneNext(Atune& t, bool ok) {
+  t.trials++;
+
+  if (t.phase == AT_VERIFY) {
+    if (!ok) { t.phase = AT_FAIL; return false; }
+    if (++t.rep < t.c.reps) return true;
+    t.result = t.accel;
+    t.phase = AT_DONE;
+    return false;
+  }
+
+  if (ok && ++t.rep < t.c.reps) return true;
+  t.rep = 0;
+  if (ok) t.lo = t.accel;
+  else    t.hi = t.accel;
+
+  if (t.phase == AT_SEARCH) {
+    if (ok && t.accel < t.c.aMax) {
+      uint64_t a = (uint64_t)t.accel * t.c.growthPm / 1000;
+      if (a <= t.accel) a = t.accel + 1;
+      t.accel = a < t.c.aMax ? (uint32_t)a : t.c.aMax;
+      return true;
+    }
+    if (!t.lo) { t.phase = AT_FAIL; return false; }
+    t.phase = AT_BISECT;
+    t.iter = 0;
+  } else {
+    t.iter++;
+  }
+
+  // делим, пока интервал шире 1% и попытки не кончились
+  if (t.hi && t.iter < t.c.bisect && t.hi - t.lo > t.lo / 100) {
+    t.accel = t.lo + (t.hi - t.lo) / 2;
+    return true;
+  }
+
+  uint32_t a = (uint32_t)((uint64_t)t.lo * t.c.marginPm / 1000);
+  t.accel = a ? a : 1;
+  t.phase = AT_VERIFY;
+  return true;
+}
+
+// Ошибка слежения, шаги: энкодер (enc отсчётов, num отсчётов на den шагов)
+// против заданной позиции.
+static inline int32_t atuneErr(int32_t enc, int32_t steps, int32_t num, int32_t den) {
+  return (int32_t)((int64_t)enc * den / num) - steps;
+}
+
+// Время хода dist шагов трапецией (треугольником) v, a; мкс.
+static inline uint32_t atuneMoveUs(uint32_t dist, uint32_t v, uint32_t a) {
+  float d = (float)dist, fv = (float)v, fa = (float)a;
+  float s = (d * fa >= fv * fv) ? d / fv + fv / fa : 2.0f * sqrtf(d / fa);
+  return (uint32_t)(s * 1e6f);
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdlib.h>
+
+// Электронный кулачок: таблица master -> slave.
+// Точки m[] строго возрастают, m[0] = 0, m[n-1] = период мастера.
+// Таблица циклическая: за каждый период slave смещается на s[n-1] - s[0]
+// (0 для возвратного кулачка, != 0 для вращательного профиля).
+// Интерполяция линейная, наклон сегмента хранится в Q16, так что
+// вычисление в StepTask обходится без деления. Проверка против
+// идеальной кривой — tools/cam_check.cpp.
+
+#define CAM_MAX_POINTS 64
+#define CAM_MAX_SEG    65535   // длина сегмента по мастеру; ошибка Q16 < 1 шага
+
+struct CamTable {
+  uint16_t n;
+  int32_t  m[CAM_MAX_POINTS];
+  int32_t  s[CAM_MAX_POINTS];
+  int32_t  k[CAM_MAX_POINTS];  // наклон сегмента i..i+1, Q16
+};
+
+static inline int32_t camPeriod(const CamTable& t) {
+  return t.n ? t.m[t.n - 1] : 0;
+}
+
+// Проверяет точки и считает наклоны. false — таблица непригодна.
+static inline bool camPrepare(CamTable& t) {
+  if (t.n < 2 || t.n > CAM_MAX_POINTS) return false;
+  if (t.m[0] != 0) return false;
+
+  for (uint16_t i = 0; i + 1 < t.n; i++) {
+    int32_t dm = t.m[i + 1] - t.m[i];
+    if (dm <= 0 || dm > CAM_MAX_SEG) return false;
+    // с округлением: ошибка наклона на сегменте не больше полушага
+    int64_t ds = (int64_t)t.s[i + 1] - t.s[i];
+    int64_t num = ds * 65536;
+    t.k[i] = (int32_t)((num + (num < 0 ? -dm / 2 : dm / 2)) / dm);
+  }
+  t.k[t.n - 1] = 0;
+  return true;
+}
+
+// Разбор "m:s,m:s,..." (разделители — ',' ';' или пробел).
+static inline bool camParse(CamTable& t, const char* p) {
+  t.n = 0;
+  while (*p) {
+    while (*p == ' ' || *p == ',' || *p == ';' || *p == '\t') p++;
+    if (!*p) break;
+    if (t.n >= CAM_MAX_POINTS) return false;
+
+    char* e;
+    long m = strtol(p, &e, 10);
+    if (e == p || *e != ':') return false;
+    p = e + 1;
+    long s = strtol(p, &e, 10);
+    if (e == p) return false;
+    p = e;
+
+    t.m[t.n] = (int32_t)m;
+    t.s[t.n] = (int32_t)s;
+    t.n++;
+  }
+  return camPrepare(t);
+}
+
+// Позиция slave для позиции мастера x (относительно начала профиля).
+// x — 64 бита: за часы работы на десятках кГц путь мастера выходит за
+// int32, а период не обязан быть степенью двойки.
+static inline int32_t camEval(const CamTable& t, int64_t x) {
+  int32_t period = camPeriod(t);
+  if (period <= 0) return 0;
+
+  int64_t cyc = x / period;
+  int32_t r = (int32_t)(x - cyc * period);
+  if (r < 0) { r += period; cyc--; }
+
+  uint16_t lo = 0, hi = t.n - 1;
+  while (hi - lo > 1) {
+    uint16_t mid = (lo + hi) / 2;
+    if (t.m[mid] <= r) lo = mid; else hi = mid;
+  }
+
+  int64_t y = (int64_t)t.k[lo] * (r - t.m[lo]);
+  int32_t s = t.s[lo] + (int32_t)((y + 32768) >> 16);
+  return (int32_t)(s + cyc * (t.s[t.n - 1] - t.s[0]));
+}
+
+// Путь мастера от начала профиля по 32-битному счётчику (PCNT,
+// виртуальная ось): берутся только приращения, так что переполнение
+// счётчика пути не ломает.
+struct CamMasterPath {
+  int32_t last;
+  int64_t x;
+};
+
+static inline void camMasterStart(CamMasterPath& m, int32_t cnt) {
+  m.last = cnt;
+  m.x = 0;
+}
+
+static inline int64_t camMasterUpdate(CamMasterPath& m, int32_t cnt) {
+  m.x += (int32_t)((uint32_t)cnt - (uint32_t)m.last);
+  m.last = cnt;
+  return m.x;
+}
+
+// Виртуальный мастер: позиция в Q16, шаг интегрирования фиксированный.
+// Остаток деления переносится в следующий тик — без дрейфа на малых
+// скоростях.
+struct CamVirtualAxis {
+  int64_t pos_q16;
+  int32_t rate;      // отсчётов/с, со знаком
+  int64_t rem;       // остаток, Q16 * мкс
+};
+
+static inline void camVirtualTick(CamVirtualAxis& v, uint32_t dt_us) {
+  int64_t n = (int64_t)v.rate * dt_us * 65536 + v.rem;
+  int64_t d = n / 1000000;
+  v.rem = n - d * 1000000;
+  v.pos_q16 += d;
+}
+
+static inline int32_t camVirtualPos(const CamVirtualAxis& v) {
+  return (int32_t)(v.pos_q16 >> 16);
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <stdint.h>
+
+// Протокол управления по CAN (11-битные ID, все числа little-endian).
+// Без зависимостей от TWAI/Arduino: тот же код собирается на Linux
+// и гоняется через SocketCAN (vcan0), см. tools/can_ctl.cpp.
+//
+//   0x080          SYNC      [0] счётчик (опц.) — все узлы сразу шлют STATUS
+//   0x180 + node   STATUS    [0] флаги CAN_ST_*, [1..3] freq u24, [4..7] pos i32
+//   0x200 + node   SETPOINT  [0..3] freq Гц, [4..7] accel Гц/с (опц., dlc 8)
+//   0x300 + node   CONTROL   [0] CanOp, [1..4] a u32, [5..6] b u16
+
+#define CAN_ID_SYNC      0x080
+#define CAN_ID_STATUS    0x180
+#define CAN_ID_SETPOINT  0x200
+#define CAN_ID_CONTROL   0x300
+#define CAN_NODE_MASK    0x7F
+
+#define CAN_ST_RUNREQ   0x01
+#define CAN_ST_RUNNING  0x02
+#define CAN_ST_DIR      0x04
+#define CAN_ST_EN       0x08
+#define CAN_ST_ALARM    0x10
+
+struct CanFrame {
+  uint32_t id;
+  uint8_t  dlc;
+  uint8_t  data[8];
+};
+
+enum CanOp : uint8_t {
+  CAN_OP_STOP,
+  CAN_OP_START,
+  CAN_OP_DIR,     // a = 0/1
+  CAN_OP_EN,      // a = 0/1
+  CAN_OP_RAMP,    // a = Гц, b = мс
+  CAN_OP_RATE,    // a = период STATUS, мс (0 — только по SYNC)
+};
+
+enum CanReqKind : uint8_t { CAN_REQ_NONE, CAN_REQ_SYNC, CAN_REQ_SETPOINT, CAN_REQ_CONTROL };
+
+struct CanReq {
+  uint8_t  kind;
+  uint8_t  op;
+  uint32_t a;
+  uint32_t b;
+};
+
+struct CanStatus {
+  uint8_t  flags;
+  uint32_t freq;
+  int32_t  pos;
+};
+
+static inline void canPut32(uint8_t* p, uint32_t v) {
+  p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8); p[2] = (uint8_t)(v >> 16); p[3] = (uint8_t)(v >> 24);
+}
+
+static inline uint32_t canGet32(const uint8_t* p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline void canEncodeSync(CanFrame& f, uint8_t cnt) {
+  f.id = CAN_ID_SYNC;
+  f.dlc = 1;
+  f.data[0] = cnt;
+}
+
+static inline void canEncodeStatus(CanFrame& f, uint8_t node, const CanStatus& s) {
+  uint32_t fr = s.freq > 0xFFFFFF ? 0xFFFFFF : s.freq;
+  f.id = CAN_ID_STATUS + (node & CAN_NODE_MASK);
+  f.dlc = 8;
+  f.data[0] = s.flags;
+  f.data[1] = (uint8_t)fr; f.data[2] = (uint8_t)(fr >> 8); f.data[3] = (uint8_t)(fr >> 16);
+  canPut32(&f.data[4], (uint32_t)s.pos);
+}
+
+static inline bool canDecodeStatus(const CanFrame& f, uint8_t& node, CanStatus& s) {
+  if ((f.id & ~CAN_NODE_MASK) != CAN_ID_STATUS || f.dlc < 8) return false;
+  node = f.id & CAN_NODE_MASK;
+  s.flags = f.data[0];
+  s.freq = (uint32_t)f.data[1] | ((uint32_t)f.data[2] << 8) | ((uint32_t)f.data[3] << 16);
+  s.pos = (int32_t)canGet32(&f.data[4]);
+  return true;
+}
+
+static inline void canEncodeSetpoint(CanFrame& f, uint8_t node, uint32_t hz, uint32_t acc) {
+  f.id = CAN_ID_SETPOINT + (node & CAN_NODE_MASK);
+  canPut32(&f.data[0], hz);
+  if (acc) { canPut32(&f.data[4], acc); f.dlc = 8; }
+  else f.dlc = 4;
+}
+
+static inline void canEncodeControl(CanFrame& f, uint8_t node, uint8_t op, uint32_t a, uint16_t b) {
+  f.id = CAN_ID_CONTROL + (node & CAN_NODE_MASK);
+  f.dlc = 7;
+  f.data[0] = op;
+  canPut32(&f.data[1], a);
+  f.data[5] = (uint8_t)b; f.data[6] = (uint8_t)(b >> 8);
+}
+
+// Разбор входящего кадра для узла node. false — кадр не наш или битый.
+static inline bool canDecode(const CanFrame& f, uint8_t node, CanReq& r) {
+  r.kind = CAN_REQ_NONE;
+  r.op = 0; r.a = 0; r.b = 0;
+
+  if (f.id == CAN_ID_SYNC) {
+    r.kind = CAN_REQ_SYNC;
+    r.a = f.dlc ? f.data[0] : 0;
+    return true;
+  }
+  if ((f.id & CAN_NODE_MASK) != (node & CAN_NODE_MASK)) return false;
+
+  switch (f.id & ~CAN_NODE_MASK) {
+    case CAN_ID_SETPOINT:
+      if (f.dlc < 4) return false;
+      r.kind = CAN_REQ_SETPOINT;
+      r.a = canGet32(&f.data[0]);
+      r.b = (f.dlc >= 8) ? canGet32(&f.data[4]) : 0;
+      return true;
+
+    case CAN_ID_CONTROL:
+      if (f.dlc < 1 || f.data[0] > CAN_OP_RATE) return false;
+      r.kind = CAN_REQ_CONTROL;
+      r.op = f.data[0];
+      r.a = (f.dlc >= 5) ? canGet32(&f.data[1]) : 0;
+      r.b = (f.dlc >= 7) ? ((uint32_t)f.data[5] | ((uint32_t)f.data[6] << 8)) : 0;
+      return true;
+  }
+  return false;
+}
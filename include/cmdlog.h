@@ -0,0 +1,108 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Журнал последних CMDLOG_N команд, пришедших по HTTP. Каждая получает
+// порядковый номер (seq); StepTask отмечает в журнале, чем кончилось
+// применение. Клиент может передать свой id запроса (rid): повтор той же
+// команды (тип и аргумент) с тем же rid, пока запись в окне, не ставится
+// в очередь второй раз, а получает результат первой попытки. Один запрос
+// может дать несколько команд — у каждой своя запись под тем же rid.
+// Потерянная (очередь была полна) повтор не отвечает — команда ставится
+// заново. Хранится хэш rid (FNV-1a) — в окне из 32 записей совпадение
+// случайных id практически исключено. Проверка — tools/cmdlog_check.cpp.
+//
+// Синхронизация — у вызывающего (пишут WebTask и StepTask).
+
+#ifndef CMDLOG_N
+#define CMDLOG_N 32
+#endif
+
+enum CmdSt : uint8_t {
+  CMD_ST_NONE,
+  CMD_ST_QUEUED,     // в очереди, StepTask ещё не дошёл
+  CMD_ST_DONE,       // применена
+  CMD_ST_REFUSED,    // StepTask отказал (авария, выключен драйвер, занят другим режимом)
+  CMD_ST_LOST        // очередь была полна — не выполнялась
+};
+
+struct CmdRec {
+  uint32_t seq;
+  uint32_t rid;      // 0 — без id
+  uint32_t arg;      // Cmd.a — вместе с type отличает команды одного запроса
+  uint8_t  type;
+  uint8_t  st;
+};
+
+struct CmdLog {
+  CmdRec r[CMDLOG_N];
+  uint32_t seq;      // последний выданный
+  uint32_t dups;     // повторов, отвеченных из журнала
+};
+
+static inline const char* cmdStName(uint8_t st) {
+  switch (st) {
+    case CMD_ST_QUEUED:  return "queued";
+    case CMD_ST_DONE:    return "done";
+    case CMD_ST_REFUSED: return "refused";
+    case CMD_ST_LOST:    return "lost";
+    default:             return "none";
+  }
+}
+
+static inline uint32_t cmdRid(const char* s) {
+  uint32_t h = 2166136261u;
+  while (*s) h = (h ^ (uint8_t)*s++) * 16777619u;
+  return h ? h : 1;
+}
+
+static inline CmdRec* cmdlogBySeq(CmdLog& l, uint32_t seq) {
+  CmdRec& r = l.r[seq % CMDLOG_N];
+  return (seq && r.seq == seq) ? &r : nullptr;
+}
+
+// Самая свежая запись с этим rid.
+static inline CmdRec* cmdlogByRid(CmdLog& l, uint32_t rid) {
+  if (!rid) return nullptr;
+  for (uint32_t i = 0; i < CMDLOG_N && i < l.seq; i++) {
+    CmdRec* r = cmdlogBySeq(l, l.seq - i);
+    if (r && r->rid == rid) return r;
+  }
+  return nullptr;
+}
+
+// Самая свежая запись той же команды с этим rid.
+static inline CmdRec* cmdlogFind(CmdLog& l, uint32_t rid, uint8_t type, uint32_t arg) {
+  if (!rid) return nullptr;
+  for (uint32_t i = 0; i < CMDLOG_N && i < l.seq; i++) {
+    CmdRec* r = cmdlogBySeq(l, l.seq - i);
+    if (r && r->rid == rid && r->type == type && r->arg == arg) return r;
+  }
+  return nullptr;
+}
+
+// Новая запись на место самой старой.
+static inline CmdRec& cmdlogAdd(CmdLog& l, uint32_t rid, uint8_t type, uint32_t arg) {
+  if (!++l.seq) l.seq = 1;
+  CmdRec& r = l.r[l.seq % CMDLOG_N];
+  r.seq = l.seq;
+  r.rid = rid;
+  r.arg = arg;
+  r.type = type;
+  r.st = CMD_ST_QUEUED;
+  return r;
+}
+
+// Запись под команду. true — повтор: в out результат первой попытки,
+// ставить в очередь не нужно. false — в out новая запись (QUEUED).
+static inline bool cmdlogClaim(CmdLog& l, uint32_t rid, uint8_t type, uint32_t arg, CmdRec& out) {
+  CmdRec* old = cmdlogFind(l, rid, type, arg);
+  if (old && old->st != CMD_ST_LOST) {
+    out = *old;
+    l.dups++;
+    return true;
+  }
+  out = cmdlogAdd(l, rid, type, arg);
+  return false;
+}
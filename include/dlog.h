@@ -0,0 +1,269 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+#include <atomic>
+
+// Отложенный лог: место вызова кладёт в кольцо только адрес строки
+// формата (он же её id — строка лежит во флеше, текст достаётся по ELF),
+// метку времени и сырые аргументы. Форматирования на устройстве нет.
+// Кольцо — слова по 32 бита, много писателей (задачи обоих ядер,
+// прерывания) и один читатель, без блокировок: место резервируется CAS
+// по head, заголовок записи пишется последним с флагом готовности.
+// Места нет — запись теряется и считается, писатель никогда не ждёт.
+//
+// Аргументы: целые до 32 бит — 4 байта, 64-битные — 8, float/double —
+// double, строки — копия (байт длины + до DLOG_STR байт). Разбор — по
+// той же строке формата (dlogFormat), поэтому размер %ld задаётся
+// размером long на устройстве.
+//
+// Уровни отсекаются при компиляции (LOG_LEVEL): выключенный LOGx —
+// пустой оператор, аргументы не вычисляются.
+
+#define LOG_L_NONE  0
+#define LOG_L_ERR   1
+#define LOG_L_WARN  2
+#define LOG_L_INFO  3
+#define LOG_L_DEBUG 4
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_L_INFO
+#endif
+
+#ifndef DLOG_WORDS
+#define DLOG_WORDS 1024          // размер кольца, слов (степень двойки)
+#endif
+#define DLOG_MAX    64           // байт аргументов на запись
+#define DLOG_STR    40           // байт строки-аргумента, дальше обрезается
+#define DLOG_PTRW   ((sizeof(void*) + 3) / 4)
+#define DLOG_HDRW   (2 + DLOG_PTRW)                 // заголовок, время, адрес формата
+#define DLOG_RECW   (DLOG_HDRW + (DLOG_MAX + 3) / 4)
+#define DLOG_READY  0x80000000u
+
+struct Dlog {
+  std::atomic<uint32_t> w[DLOG_WORDS];
+  std::atomic<uint32_t> head;
+  std::atomic<uint32_t> tail;
+  std::atomic<uint32_t> drops;
+  std::atomic<uint32_t> puts;
+};
+
+struct DlogArgs {
+  uint8_t  b[DLOG_MAX];
+  uint32_t n;
+};
+
+// Не влезло — аргумент пропускается, разбор покажет его пустым.
+static inline void dlogBytes(DlogArgs& a, const void* p, uint32_t n) {
+  if (a.n + n > DLOG_MAX) return;
+  memcpy(a.b + a.n, p, n);
+  a.n += n;
+}
+
+// Целые — по размеру типа (младшие байты, little-endian), короче int — как int.
+static inline void dlogInt(DlogArgs& a, uint64_t v, uint32_t size) {
+  dlogBytes(a, &v, size < 4 ? 4 : size);
+}
+
+static inline void dlogArg(DlogArgs& a, int v)                { dlogInt(a, (uint64_t)(int64_t)v, sizeof(v)); }
+static inline void dlogArg(DlogArgs& a, unsigned v)           { dlogInt(a, v, sizeof(v)); }
+static inline void dlogArg(DlogArgs& a, long v)               { dlogInt(a, (uint64_t)(int64_t)v, sizeof(v)); }
+static inline void dlogArg(DlogArgs& a, unsigned long v)      { dlogInt(a, v, sizeof(v)); }
+static inline void dlogArg(DlogArgs& a, long long v)          { dlogInt(a, (uint64_t)v, 8); }
+static inline void dlogArg(DlogArgs& a, unsigned long long v) { dlogInt(a, v, 8); }
+static inline void dlogArg(DlogArgs& a, double v)             { dlogBytes(a, &v, 8); }
+static inline void dlogArg(DlogArgs& a, float v)              { dlogArg(a, (double)v); }
+static inline void dlogArg(DlogArgs& a, const void* p) { uintptr_t v = (uintptr_t)p; dlogBytes(a, &v, sizeof(v)); }
+
+static inline void dlogArg(DlogArgs& a, const char* s) {
+  if (!s) s = "(null)";
+  size_t len = strlen(s);
+  uint8_t n = (uint8_t)(len < DLOG_STR ? len : DLOG_STR);
+  dlogBytes(a, &n, 1);
+  dlogBytes(a, s, n);
+}
+static inline void dlogArg(DlogArgs& a, char* s) { dlogArg(a, (const char*)s); }
+
+static inline void dlogPack(DlogArgs&) {}
+
+template <typename T, typename... Rest>
+static inline void dlogPack(DlogArgs& a, T v, Rest... rest) {
+  dlogArg(a, v);
+  dlogPack(a, rest...);
+}
+
+// Запись в кольцо. false — места нет (запись потеряна).
+static inline bool dlogPut(Dlog& q, uint8_t level, uint32_t us, const char* fmt, const DlogArgs& a) {
+  uint32_t words = DLOG_HDRW + (a.n + 3) / 4;
+  uint32_t h = q.head.load(std::memory_order_relaxed);
+  do {
+    if (h + words - q.tail.load(std::memory_order_acquire) > DLOG_WORDS) {
+      q.drops.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+  } while (!q.head.compare_exchange_weak(h, h + words, std::memory_order_acq_rel, std::memory_order_relaxed));
+
+  const uint32_t m = DLOG_WORDS - 1;
+  uintptr_t f = (uintptr_t)fmt;
+  q.w[(h + 1) & m].store(us, std::memory_order_relaxed);
+  for (uint32_t i = 0; i < DLOG_PTRW; i++) q.w[(h + 2 + i) & m].store((uint32_t)((uint64_t)f >> (32 * i)), std::memory_order_relaxed);
+  for (uint32_t i = 0; i < (a.n + 3) / 4; i++) {
+    uint32_t v = 0;
+    memcpy(&v, a.b + i * 4, (a.n - i * 4) < 4 ? a.n - i * 4 : 4);
+    q.w[(h + DLOG_HDRW + i) & m].store(v, std::memory_order_relaxed);
+  }
+  q.w[h & m].store(DLOG_READY | ((uint32_t)level << 16) | words, std::memory_order_release);
+  q.puts.fetch_add(1, std::memory_order_relaxed);
+  return true;
+}
+
+template <typename... A>
+static inline void dlogWrite(Dlog& q, uint8_t level, uint32_t us, const char* fmt, A... args) {
+  DlogArgs a;
+  a.n = 0;
+  dlogPack(a, args...);
+  dlogPut(q, level, us, fmt, a);
+}
+
+// Следующая готовая запись целиком (слова как в кольце); 0 — нет готовых.
+// Только один читатель.
+static inline uint32_t dlogGet(Dlog& q, uint32_t* out) {
+  uint32_t t = q.tail.load(std::memory_order_relaxed);
+  if (t == q.head.load(std::memory_order_acquire)) return 0;
+
+  const uint32_t m = DLOG_WORDS - 1;
+  uint32_t hw = q.w[t & m].load(std::memory_order_acquire);
+  if (!(hw & DLOG_READY)) return 0;          // зарезервирована, ещё пишется
+  uint32_t words = hw & 0xFFFF;
+  out[0] = hw & ~DLOG_READY;
+  // освобождаемое место — нулями: иначе старое слово аргументов под
+  // будущим заголовком сошло бы за флаг готовности
+  for (uint32_t i = 1; i < words; i++) {
+    out[i] = q.w[(t + i) & m].load(std::memory_order_relaxed);
+    q.w[(t + i) & m].store(0, std::memory_order_relaxed);
+  }
+  q.w[t & m].store(0, std::memory_order_relaxed);
+  q.tail.store(t + words, std::memory_order_release);
+  return words;
+}
+
+static inline void dlogCheck(const char*, ...) __attribute__((format(printf, 1, 2)));
+static inline void dlogCheck(const char*, ...) {}
+
+// Проверка формата компилятором, сами аргументы в if (0) не вычисляются.
+#define DLOG_AT(lvl, fmt, ...) do { \
+    if (0) dlogCheck(fmt, ##__VA_ARGS__); \
+    dlogWrite(DLOG_Q, lvl, DLOG_NOW(), fmt, ##__VA_ARGS__); \
+  } while (0)
+
+#if LOG_LEVEL >= LOG_L_ERR
+#define LOGE(fmt, ...) DLOG_AT(LOG_L_ERR, fmt, ##__VA_ARGS__)
+#else
+#define LOGE(fmt, ...) do {} while (0)
+#endif
+#if LOG_LEVEL >= LOG_L_WARN
+#define LOGW(fmt, ...) DLOG_AT(LOG_L_WARN, fmt, ##__VA_ARGS__)
+#else
+#define LOGW(fmt, ...) do {} while (0)
+#endif
+#if LOG_LEVEL >= LOG_L_INFO
+#define LOGI(fmt, ...) DLOG_AT(LOG_L_INFO, fmt, ##__VA_ARGS__)
+#else
+#define LOGI(fmt, ...) do {} while (0)
+#endif
+#if LOG_LEVEL >= LOG_L_DEBUG
+#define LOGD(fmt, ...) DLOG_AT(LOG_L_DEBUG, fmt, ##__VA_ARGS__)
+#else
+#define LOGD(fmt, ...) do {} while (0)
+#endif
+
+// ---- разбор (хост) ----
+// Датаграмма: "DL", версия, 0, seq (4), потеряно на устройстве (4),
+// затем записи подряд, слова little-endian.
+#define DLOG_VER      1
+#define DLOG_PKT_HDR  12
+
+// Текст записи по строке формата и сырым аргументам. longSize — размер
+// long на устройстве (4 для ESP32). Возвращает длину текста.
+static inline size_t dlogFormat(const char* fmt, const uint8_t* p, uint32_t n, uint8_t longSize,
+                                char* out, size_t outN) {
+  size_t o = 0;
+  uint32_t k = 0;
+  auto put = [&](const char* s, size_t len) {
+    for (size_t i = 0; i < len && o + 1 < outN; i++) out[o++] = s[i];
+  };
+  // v — всегда 8 байт; нехватка аргументов (обрезанная запись) даёт 0
+  auto take = [&](void* v, uint32_t sz) {
+    memset(v, 0, 8);
+    if (k + sz > n) { k = n; return; }
+    memcpy(v, p + k, sz);
+    k += sz;
+  };
+
+  while (*fmt) {
+    if (*fmt != '%') { put(fmt++, 1); continue; }
+    if (fmt[1] == '%') { put("%", 1); fmt += 2; continue; }
+
+    // %[флаги][ширина][.точность][длина]тип
+    char spec[24];
+    size_t s = 0;
+    spec[s++] = *fmt++;
+    while (*fmt && strchr("-+ #0123456789.", *fmt) && s < 16) spec[s++] = *fmt++;
+    uint8_t lcount = 0;
+    while (*fmt == 'l' || *fmt == 'h' || *fmt == 'z' || *fmt == 'j' || *fmt == 't') {
+      if (*fmt == 'l') lcount++;
+      else if (*fmt == 'j') lcount = 2;
+      fmt++;
+    }
+    char conv = *fmt ? *fmt++ : 0;
+    char buf[64];
+    int len = 0;
+
+    uint32_t isz = lcount >= 2 ? 8 : lcount == 1 ? longSize : 4;
+    if (conv == 'd' || conv == 'i') {
+      int64_t v = 0;
+      take(&v, isz);
+      if (isz == 4) v = (int32_t)v;
+      spec[s++] = 'l'; spec[s++] = 'l'; spec[s++] = conv; spec[s] = 0;
+      len = snprintf(buf, sizeof(buf), spec, (long long)v);
+    } else if (conv == 'u' || conv == 'x' || conv == 'X' || conv == 'o') {
+      uint64_t v = 0;
+      take(&v, isz);
+      spec[s++] = 'l'; spec[s++] = 'l'; spec[s++] = conv; spec[s] = 0;
+      len = snprintf(buf, sizeof(buf), spec, (unsigned long long)v);
+    } else if (conv == 'c') {
+      int64_t v = 0;
+      take(&v, 4);
+      spec[s++] = 'c'; spec[s] = 0;
+      len = snprintf(buf, sizeof(buf), spec, (int)v);
+    } else if (conv == 'f' || conv == 'F' || conv == 'e' || conv == 'E' || conv == 'g' || conv == 'G') {
+      double v = 0;
+      take(&v, 8);
+      spec[s++] = conv; spec[s] = 0;
+      len = snprintf(buf, sizeof(buf), spec, v);
+    } else if (conv == 'p') {
+      uint64_t v = 0;
+      take(&v, longSize);
+      len = snprintf(buf, sizeof(buf), "0x%llx", (unsigned long long)v);
+    } else if (conv == 's') {
+      uint8_t sl = 0;
+      char str[DLOG_STR + 1] = "";
+      if (k < n) {
+        sl = p[k++];
+        if (k + sl > n) sl = (uint8_t)(n - k);
+        memcpy(str, p + k, sl);
+        str[sl] = 0;
+        k += sl;
+      }
+      spec[s++] = 's'; spec[s] = 0;
+      len = snprintf(buf, sizeof(buf), spec, str);
+    } else {
+      len = snprintf(buf, sizeof(buf), "<%%%c?>", conv ? conv : '?');
+    }
+    if (len > 0) put(buf, (size_t)len < sizeof(buf) ? (size_t)len : sizeof(buf) - 1);
+  }
+  out[o < outN ? o : outN - 1] = 0;
+  return o;
+}
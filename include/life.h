@@ -0,0 +1,127 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Счётчики наработки для обслуживания: шаги, время в движении, смены
+// направления, пиковая скорость (по оси) и аварии, загрузки. Копятся в
+// RAM: lifeTick() на каждом проходе StepTask берёт приращение позиции,
+// без прерываний и без счёта отдельных шагов. В NVS пишутся одним
+// блобом не чаще lifeFlushPeriodS() — период выводится из ресурса
+// флеша, чтобы за LIFE_YEARS раздел nvs не израсходовал больше
+// 1/LIFE_MARGIN циклов стирания. Проверка и расчёт — tools/life_check.cpp.
+
+#ifndef LIFE_AXES
+#define LIFE_AXES 1
+#endif
+
+#ifndef LIFE_NVS_BYTES
+#define LIFE_NVS_BYTES 0x5000      // раздел nvs в partitions.csv
+#endif
+#ifndef LIFE_YEARS
+#define LIFE_YEARS 20
+#endif
+#ifndef LIFE_CYCLES
+#define LIFE_CYCLES 100000         // стираний сектора по паспорту флеша
+#endif
+#ifndef LIFE_MARGIN
+#define LIFE_MARGIN 4              // остальным пользователям NVS и сборке мусора
+#endif
+
+#define LIFE_MAGIC 0x4C46u         // "LF"
+#define LIFE_VER   1
+
+// Устройство NVS: страница 4 КБ, в ней 126 записей по 32 байта, одна
+// страница всегда свободна под сборку мусора. Блоб — заголовок и данные
+// по 32 байта плюс индекс блоба.
+#define LIFE_NVS_PAGE    4096
+#define LIFE_NVS_ENTRIES 126
+
+struct LifeAxis {
+  uint64_t steps;
+  uint64_t runMs;                  // двигатель вращался
+  uint32_t reversals;              // смены направления движения
+  uint32_t peakHz;
+};
+
+struct LifeData {
+  uint16_t magic;
+  uint8_t  ver;
+  uint8_t  axes;
+  uint32_t boots;
+  uint32_t alarms;
+  uint32_t saves;                  // записей в NVS
+  LifeAxis ax[LIFE_AXES];
+};
+
+// Что нужно для приращений по оси; в NVS не пишется.
+struct LifeTrack {
+  int32_t  lastPos;
+  int8_t   lastSign;               // направление последнего движения, 0 — ещё не было
+  bool     wasRunning;
+  uint32_t lastMs;
+};
+
+static inline size_t lifeEntriesPerWrite(size_t bytes) {
+  return 1 + (bytes + 31) / 32 + 1;
+}
+
+// Минимальный период записи, с. За LIFE_YEARS при записи с этим периодом
+// каждая страница nvs стирается не больше LIFE_CYCLES / LIFE_MARGIN раз
+// (NVS пишет записи по кругу по всем страницам).
+static inline uint32_t lifeFlushPeriodS(size_t nvsBytes, size_t blobBytes) {
+  size_t pages = nvsBytes / LIFE_NVS_PAGE;
+  if (pages > 1) pages--;
+  double entries = (double)pages * LIFE_NVS_ENTRIES * LIFE_CYCLES / LIFE_MARGIN;
+  double writes = entries / lifeEntriesPerWrite(blobBytes);
+  double s = LIFE_YEARS * 365.25 * 86400.0 / writes;
+  return (uint32_t)(s + 0.999);
+}
+
+static inline bool lifeValid(const LifeData& d) {
+  return d.magic == LIFE_MAGIC && d.ver == LIFE_VER && d.axes == LIFE_AXES;
+}
+
+static inline void lifeReset(LifeData& d) {
+  d = LifeData();
+  d.magic = LIFE_MAGIC;
+  d.ver = LIFE_VER;
+  d.axes = LIFE_AXES;
+}
+
+static inline void lifeResync(LifeTrack& t, int32_t pos, uint32_t nowMs) {
+  t.lastPos = pos;
+  t.lastMs = nowMs;
+}
+
+// Проход цикла управления: позиция, вращается ли, время. true — что-то
+// изменилось (данные «грязные»).
+static inline bool lifeTick(LifeAxis& a, LifeTrack& t, int32_t pos, bool running, uint32_t nowMs) {
+  bool changed = false;
+
+  int32_t d = pos - t.lastPos;
+  if (d) {
+    int8_t s = d > 0 ? 1 : -1;
+    a.steps += (uint32_t)(d > 0 ? d : -d);
+    if (t.lastSign && s != t.lastSign) a.reversals++;
+    t.lastSign = s;
+    t.lastPos = pos;
+    changed = true;
+  }
+
+  uint32_t dt = nowMs - t.lastMs;
+  t.lastMs = nowMs;
+  // время — за проходы, которые начались и кончились в движении
+  if (running && t.wasRunning) {
+    a.runMs += dt;
+    changed = changed || dt;
+  }
+  t.wasRunning = running;
+  return changed;
+}
+
+static inline bool lifePeak(LifeAxis& a, uint32_t hz) {
+  if (hz <= a.peakHz) return false;
+  a.peakHz = hz;
+  return true;
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "regmap.h"
+
+// Ядро Modbus RTU slave поверх общей карты регистров (regmap.h).
+// На вход — готовый кадр (границу кадра определяет UART по паузе),
+// на выход — ответ. Ввода-вывода здесь нет, так что ядро собирается
+// и на хосте (см. tools/mb_bench.cpp).
+//
+// Функции: 03 read holding, 04 read input, 06 write single, 16 write multiple.
+
+#define MB_ADU_MAX 256
+
+#define MB_EX_FUNC  0x01
+#define MB_EX_ADDR  0x02
+#define MB_EX_VALUE 0x03
+
+typedef void (*MbApply)(uint8_t op, uint32_t a, uint32_t b);
+
+static inline uint16_t mbCrc(const uint8_t* p, size_t n) {
+  uint16_t crc = 0xFFFF;
+  while (n--) {
+    crc ^= *p++;
+    for (uint8_t i = 0; i < 8; i++) crc = (crc & 1) ? (crc >> 1) ^ 0xA001 : (crc >> 1);
+  }
+  return crc;
+}
+
+static inline size_t mbFinish(uint8_t* r, size_t n) {
+  uint16_t crc = mbCrc(r, n);
+  r[n++] = (uint8_t)crc;
+  r[n++] = (uint8_t)(crc >> 8);
+  return n;
+}
+
+static inline size_t mbException(uint8_t* r, uint8_t slave, uint8_t fc, uint8_t ex) {
+  r[0] = slave;
+  r[1] = fc | 0x80;
+  r[2] = ex;
+  return mbFinish(r, 3);
+}
+
+static inline uint16_t mbGet16(const uint8_t* p) {
+  return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+// Возвращает длину ответа; 0 — не отвечать (чужой адрес, broadcast, битый CRC).
+static inline size_t mbProcess(RegMap& m, const RegStatus& st, uint8_t slave,
+                               const uint8_t* q, size_t n, uint8_t* r, MbApply apply) {
+  if (n < 4) return 0;
+  if (mbCrc(q, n - 2) != (uint16_t)(q[n - 2] | (q[n - 1] << 8))) return 0;
+
+  uint8_t addr = q[0];
+  if (addr != slave && addr != 0) return 0;
+  bool bcast = (addr == 0);
+
+  uint8_t fc = q[1];
+  size_t len = 0;
+
+  switch (fc) {
+    case 0x03:
+    case 0x04: {
+      if (n != 8) return bcast ? 0 : mbException(r, slave, fc, MB_EX_VALUE);
+      uint16_t a0 = mbGet16(&q[2]);
+      uint16_t cnt = mbGet16(&q[4]);
+      if (cnt < 1 || cnt > 125) return bcast ? 0 : mbException(r, slave, fc, MB_EX_VALUE);
+      for (uint16_t i = 0; i < cnt; i++) {
+        if (!regReadable(a0 + i)) return bcast ? 0 : mbException(r, slave, fc, MB_EX_ADDR);
+      }
+      if (bcast) return 0;
+
+      r[0] = slave;
+      r[1] = fc;
+      r[2] = (uint8_t)(cnt * 2);
+      len = 3;
+      for (uint16_t i = 0; i < cnt; i++) {
+        uint16_t v = regRead(m, st, a0 + i);
+        r[len++] = (uint8_t)(v >> 8);
+        r[len++] = (uint8_t)v;
+      }
+      return mbFinish(r, len);
+    }
+
+    case 0x06: {
+      if (n != 8) return bcast ? 0 : mbException(r, slave, fc, MB_EX_VALUE);
+      uint8_t op; uint32_t a, b;
+      if (!regWrite(m, mbGet16(&q[2]), mbGet16(&q[4]), op, a, b)) {
+        return bcast ? 0 : mbException(r, slave, fc, MB_EX_ADDR);
+      }
+      if (op != REG_OP_NONE) apply(op, a, b);
+      if (bcast) return 0;
+
+      for (len = 0; len < 6; len++) r[len] = q[len];
+      return mbFinish(r, len);
+    }
+
+    case 0x10: {
+      if (n < 9) return bcast ? 0 : mbException(r, slave, fc, MB_EX_VALUE);
+      uint16_t a0 = mbGet16(&q[2]);
+      uint16_t cnt = mbGet16(&q[4]);
+      uint8_t bytes = q[6];
+      if (cnt < 1 || cnt > 123 || bytes != cnt * 2 || n != (size_t)9 + bytes) {
+        return bcast ? 0 : mbException(r, slave, fc, MB_EX_VALUE);
+      }
+      if ((uint32_t)a0 + cnt > REG_HOLD_N) return bcast ? 0 : mbException(r, slave, fc, MB_EX_ADDR);
+
+      for (uint16_t i = 0; i < cnt; i++) {
+        uint8_t op; uint32_t a, b;
+        regWrite(m, a0 + i, mbGet16(&q[7 + 2 * i]), op, a, b);
+        if (op != REG_OP_NONE) apply(op, a, b);
+      }
+      if (bcast) return 0;
+
+      for (len = 0; len < 6; len++) r[len] = q[len];
+      return mbFinish(r, len);
+    }
+  }
+
+  return bcast ? 0 : mbException(r, slave, fc, MB_EX_FUNC);
+}
@@ -0,0 +1,272 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+// Автомат режима «вращение с заданной скоростью»: start/stop, f/acc/ramp,
+// dir, en и авария. Переходы — таблица MO_ROWS (состояние, событие,
+// условие -> состояние), действия — при выходе из состояния и при входе
+// в новое (MO_EXIT / MO_ENTRY). Двигателем автомат управляет через
+// MoHooks, так что целиком проверяется на хосте (tools/motion_check.cpp).
+//
+// Остальные режимы (кулачок, маховичок, дуга, потоки, подбор) двигатель
+// ведут сами и включаются только при стоящем двигателе; для автомата это
+// Idle, в котором двигатель может и вращаться (moving).
+//
+// Каждый переход пишется в кольцо trace: время, событие, откуда, куда и
+// сколько заняли действия; время между соседними записями — сколько
+// автомат пробыл в состоянии (например, длительность торможения).
+
+#ifndef MO_TRACE
+#define MO_TRACE 32
+#endif
+
+enum MoState : uint8_t {
+  MO_DISABLED,       // драйвер выключен (en=0)
+  MO_IDLE,           // стоим, движение не запрошено
+  MO_ACCEL,          // разгон к заданной скорости
+  MO_CRUISE,         // на заданной скорости
+  MO_DECEL,          // торможение: до нуля (stop) или до новой, меньшей скорости
+  MO_REVERSE,        // торможение до нуля ради смены направления
+  MO_FAULT,          // авария драйвера
+  MO_STATES
+};
+
+enum MoEvent : uint8_t {
+  MO_EV_START,
+  MO_EV_STOP,
+  MO_EV_SPEED,       // новая заданная скорость; arg — она выше текущей
+  MO_EV_DIR,         // arg — направление
+  MO_EV_ENABLE,
+  MO_EV_DISABLE,
+  MO_EV_ALARM,
+  MO_EV_CLEAR,       // авария снята
+  MO_EV_AT_SPEED,    // от moFeed: скорость достигнута
+  MO_EV_STOPPED,     // от moFeed: двигатель встал
+  MO_EVENTS
+};
+
+enum MoGuard : uint8_t {
+  MO_G_ALWAYS,
+  MO_G_WANT,         // движение запрошено
+  MO_G_FASTER,       // запрошено и новая скорость выше
+  MO_G_SLOWER,       // запрошено и новая скорость ниже
+  MO_G_EN,
+  MO_G_NOEN,
+  MO_G_TURN,         // ждёт смена направления, а двигатель ещё вращается
+  MO_G_DIRPEND,      // ждёт смена направления
+};
+
+// Действия, биты
+enum : uint8_t {
+  MO_A_DROP = 1,     // снять запрос движения
+  MO_A_DIR  = 2,     // применить новое направление, если двигатель стоит
+  MO_A_RUN  = 4,     // вращать с заданной скоростью
+  MO_A_SLOW = 8,     // к новой скорости, если движение запрошено, иначе к нулю
+  MO_A_STOP = 16,    // торможение до нуля
+  MO_A_HALT = 32,    // остановить всё (авария, en=0)
+};
+
+struct MoRow {
+  uint8_t from, ev, guard, to;
+};
+
+// Порядок важен: берётся первая подходящая строка. Событие без строки
+// в текущем состоянии игнорируется (считается в ignored).
+static const MoRow MO_ROWS[] = {
+  {MO_DISABLED, MO_EV_ALARM,    MO_G_ALWAYS,  MO_FAULT},
+  {MO_DISABLED, MO_EV_ENABLE,   MO_G_ALWAYS,  MO_IDLE},
+
+  {MO_IDLE,     MO_EV_START,    MO_G_TURN,    MO_REVERSE},
+  {MO_IDLE,     MO_EV_START,    MO_G_ALWAYS,  MO_ACCEL},
+  {MO_IDLE,     MO_EV_DIR,      MO_G_DIRPEND, MO_IDLE},
+  {MO_IDLE,     MO_EV_STOPPED,  MO_G_DIRPEND, MO_IDLE},
+  {MO_IDLE,     MO_EV_DISABLE,  MO_G_ALWAYS,  MO_DISABLED},
+  {MO_IDLE,     MO_EV_ALARM,    MO_G_ALWAYS,  MO_FAULT},
+
+  {MO_ACCEL,    MO_EV_AT_SPEED, MO_G_ALWAYS,  MO_CRUISE},
+  {MO_ACCEL,    MO_EV_STOP,     MO_G_ALWAYS,  MO_DECEL},
+  {MO_ACCEL,    MO_EV_SPEED,    MO_G_FASTER,  MO_ACCEL},
+  {MO_ACCEL,    MO_EV_SPEED,    MO_G_SLOWER,  MO_DECEL},
+  {MO_ACCEL,    MO_EV_DIR,      MO_G_DIRPEND, MO_REVERSE},
+  {MO_ACCEL,    MO_EV_STOPPED,  MO_G_ALWAYS,  MO_IDLE},
+  {MO_ACCEL,    MO_EV_DISABLE,  MO_G_ALWAYS,  MO_DISABLED},
+  {MO_ACCEL,    MO_EV_ALARM,    MO_G_ALWAYS,  MO_FAULT},
+
+  {MO_CRUISE,   MO_EV_STOP,     MO_G_ALWAYS,  MO_DECEL},
+  {MO_CRUISE,   MO_EV_SPEED,    MO_G_FASTER,  MO_ACCEL},
+  {MO_CRUISE,   MO_EV_SPEED,    MO_G_SLOWER,  MO_DECEL},
+  {MO_CRUISE,   MO_EV_DIR,      MO_G_DIRPEND, MO_REVERSE},
+  {MO_CRUISE,   MO_EV_STOPPED,  MO_G_ALWAYS,  MO_IDLE},
+  {MO_CRUISE,   MO_EV_DISABLE,  MO_G_ALWAYS,  MO_DISABLED},
+  {MO_CRUISE,   MO_EV_ALARM,    MO_G_ALWAYS,  MO_FAULT},
+
+  {MO_DECEL,    MO_EV_STOPPED,  MO_G_ALWAYS,  MO_IDLE},
+  {MO_DECEL,    MO_EV_AT_SPEED, MO_G_WANT,    MO_CRUISE},
+  {MO_DECEL,    MO_EV_START,    MO_G_ALWAYS,  MO_ACCEL},
+  {MO_DECEL,    MO_EV_STOP,     MO_G_ALWAYS,  MO_DECEL},
+  {MO_DECEL,    MO_EV_SPEED,    MO_G_FASTER,  MO_ACCEL},
+  {MO_DECEL,    MO_EV_SPEED,    MO_G_SLOWER,  MO_DECEL},
+  {MO_DECEL,    MO_EV_DIR,      MO_G_DIRPEND, MO_REVERSE},
+  {MO_DECEL,    MO_EV_DISABLE,  MO_G_ALWAYS,  MO_DISABLED},
+  {MO_DECEL,    MO_EV_ALARM,    MO_G_ALWAYS,  MO_FAULT},
+
+  {MO_REVERSE,  MO_EV_STOPPED,  MO_G_WANT,    MO_ACCEL},
+  {MO_REVERSE,  MO_EV_STOPPED,  MO_G_ALWAYS,  MO_IDLE},
+  {MO_REVERSE,  MO_EV_DISABLE,  MO_G_ALWAYS,  MO_DISABLED},
+  {MO_REVERSE,  MO_EV_ALARM,    MO_G_ALWAYS,  MO_FAULT},
+
+  {MO_FAULT,    MO_EV_CLEAR,    MO_G_EN,      MO_IDLE},
+  {MO_FAULT,    MO_EV_CLEAR,    MO_G_NOEN,    MO_DISABLED},
+};
+
+static const size_t MO_NROWS = sizeof(MO_ROWS) / sizeof(MO_ROWS[0]);
+
+static const uint8_t MO_ENTRY[MO_STATES] = {
+  MO_A_HALT | MO_A_DROP,       // DISABLED
+  MO_A_DROP | MO_A_DIR,        // IDLE
+  MO_A_DIR | MO_A_RUN,         // ACCEL
+  0,                           // CRUISE
+  MO_A_SLOW,                   // DECEL
+  MO_A_STOP,                   // REVERSE
+  MO_A_HALT | MO_A_DROP,       // FAULT
+};
+
+static const uint8_t MO_EXIT[MO_STATES] = {
+  0, 0, 0, 0, 0,
+  MO_A_DIR,                    // REVERSE: встали — сразу новое направление
+  0,
+};
+
+struct MoHooks {
+  void (*run)();               // вращать с заданной скоростью в направлении dir
+  void (*stop)();              // тормозить до нуля
+  void (*halt)();              // остановить всё
+  void (*setDir)(uint8_t dir); // вызывается только при стоящем двигателе
+  uint32_t (*us)();
+};
+
+struct MoTrace {
+  uint32_t us;
+  uint8_t  ev, from, to;
+  uint16_t actUs;              // действия выхода и входа
+};
+
+struct Motion {
+  uint8_t state;
+  bool want;                   // запрошено движение (бывший runReq)
+  bool en, alarm;
+  bool moving;                 // по последнему moFeed
+  bool faster;                 // аргумент последнего MO_EV_SPEED
+  uint8_t dir, dirNext;
+  MoTrace trace[MO_TRACE];
+  uint32_t transitions, ignored;
+  uint16_t actMaxUs[MO_STATES];    // по состоянию, в которое входили
+};
+
+static inline const char* moStateName(uint8_t s) {
+  static const char* const N[MO_STATES] = {"disabled", "idle", "accel", "cruise", "decel", "reverse", "fault"};
+  return s < MO_STATES ? N[s] : "?";
+}
+
+static inline const char* moEventName(uint8_t e) {
+  static const char* const N[MO_EVENTS] = {"start", "stop", "speed", "dir", "enable", "disable",
+                                           "alarm", "clear", "at_speed", "stopped"};
+  return e < MO_EVENTS ? N[e] : "?";
+}
+
+static inline bool moGuard(const Motion& m, uint8_t g) {
+  switch (g) {
+    case MO_G_WANT:    return m.want;
+    case MO_G_FASTER:  return m.want && m.faster;
+    case MO_G_SLOWER:  return m.want && !m.faster;
+    case MO_G_EN:      return m.en;
+    case MO_G_NOEN:    return !m.en;
+    case MO_G_TURN:    return m.dirNext != m.dir && m.moving;
+    case MO_G_DIRPEND: return m.dirNext != m.dir;
+    default:           return true;
+  }
+}
+
+static inline void moAct(Motion& m, uint8_t a, const MoHooks& h) {
+  if (a & MO_A_DROP) m.want = false;
+  if ((a & MO_A_DIR) && m.dirNext != m.dir && !m.moving) {
+    m.dir = m.dirNext;
+    h.setDir(m.dir);
+  }
+  if (a & MO_A_HALT) h.halt();
+  if (a & MO_A_STOP) h.stop();
+  if (a & MO_A_SLOW) {
+    if (m.want) h.run();
+    else h.stop();
+  }
+  if (a & MO_A_RUN) h.run();
+}
+
+static inline void moInit(Motion& m, bool en, bool alarm, uint8_t dir) {
+  memset(&m, 0, sizeof(m));
+  m.en = en;
+  m.alarm = alarm;
+  m.dir = m.dirNext = dir ? 1 : 0;
+  m.state = alarm ? MO_FAULT : (en ? MO_IDLE : MO_DISABLED);
+}
+
+// Событие: сначала обновляются входы (запрос, направление, en, авария),
+// потом ищется строка таблицы. Старт без en или при аварии не
+// запоминается. true — был переход.
+static inline bool moPost(Motion& m, uint8_t ev, uint32_t arg, const MoHooks& h) {
+  switch (ev) {
+    case MO_EV_START:   m.want = m.state != MO_DISABLED && m.state != MO_FAULT; break;
+    case MO_EV_STOP:    m.want = false; break;
+    case MO_EV_SPEED:   m.faster = arg != 0; break;
+    case MO_EV_DIR:     m.dirNext = arg ? 1 : 0; break;
+    case MO_EV_ENABLE:  m.en = true; break;
+    case MO_EV_DISABLE: m.en = false; break;
+    case MO_EV_ALARM:   m.alarm = true; break;
+    case MO_EV_CLEAR:   m.alarm = false; break;
+    default: break;
+  }
+
+  for (size_t i = 0; i < MO_NROWS; i++) {
+    const MoRow& r = MO_ROWS[i];
+    if (r.from != m.state || r.ev != ev || !moGuard(m, r.guard)) continue;
+
+    uint32_t t0 = h.us();
+    moAct(m, MO_EXIT[m.state], h);
+    uint8_t from = m.state;
+    m.state = r.to;
+    moAct(m, MO_ENTRY[r.to], h);
+    uint32_t dt = h.us() - t0;
+    uint16_t act = dt > 0xFFFF ? 0xFFFF : (uint16_t)dt;
+
+    MoTrace& t = m.trace[m.transitions++ % MO_TRACE];
+    t.us = t0;
+    t.ev = ev;
+    t.from = from;
+    t.to = r.to;
+    t.actUs = act;
+    if (act > m.actMaxUs[r.to]) m.actMaxUs[r.to] = act;
+    return true;
+  }
+  m.ignored++;
+  return false;
+}
+
+// Обратная связь от двигателя, каждый проход цикла управления.
+// STOPPED — на остановке, а в торможении до нуля и при смене
+// направления — пока стоит (торможение могло начаться на стоящем).
+static inline void moFeed(Motion& m, bool moving, bool atSpeed, const MoHooks& h) {
+  bool was = m.moving;
+  m.moving = moving;
+  if (!moving && (was || (m.state == MO_DECEL && !m.want) || m.state == MO_REVERSE)) {
+    moPost(m, MO_EV_STOPPED, 0, h);
+  } else if (moving && atSpeed && (m.state == MO_ACCEL || (m.state == MO_DECEL && m.want))) {
+    moPost(m, MO_EV_AT_SPEED, 0, h);
+  }
+}
+
+// Скорость задаёт автомат (для формирования скорости в shapeTick).
+static inline bool moDrive(const Motion& m) {
+  return m.want && (m.state == MO_ACCEL || m.state == MO_CRUISE || m.state == MO_DECEL);
+}
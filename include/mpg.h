@@ -0,0 +1,84 @@
+#pragma once
+
+#include <stdint.h>
+
+// Маховичок (MPG): отсчёты колеса -> сглаженная позиция двигателя.
+// Цель копится в шагах (отсчёты * масштаб), выход догоняет её с
+// ограничением скорости и ускорения, чтобы быстрый прокрут колеса
+// не срывал двигатель. Отставание ограничено maxLag (на реверсе — плюс
+// путь торможения): всё, что колесо накрутило сверх него, отбрасывается,
+// и после остановки колеса ось не уезжает дальше, чем на maxLag, и не
+// проскакивает цель. Первый шаг после отсчёта — через 1–2 тика при
+// ускорении от ~100000 шаг/с^2. Проверка — tools/mpg_check.cpp.
+
+struct MpgFilter {
+  int32_t  scale;      // шагов на отсчёт: 1 / 10 / 100
+  uint32_t vmax;       // шаг/с
+  uint32_t accel;      // шаг/с^2
+  int32_t  maxLag;     // шаги
+
+  int32_t  target;     // шаги
+  int64_t  pos;        // шаги, Q16
+  int64_t  vel;        // шаг/с, Q16
+};
+
+static inline uint32_t mpgIsqrt(uint64_t v) {
+  uint64_t r = 0, bit = 1ULL << 62;
+  while (bit > v) bit >>= 2;
+  while (bit) {
+    if (v >= r + bit) { v -= r + bit; r = (r >> 1) + bit; }
+    else r >>= 1;
+    bit >>= 2;
+  }
+  return (uint32_t)r;
+}
+
+static inline void mpgReset(MpgFilter& f, int32_t posSteps) {
+  f.target = posSteps;
+  f.pos = (int64_t)posSteps << 16;
+  f.vel = 0;
+}
+
+static inline int32_t mpgPos(const MpgFilter& f) {
+  return (int32_t)((f.pos + 32768) >> 16);
+}
+
+static inline void mpgFeed(MpgFilter& f, int32_t counts) {
+  int64_t t = (int64_t)f.target + (int64_t)counts * f.scale;
+  int64_t p = f.pos >> 16;
+  if (t > p + f.maxLag) t = p + f.maxLag;
+  if (t < p - f.maxLag) t = p - f.maxLag;
+  f.target = (int32_t)t;
+}
+
+// Один шаг интегрирования длительностью dt_us.
+static inline void mpgStep(MpgFilter& f, uint32_t dt_us) {
+  int64_t e = ((int64_t)f.target << 16) - f.pos;
+  int64_t ae = e < 0 ? -e : e;
+
+  int64_t dv = (int64_t)f.accel * dt_us * 65536 / 1000000;
+  if (dv < 1) dv = 1;
+
+  // у цели и почти без скорости — встаём точно в цель
+  if (ae < 65536 && (f.vel < 0 ? -f.vel : f.vel) <= dv) {
+    f.pos = (int64_t)f.target << 16;
+    f.vel = 0;
+    return;
+  }
+
+  // скорость, с которой ещё успеваем затормозить к цели. Торможение
+  // идёт тиками: путь с v до нуля — v^2/2a + v*dt/2, отсюда
+  // v = sqrt(h^2 + 2ae) - h, h = a*dt/2
+  uint64_t h = (uint64_t)f.accel * dt_us / 2000000;
+  uint64_t vsq = mpgIsqrt(h * h + 2ULL * f.accel * (uint64_t)(ae >> 16));
+  int64_t vs = (int64_t)(vsq - h) << 16;
+  int64_t vm = (int64_t)f.vmax << 16;
+  if (vs > vm) vs = vm;
+  int64_t want = e < 0 ? -vs : vs;
+
+  if (want > f.vel + dv) f.vel += dv;
+  else if (want < f.vel - dv) f.vel -= dv;
+  else f.vel = want;
+
+  f.pos += f.vel * (int64_t)dt_us / 1000000;
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+// Запись состояния при пропадании питания. Лог в двух секторах флеша
+// по 4 КБ: записи по 32 байта ложатся в заранее стёртые слоты (0xFF),
+// так что при аварии нужна только запись, без стирания. Место готовится
+// при загрузке: если в секторе с последней записью слотов не осталось,
+// стирается второй — в нём только записи старше последней.
+//
+// NOR-флеш пишет только 1 -> 0, поэтому поля после sum дописываются
+// отдельно, не трогая контрольную сумму: время сохранения и отметка
+// «запись уже применена». Оборванная на середине запись не проходит
+// CRC и пропускается, её слот больше не используется.
+
+#define PF_SECTOR   4096
+#define PF_REC      32
+#define PF_SLOTS    (PF_SECTOR / PF_REC)
+#define PF_MAGIC    0x4650u            // "PF"
+
+#define PF_F_EN      0x01
+#define PF_F_MOVING  0x02
+#define PF_F_RUNREQ  0x04
+
+struct PfRecord {
+  uint16_t magic;
+  uint8_t  dir;
+  uint8_t  flags;      // PF_F_*
+  uint32_t seq;
+  int32_t  pos;
+  uint32_t freq;
+  uint32_t accel;
+  uint32_t sum;        // CRC32 полей выше
+  uint32_t saveUs;     // дописывается после записи; 0xFFFFFFFF — не успели
+  uint8_t  used;       // 0xFF — ещё не применена при загрузке
+  uint8_t  pad[3];
+};
+
+static_assert(sizeof(PfRecord) == PF_REC, "PfRecord must fill a slot");
+
+static inline uint32_t pfCrc(const void* data, size_t n) {
+  const uint8_t* p = (const uint8_t*)data;
+  uint32_t c = 0xFFFFFFFFu;
+  while (n--) {
+    c ^= *p++;
+    for (int k = 0; k < 8; k++) c = (c >> 1) ^ (0xEDB88320u & (0u - (c & 1)));
+  }
+  return ~c;
+}
+
+static inline uint32_t pfSum(const PfRecord& r) {
+  return pfCrc(&r, offsetof(PfRecord, sum));
+}
+
+static inline bool pfValid(const PfRecord& r) {
+  return r.magic == PF_MAGIC && r.sum == pfSum(r);
+}
+
+static inline bool pfBlank(const uint8_t* p, size_t n) {
+  while (n--) if (*p++ != 0xFF) return false;
+  return true;
+}
+
+// Итог разбора одного сектора.
+struct PfSector {
+  bool     found;      // есть целая запись
+  uint16_t slot;       // слот самой свежей из них
+  PfRecord rec;
+  uint16_t next;       // первый слот после последнего непустого
+  bool     blank;      // сектор целиком стёрт
+};
+
+static inline void pfScan(const uint8_t* sec, PfSector& s) {
+  s.found = false;
+  s.slot = 0;
+  s.next = 0;
+  for (uint16_t i = 0; i < PF_SLOTS; i++) {
+    const uint8_t* p = sec + i * PF_REC;
+    if (pfBlank(p, PF_REC)) continue;
+    s.next = i + 1;
+    PfRecord r;
+    memcpy(&r, p, sizeof(r));
+    if (!pfValid(r)) continue;
+    if (!s.found || (int32_t)(r.seq - s.rec.seq) > 0) {
+      s.rec = r;
+      s.slot = i;
+      s.found = true;
+    }
+  }
+  s.blank = (s.next == 0);
+}
+
+// Где последняя запись и куда писать следующую.
+struct PfPlan {
+  bool     found;
+  PfRecord rec;
+  uint8_t  recSec;
+  uint16_t recSlot;
+  uint8_t  sec;        // сектор следующей записи
+  uint16_t slot;
+  bool     erase;      // сектор sec перед этим стереть (только при загрузке!)
+  uint32_t seq;        // seq следующей записи
+};
+
+static inline void pfPlan(const PfSector s[2], PfPlan& p) {
+  uint8_t last = 0;
+  if (s[0].found && s[1].found) last = (int32_t)(s[1].rec.seq - s[0].rec.seq) > 0 ? 1 : 0;
+  else if (s[1].found)          last = 1;
+
+  p.found = s[last].found;
+  if (p.found) {
+    p.rec = s[last].rec;
+    p.recSec = last;
+    p.recSlot = s[last].slot;
+  }
+  p.seq = p.found ? p.rec.seq + 1 : 1;
+
+  // дописываем в сектор с последней записью, пока там есть место
+  if (s[last].next < PF_SLOTS) {
+    p.sec = last;
+    p.slot = s[last].next;
+    p.erase = false;
+    return;
+  }
+  p.sec = last ^ 1;
+  p.slot = 0;
+  p.erase = !s[last ^ 1].blank;
+}
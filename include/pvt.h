@@ -0,0 +1,206 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "stepcomp.h"              // ограничения записи очереди FAS
+
+// PVT-поток: точки (время, позиция, скорость) от хоста, кубическая
+// интерполяция Эрмита между соседними точками. В моменты точек
+// позиция совпадает с заданной точно, между ними — гладкая кривая
+// с заданными скоростями на концах.
+//
+// Буфер — кольцо с одним писателем (приём по UDP) и одним читателем
+// (StepTask), без блокировок.
+//
+// Шаги строятся прямо записями очереди FAS (pvtGenSlice), без рамп
+// FAS: поток режется на срезы ~PVT_SLICE_US, конец среза ставится на
+// время ближайшей точки, шаги среза — равномерно по нему. Так двигатель
+// проходит каждую точку в её время с точностью до шага, а между ними
+// отходит от кривой Эрмита не больше чем на ускорение * срез^2 / 8 плюс
+// два шага на округление. Точки ближе PVT_SLICE_MIN_US друг к другу срез перешагивает —
+// в их время позиция не гарантируется. Проверка — tools/pvt_check.cpp.
+//
+// Пакет (little-endian):
+//   'P' 'V' ver flags seq:u32, затем до PVT_MAX_PTS * {t_us:u32 pos:i32 vel:i32}
+//   flags: PVT_F_START — новый поток (время и позиция от начала потока),
+//          PVT_F_END   — последняя точка потока, на ней остановиться.
+// Ответ на каждый пакет:
+//   'P' 'S' state drops:u8 seq:u32 level:u16 free:u16
+
+#define PVT_BUF      256          // степень двойки
+#define PVT_VER      1
+#define PVT_F_START  0x01
+#define PVT_F_END    0x02
+#define PVT_HDR      8
+#define PVT_PT       12
+#define PVT_MAX_PTS  100          // точек в пакете
+#define PVT_REPLY    12
+
+#define PVT_TICKS_US     16       // тики очереди FAS на мкс
+#define PVT_SLICE_US     1000
+#define PVT_SLICE_MIN_US 250      // не короче SC_MIN_TICKS + SC_GROUP_MAX тиков
+#define PVT_SLICE_ENT    8        // записей FAS на срез, с запасом
+
+enum PvtState : uint8_t { PVT_IDLE, PVT_PREFILL, PVT_RUN, PVT_UNDERFLOW, PVT_DONE };
+
+struct PvtPoint {
+  uint32_t t;     // мкс от начала потока
+  int32_t  p;     // шаги
+  int32_t  v;     // шаг/с
+};
+
+struct PvtBuffer {
+  PvtPoint pt[PVT_BUF];
+  volatile uint16_t head;   // пишет приёмник
+  volatile uint16_t tail;   // читает StepTask
+  volatile bool     ended;  // последняя точка потока уже в буфере
+};
+
+static inline uint16_t pvtLevel(const PvtBuffer& b) {
+  return (uint16_t)((b.head - b.tail) & (PVT_BUF - 1));
+}
+
+static inline uint16_t pvtFree(const PvtBuffer& b) {
+  return PVT_BUF - 1 - pvtLevel(b);
+}
+
+static inline bool pvtPush(PvtBuffer& b, const PvtPoint& p) {
+  if (!pvtFree(b)) return false;
+  b.pt[b.head] = p;
+  b.head = (b.head + 1) & (PVT_BUF - 1);
+  return true;
+}
+
+static inline const PvtPoint& pvtAt(const PvtBuffer& b, uint16_t i) {
+  return b.pt[(b.tail + i) & (PVT_BUF - 1)];
+}
+
+static inline void pvtPop(PvtBuffer& b) {
+  b.tail = (b.tail + 1) & (PVT_BUF - 1);
+}
+
+// Позиция на отрезке a..b в момент t (a.t <= t <= b.t), шаги.
+static inline int32_t pvtHermite(const PvtPoint& a, const PvtPoint& b, uint32_t t) {
+  uint32_t h = b.t - a.t;
+  if (h == 0) return b.p;
+
+  int64_t s  = ((int64_t)(t - a.t) << 16) / h;      // Q16
+  int64_t s2 = (s * s) >> 16;
+  int64_t s3 = (s2 * s) >> 16;
+
+  int64_t h10 = s3 - 2 * s2 + s;
+  int64_t h01 = -2 * s3 + 3 * s2;
+  int64_t h11 = s3 - s2;
+
+  // касательные в шагах на длину отрезка
+  int64_t m0 = (int64_t)a.v * h / 1000000;
+  int64_t m1 = (int64_t)b.v * h / 1000000;
+  int64_t dp = (int64_t)b.p - a.p;
+
+  int64_t y = h01 * dp + h10 * m0 + h11 * m1;       // Q16
+  return a.p + (int32_t)((y + 32768) >> 16);
+}
+
+// Позиция потока в момент t; false — точек до t ещё нет.
+static inline bool pvtPosAt(const PvtBuffer& b, uint32_t t, int32_t& p) {
+  uint16_t n = pvtLevel(b);
+  for (uint16_t k = 0; k + 1 < n; k++) {
+    const PvtPoint& a = pvtAt(b, k);
+    const PvtPoint& c = pvtAt(b, k + 1);
+    if (t >= a.t && t <= c.t) {
+      p = pvtHermite(a, c, t);
+      return true;
+    }
+  }
+  return false;
+}
+
+// ----- Срезы в записи очереди FAS -----
+
+struct PvtEntry {
+  uint16_t ticks;    // период шага; у паузы (steps = 0) — её длительность
+  uint8_t  steps;
+  uint8_t  up;       // 1 — вперёд
+};
+
+struct PvtGen {
+  uint32_t t;        // выдано до этого момента, мкс от начала потока
+  int32_t  p;        // позиция потока в t
+  uint32_t rem;      // недоданные тики от округления периода
+  PvtEntry e[PVT_SLICE_ENT];
+  uint8_t  n, i;     // записей в текущем срезе, из них отдано
+};
+
+enum { PVT_GEN_SLICE, PVT_GEN_WAIT, PVT_GEN_DONE, PVT_GEN_FAST };
+
+static inline void pvtGenStart(PvtGen& g, const PvtBuffer& b) {
+  g.t = pvtAt(b, 0).t;
+  g.p = pvtAt(b, 0).p;
+  g.rem = 0;
+  g.n = g.i = 0;
+}
+
+// Следующий срез в g.e[0 .. g.n). PVT_GEN_WAIT — точек пока не хватает,
+// PVT_GEN_DONE — последняя точка выдана, PVT_GEN_FAST — шаги среза чаще
+// SC_MIN_IVL.
+static inline int pvtGenSlice(PvtGen& g, PvtBuffer& b) {
+  g.n = g.i = 0;
+  while (pvtLevel(b) >= 2 && pvtAt(b, 1).t <= g.t) pvtPop(b);
+  if (pvtLevel(b) < 2) return b.ended ? PVT_GEN_DONE : PVT_GEN_WAIT;
+
+  // конец среза — на ближайшей точке, если до неё не больше полутора
+  // срезов; слишком близкую — перешагнуть, последнюю — не проскочить
+  uint32_t next = pvtAt(b, 1).t - g.t;
+  uint32_t dt = next <= PVT_SLICE_US + PVT_SLICE_US / 2 ? next : PVT_SLICE_US;
+  if (dt < PVT_SLICE_MIN_US) dt = PVT_SLICE_MIN_US;
+  uint32_t te = g.t + dt;
+  const PvtPoint& last = pvtAt(b, pvtLevel(b) - 1);
+  if (te > last.t) {
+    if (!b.ended) return PVT_GEN_WAIT;
+    te = last.t;
+  }
+  int32_t pe;
+  if (!pvtPosAt(b, te, pe)) return PVT_GEN_WAIT;
+
+  // запись не короче SC_MIN_TICKS и после округления периода (минус
+  // шаг на запись); хвост у последней точки тянется до этого
+  const uint32_t minSpan = SC_MIN_TICKS + SC_GROUP_MAX;
+  uint32_t dur = dt * PVT_TICKS_US;
+  if (dur < minSpan) dur = minSpan;
+  uint32_t d = (uint32_t)abs(pe - g.p);
+  uint8_t up = pe >= g.p;
+
+  if (!d) {
+    g.e[0] = {(uint16_t)(dur + g.rem), 0, up};
+    g.rem = 0;
+    g.n = 1;
+  } else {
+    uint32_t m = (d + SC_GROUP_MAX - 1) / SC_GROUP_MAX;
+    if (m > dur / minSpan || m > PVT_SLICE_ENT) return PVT_GEN_FAST;
+    for (uint32_t k = 0; k < m; k++) {
+      uint32_t steps = d * (k + 1) / m - d * k / m;
+      uint32_t span = dur * (k + 1) / m - dur * k / m + g.rem;
+      uint32_t ivl = span / steps;
+      if (ivl < SC_MIN_IVL) return PVT_GEN_FAST;
+      g.rem = span - ivl * steps;
+      g.e[k] = {(uint16_t)ivl, (uint8_t)steps, up};
+    }
+    g.n = (uint8_t)m;
+  }
+  g.t = te;
+  g.p = pe;
+  return PVT_GEN_SLICE;
+}
+
+static inline uint32_t pvtGet32(const uint8_t* p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline void pvtPut32(uint8_t* p, uint32_t v) {
+  p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8); p[2] = (uint8_t)(v >> 16); p[3] = (uint8_t)(v >> 24);
+}
+
+static inline void pvtPut16(uint8_t* p, uint16_t v) {
+  p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8);
+}
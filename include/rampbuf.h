@@ -0,0 +1,166 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <math.h>
+
+#if defined(ESP_PLATFORM)
+#include <sdkconfig.h>
+#endif
+
+// Пакетная генерация периодов шагов (таблицы рампы, буферы под DMA).
+// Периоды разгона с ускорением a: T(e) = k * (sqrt(e + 1) - sqrt(e)),
+// k = 16 МГц * sqrt(2 / a). Единичная часть считается один раз
+// (rbUnitFill, double) и хранится в u16 с масштабом 2^RB_Q; под
+// конкретное ускорение таблица только умножается на константу:
+// out = in * mul >> sh, всё целое — результат не зависит от того, чем
+// считали. На ESP32-S3 умножение идёт по 8 слов за инструкцию (PIE:
+// ee.vmul.u16), на остальных и на хосте — скалярный цикл. Общий набор
+// проверок rbCheck() гоняет любую реализацию против скалярной слово в
+// слово и даёт хэш выхода — на хосте и на плате он должен совпасть.
+// Проверка и замер — tools/rampbuf_check.cpp.
+
+#ifndef RB_SIMD
+#if defined(CONFIG_IDF_TARGET_ESP32S3)
+#define RB_SIMD 1
+#else
+#define RB_SIMD 0
+#endif
+#endif
+
+#define RB_Q        16               // единичная таблица: (sqrt(e+1) - sqrt(e)) * 2^RB_Q
+#define RB_LANES    8                // слов u16 в 128-битном регистре PIE
+#define RB_TICKS_S  16000000.0       // тики очереди FAS
+#define RB_SH_MAX   30
+
+// Буферы ядра: n кратно RB_LANES, адреса выровнены по 16 байт.
+#define RB_ALIGNED __attribute__((aligned(16)))
+
+struct RbScale {
+  uint16_t mul;
+  uint8_t  sh;
+};
+
+// Единичная таблица для e = e0 .. e0 + n - 1; шаг из покоя (e = 0)
+// в u16 не помещается и насыщается.
+static inline void rbUnitFill(uint16_t* u, uint32_t e0, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    double e = (double)e0 + i;
+    double v = (double)(1UL << RB_Q) / (sqrt(e + 1.0) + sqrt(e));
+    u[i] = v >= 65535.0 ? 65535 : (uint16_t)lround(v);
+  }
+}
+
+// Множитель под ускорение: наибольший сдвиг, при котором mul ещё u16.
+static inline RbScale rbScaleFor(uint32_t accel) {
+  double k = RB_TICKS_S * sqrt(2.0 / (accel ? accel : 1)) / (double)(1UL << RB_Q);
+  RbScale s = {0, 0};
+  for (int sh = RB_SH_MAX; sh >= 0; sh--) {
+    double m = k * (double)(1UL << sh);
+    if (m + 0.5 < 65536.0) {
+      s.mul = (uint16_t)lround(m);
+      s.sh = (uint8_t)sh;
+      break;
+    }
+  }
+  return s;
+}
+
+static inline uint32_t rbWide(uint16_t in, RbScale s) {
+  return ((uint32_t)in * s.mul) >> s.sh;
+}
+
+// Слова, где результат больше 65535, ядро не определяет (скалярное
+// обрезает, PIE может насыщать) — для убывающей таблицы это начало;
+// первый годный индекс.
+static inline size_t rbFirst(const uint16_t* in, size_t n, RbScale s) {
+  size_t i = 0;
+  while (i < n && rbWide(in[i], s) > 0xFFFF) i++;
+  return i;
+}
+
+static inline void rbScaleC(uint16_t* out, const uint16_t* in, size_t n, RbScale s) {
+  for (size_t i = 0; i < n; i++) out[i] = (uint16_t)rbWide(in[i], s);
+}
+
+#if RB_SIMD
+// q0 — вход, q1 — множитель во всех словах, q2 — выход; сдвиг — SAR.
+// Регистры PIE в Arduino 2.x (IDF 4.4) не сохраняются при переключении
+// задач: ядро вызывается из одной задачи за раз (setup, потом консоль).
+static inline void rbScaleV(uint16_t* out, const uint16_t* in, size_t n, RbScale s) {
+  uint32_t cnt = n / RB_LANES;
+  if (!cnt) return;
+  static uint16_t mul RB_ALIGNED;
+  mul = s.mul;
+  uint32_t sh = s.sh;
+  asm volatile(
+      "wsr.sar %[sh]\n"
+      "ee.vldbc.16 q1, %[m]\n"
+      "1:\n"
+      "ee.vld.128.ip q0, %[in], 16\n"
+      "ee.vmul.u16 q2, q0, q1\n"
+      "ee.vst.128.ip q2, %[out], 16\n"
+      "addi %[cnt], %[cnt], -1\n"
+      "bnez %[cnt], 1b\n"
+      : [in] "+r"(in), [out] "+r"(out), [cnt] "+r"(cnt)
+      : [sh] "r"(sh), [m] "r"(&mul)
+      : "memory");
+}
+#endif
+
+static inline void rbScale(uint16_t* out, const uint16_t* in, size_t n, RbScale s) {
+#if RB_SIMD
+  rbScaleV(out, in, n, s);
+#else
+  rbScaleC(out, in, n, s);
+#endif
+}
+
+// ---- общий набор проверок ----
+typedef void (*RbKernel)(uint16_t* out, const uint16_t* in, size_t n, RbScale s);
+
+struct RbResult {
+  uint32_t cases, words, mismatches;
+  uint32_t hash;                   // FNV-1a по сравненным словам
+};
+
+#define RB_CHECK_N 512             // слов на случай; буферы такого размера
+
+static inline uint32_t rbLcg(uint32_t& x) {
+  x = x * 1664525u + 1013904223u;
+  return x >> 16;
+}
+
+// Случаи: единичные таблицы от разных e0 под ряд ускорений, затем
+// случайные входы и множители (все сдвиги). Сравниваются слова от
+// rbFirst; buf, ref, out — по RB_CHECK_N слов, выровнены.
+static inline RbResult rbCheck(RbKernel k, uint16_t* buf, uint16_t* ref, uint16_t* out) {
+  static const uint32_t E0[] = {0, 1000, 100000, 3000000};
+  static const uint32_t ACC[] = {100, 1000, 10000, 50000, 200000, 2000000};
+  RbResult r = {0, 0, 0, 2166136261u};
+  const size_t n = RB_CHECK_N;
+  uint32_t seed = 1;
+
+  for (int c = 0; c < 4 * 6 + 64; c++) {
+    RbScale s;
+    if (c < 4 * 6) {
+      rbUnitFill(buf, E0[c / 6], n);
+      s = rbScaleFor(ACC[c % 6]);
+    } else {
+      for (size_t i = 0; i < n; i++) buf[i] = (uint16_t)rbLcg(seed);
+      s.mul = (uint16_t)rbLcg(seed);
+      s.sh = (uint8_t)((c - 4 * 6) % (RB_SH_MAX + 1));
+    }
+    rbScaleC(ref, buf, n, s);
+    k(out, buf, n, s);
+    r.cases++;
+    for (size_t i = 0; i < n; i++) {
+      if (rbWide(buf[i], s) > 0xFFFF) continue;
+      r.words++;
+      if (out[i] != ref[i]) r.mismatches++;
+      r.hash = (r.hash ^ (ref[i] & 0xFF)) * 16777619u;
+      r.hash = (r.hash ^ (ref[i] >> 8)) * 16777619u;
+    }
+  }
+  return r;
+}
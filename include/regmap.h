@@ -0,0 +1,99 @@
+#pragma once
+
+#include <stdint.h>
+
+// Общая карта 16-битных регистров для полевых шин (Modbus и т.п.).
+// 32-битные значения — два регистра, младшее слово первым; запись
+// применяется при записи старшего слова, поэтому FC16 на пару и две
+// FC06 подряд (LO, затем HI) работают одинаково.
+//
+// Запись (holding):
+//   0x0000/1  FREQ      Гц
+//   0x0002/3  ACC       Гц/с
+//   0x0004    DIR       0/1
+//   0x0005    EN        0/1
+//   0x0006    RUN       1 — start, 0 — stop
+//   0x0007/8  RAMP_HZ   Гц (запоминается)
+//   0x0009    RAMP_MS   мс — запуск рампы на RAMP_HZ
+//
+// Чтение (input; holding по тем же адресам читает последние записанные):
+//   0x0100    FLAGS     REG_ST_*
+//   0x0101/2  FREQ      Гц
+//   0x0103/4  ACC       Гц/с
+//   0x0105/6  POS       шаги, i32
+
+#define REG_FREQ     0x0000
+#define REG_ACC      0x0002
+#define REG_DIR      0x0004
+#define REG_EN       0x0005
+#define REG_RUN      0x0006
+#define REG_RAMP_HZ  0x0007
+#define REG_RAMP_MS  0x0009
+#define REG_HOLD_N   0x000A
+
+#define REG_ST_FLAGS 0x0100
+#define REG_ST_FREQ  0x0101
+#define REG_ST_ACC   0x0103
+#define REG_ST_POS   0x0105
+#define REG_ST_END   0x0107
+
+#define REG_ST_RUNREQ   0x01
+#define REG_ST_RUNNING  0x02
+#define REG_ST_DIR      0x04
+#define REG_ST_EN       0x08
+#define REG_ST_ALARM    0x10
+
+// Команда, полученная из записи в регистр.
+enum RegOp : uint8_t { REG_OP_NONE, REG_OP_FREQ, REG_OP_ACC, REG_OP_DIR, REG_OP_EN,
+                       REG_OP_START, REG_OP_STOP, REG_OP_RAMP };
+
+struct RegStatus {
+  uint16_t flags;
+  uint32_t freq;
+  uint32_t acc;
+  int32_t  pos;
+};
+
+struct RegMap {
+  uint16_t hold[REG_HOLD_N];
+};
+
+static inline uint32_t regGet32(const RegMap& m, uint16_t a) {
+  return (uint32_t)m.hold[a] | ((uint32_t)m.hold[a + 1] << 16);
+}
+
+static inline bool regReadable(uint16_t a) {
+  return a < REG_HOLD_N || (a >= REG_ST_FLAGS && a < REG_ST_END);
+}
+
+static inline uint16_t regRead(const RegMap& m, const RegStatus& st, uint16_t a) {
+  if (a < REG_HOLD_N) return m.hold[a];
+  switch (a) {
+    case REG_ST_FLAGS:    return st.flags;
+    case REG_ST_FREQ:     return (uint16_t)st.freq;
+    case REG_ST_FREQ + 1: return (uint16_t)(st.freq >> 16);
+    case REG_ST_ACC:      return (uint16_t)st.acc;
+    case REG_ST_ACC + 1:  return (uint16_t)(st.acc >> 16);
+    case REG_ST_POS:      return (uint16_t)(uint32_t)st.pos;
+    case REG_ST_POS + 1:  return (uint16_t)((uint32_t)st.pos >> 16);
+  }
+  return 0;
+}
+
+// Запись регистра. false — адрес не для записи.
+// op/a/b — команда для применения (REG_OP_NONE, если запись только запомнена).
+static inline bool regWrite(RegMap& m, uint16_t addr, uint16_t v, uint8_t& op, uint32_t& a, uint32_t& b) {
+  op = REG_OP_NONE; a = 0; b = 0;
+  if (addr >= REG_HOLD_N) return false;
+  m.hold[addr] = v;
+
+  switch (addr) {
+    case REG_FREQ + 1:   op = REG_OP_FREQ; a = regGet32(m, REG_FREQ); break;
+    case REG_ACC + 1:    op = REG_OP_ACC;  a = regGet32(m, REG_ACC);  break;
+    case REG_DIR:        op = REG_OP_DIR;  a = v ? 1 : 0; break;
+    case REG_EN:         op = REG_OP_EN;   a = v ? 1 : 0; break;
+    case REG_RUN:        op = v ? REG_OP_START : REG_OP_STOP; break;
+    case REG_RAMP_MS:    op = REG_OP_RAMP; a = regGet32(m, REG_RAMP_HZ); b = v; break;
+  }
+  return true;
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <stdint.h>
+
+// Запрещённые полосы скоростей по результатам прохода по частоте шагов.
+// На каждой точке прохода замерен уровень вибрации; базовый уровень —
+// нижний квартиль по окну соседних точек, поэтому плавный рост вибрации со
+// скоростью пиком не считается. Точки выше базы в k раз (и выше
+// абсолютного порога) собираются в полосы; границы полосы — посередине
+// до соседних «спокойных» точек плюс запас в промилле.
+//
+// Полосы хранятся в NVS; заданная скорость внутри полосы заменяется
+// ближайшей границей (resAvoid). Разгон сквозь полосу не запрещён.
+
+#define RES_MAX_PTS   128
+#define RES_MAX_BANDS 8
+#define RES_WIN       15         // окно базового уровня, точек
+
+struct ResPoint {
+  uint32_t hz;
+  uint32_t level;
+};
+
+struct ResBand {
+  uint32_t lo;
+  uint32_t hi;
+};
+
+struct ResParams {
+  uint16_t kQ8;        // порог над базой, Q8 (512 = в 2 раза)
+  uint32_t minLevel;   // ниже — не резонанс, как бы ни выделялся
+  uint16_t marginPm;   // расширение полосы, промилле частоты
+};
+
+static inline uint32_t resBaseline(const ResPoint* p, uint16_t n, uint16_t i) {
+  int32_t a = (int32_t)i - RES_WIN / 2, b = (int32_t)i + RES_WIN / 2;
+  if (a < 0) a = 0;
+  if (b >= n) b = n - 1;
+
+  uint32_t v[RES_WIN];
+  uint8_t m = 0;
+  for (int32_t k = a; k <= b; k++) {
+    uint32_t x = p[k].level;
+    uint8_t j = m++;
+    while (j > 0 && v[j - 1] > x) { v[j] = v[j - 1]; j--; }
+    v[j] = x;
+  }
+  return v[m / 4];
+}
+
+// Разбор прохода (точки по возрастанию hz). Возвращает число полос,
+// по возрастанию частоты; если полос больше RES_MAX_BANDS — остаются сильнейшие.
+static inline uint8_t resAnalyze(const ResPoint* p, uint16_t n, const ResParams& c, ResBand* out) {
+  ResBand band[RES_MAX_BANDS];
+  uint32_t peak[RES_MAX_BANDS];
+  uint8_t nb = 0;
+
+  uint16_t i = 0;
+  while (i < n) {
+    auto hot = [&](uint16_t k) {
+      return p[k].level >= c.minLevel &&
+             (uint64_t)p[k].level * 256 > (uint64_t)resBaseline(p, n, k) * c.kQ8;
+    };
+    if (!hot(i)) { i++; continue; }
+
+    uint16_t s = i;
+    uint32_t pk = 0;
+    while (i < n && hot(i)) { if (p[i].level > pk) pk = p[i].level; i++; }
+    uint16_t e = i - 1;
+
+    uint32_t lo = s ? (p[s - 1].hz + p[s].hz) / 2 : p[s].hz;
+    uint32_t hi = (e + 1 < n) ? (p[e].hz + p[e + 1].hz) / 2 : p[e].hz;
+    uint32_t dlo = (uint32_t)((uint64_t)lo * c.marginPm / 1000);
+    lo = lo > dlo + 1 ? lo - dlo : 1;
+    hi += (uint32_t)((uint64_t)hi * c.marginPm / 1000);
+
+    // слияние с предыдущей, если запас их сомкнул
+    if (nb && lo <= band[nb - 1].hi) {
+      band[nb - 1].hi = hi;
+      if (pk > peak[nb - 1]) peak[nb - 1] = pk;
+      continue;
+    }
+    if (nb < RES_MAX_BANDS) {
+      band[nb] = {lo, hi};
+      peak[nb++] = pk;
+      continue;
+    }
+    // мест нет — вытесняем самую слабую, порядок по частоте сохраняем
+    uint8_t w = 0;
+    for (uint8_t k = 1; k < nb; k++) if (peak[k] < peak[w]) w = k;
+    if (peak[w] >= pk) continue;
+    for (uint8_t k = w; k + 1 < nb; k++) { band[k] = band[k + 1]; peak[k] = peak[k + 1]; }
+    band[nb - 1] = {lo, hi};
+    peak[nb - 1] = pk;
+  }
+
+  for (uint8_t k = 0; k < nb; k++) out[k] = band[k];
+  return nb;
+}
+
+// Скорость вне полос: внутри полосы — ближайшая граница.
+static inline uint32_t resAvoid(const ResBand* b, uint8_t n, uint32_t hz) {
+  for (uint8_t k = 0; k < n; k++) {
+    if (hz < b[k].lo || hz > b[k].hi) continue;
+    uint32_t down = b[k].lo > 1 ? b[k].lo - 1 : 1;
+    uint32_t up = b[k].hi + 1;
+    return (hz - down <= up - hz) ? down : up;
+  }
+  return hz;
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <stdint.h>
+#include <math.h>
+
+// Input shaping команды скорости: свёртка с набором импульсов
+// (ZV / ZVD / EI), рассчитанных на частоту и демпфирование резонанса.
+// Сумма амплитуд = 1, поэтому установившаяся скорость не меняется,
+// а колебания, возбуждённые изломами рампы, гасят друг друга.
+//
+// Работает с фиксированным тиком: история скоростей в кольцевом буфере,
+// задержки импульсов в тиках Q8 с линейной интерполяцией между тиками.
+// Конфигурация считается во float (редко), сам тик — целочисленный.
+
+#define SHAPE_HIST   512     // тиков истории; при тике 1 мс — резонансы от ~2 Гц
+#define SHAPE_IMP    3
+#define SHAPE_EI_V   0.05f   // допуск остаточной вибрации для EI
+
+enum ShapeType : uint8_t { SHAPE_NONE, SHAPE_ZV, SHAPE_ZVD, SHAPE_EI };
+
+struct Shaper {
+  uint8_t  n;
+  uint16_t amp[SHAPE_IMP];     // Q15, сумма ровно 32768
+  uint32_t delay[SHAPE_IMP];   // тики, Q8
+  int32_t  hist[SHAPE_HIST];
+  uint16_t head;
+};
+
+static inline void shaperReset(Shaper& s, int32_t v) {
+  for (uint16_t i = 0; i < SHAPE_HIST; i++) s.hist[i] = v;
+  s.head = 0;
+}
+
+// false — частота вне диапазона для длины истории.
+static inline bool shaperConfig(Shaper& s, uint8_t type, float hz, float zeta, uint32_t tick_us) {
+  s.n = 1;
+  s.amp[0] = 32768;
+  s.delay[0] = 0;
+  if (type == SHAPE_NONE) return true;
+
+  if (hz <= 0 || zeta < 0 || zeta >= 1) return false;
+  float wd = sqrtf(1 - zeta * zeta);
+  float td = 1e6f / (hz * wd) / tick_us;          // период затухающих колебаний, тики
+  if (td >= SHAPE_HIST - 2) return false;
+
+  float k = expf(-zeta * (float)M_PI / wd);
+  float a[SHAPE_IMP];
+
+  if (type == SHAPE_ZV) {
+    s.n = 2;
+    a[0] = 1 / (1 + k);
+    a[1] = k / (1 + k);
+  } else if (type == SHAPE_ZVD) {
+    float d = (1 + k) * (1 + k);
+    s.n = 3;
+    a[0] = 1 / d;
+    a[1] = 2 * k / d;
+    a[2] = k * k / d;
+  } else if (type == SHAPE_EI) {
+    s.n = 3;
+    a[0] = (1 + SHAPE_EI_V) / 4;
+    a[1] = (1 - SHAPE_EI_V) / 2;
+    a[2] = (1 + SHAPE_EI_V) / 4;
+  } else {
+    return false;
+  }
+
+  uint32_t sum = 0;
+  for (uint8_t i = 0; i < s.n; i++) {
+    s.delay[i] = (uint32_t)(td * 0.5f * i * 256 + 0.5f);
+    s.amp[i] = (uint16_t)(a[i] * 32768 + 0.5f);
+    sum += s.amp[i];
+  }
+  s.amp[0] += (int32_t)32768 - (int32_t)sum;
+  return true;
+}
+
+// Очередной отсчёт команды -> сформированный отсчёт.
+static inline int32_t shaperPush(Shaper& s, int32_t v) {
+  s.head = (s.head + 1) % SHAPE_HIST;
+  s.hist[s.head] = v;
+
+  int64_t acc = 0;
+  for (uint8_t i = 0; i < s.n; i++) {
+    uint32_t d = s.delay[i] >> 8;
+    uint32_t fr = s.delay[i] & 0xFF;
+    int32_t x0 = s.hist[(s.head + SHAPE_HIST - d) % SHAPE_HIST];
+    int32_t x1 = s.hist[(s.head + SHAPE_HIST - d - 1) % SHAPE_HIST];
+    int32_t x = x0 + (int32_t)(((int64_t)(x1 - x0) * fr) >> 8);
+    acc += (int64_t)s.amp[i] * x;
+  }
+  return (int32_t)((acc + 16384) >> 15);
+}
+
+// Трапециевидная команда скорости до формирования.
+static inline int32_t shapeRamp(int32_t v, int32_t target, uint32_t acc, uint32_t dt_us) {
+  int32_t dv = (int32_t)((uint64_t)acc * dt_us / 1000000);
+  if (dv < 1) dv = 1;
+  if (target > v + dv) return v + dv;
+  if (target < v - dv) return v - dv;
+  return target;
+}
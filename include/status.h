@@ -0,0 +1,152 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "motion.h"
+#include "trig.h"
+
+// Кэш ответа /api/status. Снимок всех полей (StatusSnap) берётся не чаще
+// STATUS_MIN_MS; если он побайтно совпал с прошлым, поколение не растёт
+// и все опрашивающие получают уже закодированный JSON. Поколение — ETag:
+// клиент с тем же If-None-Match получает 304 без тела. Отсчёт поколений
+// начинается со случайного числа (statusInit при загрузке), иначе после
+// перезагрузки ETag и since=<gen> совпали бы со старыми при другом
+// состоянии — 304 или зависший long-poll вместо свежего ответа. Ввода-вывода
+// здесь нет, так что и снимок, и кодирование проверяются на хосте
+// (tools/status_bench.cpp).
+
+#ifndef STATUS_MIN_MS
+#define STATUS_MIN_MS 50
+#endif
+
+#define STATUS_JSON_MAX 1024
+
+// Поля ответа, в порядке JSON. Упакована — для memcmp без мусора в
+// выравнивании.
+struct __attribute__((packed)) StatusSnap {
+  uint8_t  runReq, running, dir, en, alarm, mo;
+  uint8_t  cam, camMaster, mpg, ain, shape, pvt, sc, arc, scan, tune, wifiFast;
+  uint8_t  restored, reset, pf, pfRestored, resBands, trig;
+  uint16_t mpgScale, ainRaw, shapeHz, shapeZeta, pvtLevel, scLevel, scanPts;
+  uint32_t freq, acc, ainSps, ainUps, pvtUnderflow, scUnderflow, scRate;
+  uint32_t tuneAccel, tuneOldUs, tuneNewUs, wifiMs, wifiDrops, pfSaveUs, pfSaveMaxUs, trigNs;
+  uint32_t lifeRunS, lifeRev, lifePeakHz, lifeAlarms;
+  uint64_t lifeSteps;
+  int32_t  camPos, arcS, arcLen, pos;
+};
+
+struct StatusCache {
+  StatusSnap snap;
+  char json[STATUS_JSON_MAX];
+  size_t len;
+  char etag[14];                 // "\"<gen>\"", с кавычками
+  uint32_t gen;                  // не 0; с первым снимком — seed + 1
+  bool     ready;                // снимок уже был
+  uint32_t takenMs;
+  uint32_t encodes, hits, notModified;
+};
+
+static inline size_t statusJson(const StatusSnap& s, uint32_t gen, char* out, size_t cap) {
+  int n = snprintf(out, cap,
+           "{\"gen\":%lu,\"state\":\"%s\",\"runReq\":%d,\"running\":%d,\"freq\":%lu,\"acc\":%lu,\"dir\":%u,\"en\":%u,\"alarm\":%d,"
+           "\"cam\":%d,\"camMaster\":%u,\"camPos\":%ld,\"mpg\":%d,\"mpgScale\":%u,"
+           "\"ain\":%d,\"ainRaw\":%u,\"ainSps\":%lu,\"ainUps\":%lu,"
+           "\"shape\":%u,\"shapeHz\":%u,\"shapeZeta\":%u,"
+           "\"pvt\":%u,\"pvtLevel\":%u,\"pvtUnderflow\":%lu,"
+           "\"sc\":%u,\"scLevel\":%u,\"scUnderflow\":%lu,\"scRate\":%lu,"
+           "\"arc\":%d,\"arcS\":%ld,\"arcLen\":%ld,"
+           "\"scan\":%u,\"scanPts\":%u,\"resBands\":%u,"
+           "\"tune\":%u,\"tuneAccel\":%lu,\"tuneOldUs\":%lu,\"tuneNewUs\":%lu,"
+           "\"trig\":\"%s\",\"trigNs\":%lu,"
+           "\"lifeSteps\":%llu,\"lifeRunS\":%lu,\"lifeRev\":%lu,\"lifePeakHz\":%lu,\"lifeAlarms\":%lu,"
+           "\"wifiMs\":%lu,\"wifiFast\":%u,\"wifiDrops\":%lu,"
+           "\"pos\":%ld,\"restored\":%u,\"reset\":%u,"
+           "\"pf\":%d,\"pfRestored\":%d,\"pfSaveUs\":%lu,\"pfSaveMaxUs\":%lu}",
+           (unsigned long)gen,
+           moStateName(s.mo),
+           (int)s.runReq,
+           (int)s.running,
+           (unsigned long)s.freq,
+           (unsigned long)s.acc,
+           (unsigned)s.dir,
+           (unsigned)s.en,
+           (int)s.alarm,
+           (int)s.cam,
+           (unsigned)s.camMaster,
+           (long)s.camPos,
+           (int)s.mpg,
+           (unsigned)s.mpgScale,
+           (int)s.ain,
+           (unsigned)s.ainRaw,
+           (unsigned long)s.ainSps,
+           (unsigned long)s.ainUps,
+           (unsigned)s.shape,
+           (unsigned)s.shapeHz,
+           (unsigned)s.shapeZeta,
+           (unsigned)s.pvt,
+           (unsigned)s.pvtLevel,
+           (unsigned long)s.pvtUnderflow,
+           (unsigned)s.sc,
+           (unsigned)s.scLevel,
+           (unsigned long)s.scUnderflow,
+           (unsigned long)s.scRate,
+           (int)s.arc,
+           (long)s.arcS,
+           (long)s.arcLen,
+           (unsigned)s.scan,
+           (unsigned)s.scanPts,
+           (unsigned)s.resBands,
+           (unsigned)s.tune,
+           (unsigned long)s.tuneAccel,
+           (unsigned long)s.tuneOldUs,
+           (unsigned long)s.tuneNewUs,
+           trigStateName(s.trig),
+           (unsigned long)s.trigNs,
+           (unsigned long long)s.lifeSteps,
+           (unsigned long)s.lifeRunS,
+           (unsigned long)s.lifeRev,
+           (unsigned long)s.lifePeakHz,
+           (unsigned long)s.lifeAlarms,
+           (unsigned long)s.wifiMs,
+           (unsigned)s.wifiFast,
+           (unsigned long)s.wifiDrops,
+           (long)s.pos,
+           (unsigned)s.restored,
+           (unsigned)s.reset,
+           (int)s.pf,
+           (int)s.pfRestored,
+           (unsigned long)s.pfSaveUs,
+           (unsigned long)s.pfSaveMaxUs);
+  return (n < 0) ? 0 : ((size_t)n < cap ? (size_t)n : cap - 1);
+}
+
+// До первого снимка; seed — на каждую загрузку свой (esp_random).
+static inline void statusInit(StatusCache& c, uint32_t seed) {
+  c.gen = seed;
+  c.ready = false;
+}
+
+// Снимок устарел? Тогда take(snap) заполняет новый; поколение растёт,
+// только если он отличается. true — кэш перекодирован.
+template <typename F>
+static inline bool statusRefresh(StatusCache& c, uint32_t nowMs, F take) {
+  if (c.ready && nowMs - c.takenMs < STATUS_MIN_MS) return false;
+  c.takenMs = nowMs;
+
+  StatusSnap s;
+  memset(&s, 0, sizeof(s));
+  take(s);
+  if (c.ready && !memcmp(&s, &c.snap, sizeof(s))) return false;
+
+  c.snap = s;
+  c.gen++;
+  if (!c.gen) c.gen = 1;
+  c.ready = true;
+  c.len = statusJson(s, c.gen, c.json, sizeof(c.json));
+  snprintf(c.etag, sizeof(c.etag), "\"%lu\"", (unsigned long)c.gen);
+  c.encodes++;
+  return true;
+}
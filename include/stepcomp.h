@@ -0,0 +1,200 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Сжатые команды шагов: хост планирует движение сам и присылает
+// последовательности шагов в виде {interval, count, add}: шаг k (1..count)
+// идёт через interval + (k-1)*add тиков после предыдущего. Тики —
+// 16 МГц, как у очереди FastAccelStepper.
+//
+// Здесь же:
+//   - итератор, разворачивающий команды обратно в интервалы (устройство);
+//   - группировка интервалов в записи очереди FAS (у записи один период
+//     на все шаги, не больше SC_GROUP_MAX шагов и не короче SC_MIN_TICKS);
+//   - компрессор произвольной последовательности времён шагов (хост).
+//
+// Пакет (little-endian): 'S' 'C' ver flags seq:u32, затем команды по 8 байт
+//   {interval:u16 count:u16 add:i16 dir:u8 0}
+// Ответ: 'S' 'S' state drops:u8 seq:u32 level:u16 free:u16
+
+#define SC_VER        1
+#define SC_F_START    0x01
+#define SC_F_END      0x02
+#define SC_HDR        8
+#define SC_CMD_BYTES  8
+#define SC_MAX_CMDS   160
+#define SC_BUF        512        // степень двойки
+#define SC_REPLY      12
+
+#define SC_GROUP_MAX  127        // шагов в записи очереди FAS
+#define SC_MIN_TICKS  3200       // мин. длительность записи FAS (200 мкс)
+#define SC_MIN_IVL    40         // тиков, 400 кГц
+
+struct StepCmd {
+  uint16_t interval;
+  uint16_t count;
+  int16_t  add;
+  uint8_t  dir;
+};
+
+struct StepCmdBuffer {
+  StepCmd c[SC_BUF];
+  volatile uint16_t head;
+  volatile uint16_t tail;
+  volatile bool     ended;
+};
+
+static inline uint16_t scLevel(const StepCmdBuffer& b) { return (uint16_t)((b.head - b.tail) & (SC_BUF - 1)); }
+static inline uint16_t scFree(const StepCmdBuffer& b)  { return SC_BUF - 1 - scLevel(b); }
+
+static inline bool scPush(StepCmdBuffer& b, const StepCmd& c) {
+  if (!scFree(b)) return false;
+  b.c[b.head] = c;
+  b.head = (b.head + 1) & (SC_BUF - 1);
+  return true;
+}
+
+static inline void scEncode(uint8_t* p, const StepCmd& c) {
+  p[0] = (uint8_t)c.interval; p[1] = (uint8_t)(c.interval >> 8);
+  p[2] = (uint8_t)c.count;    p[3] = (uint8_t)(c.count >> 8);
+  p[4] = (uint8_t)c.add;      p[5] = (uint8_t)((uint16_t)c.add >> 8);
+  p[6] = c.dir;
+  p[7] = 0;
+}
+
+static inline void scDecode(const uint8_t* p, StepCmd& c) {
+  c.interval = (uint16_t)(p[0] | (p[1] << 8));
+  c.count    = (uint16_t)(p[2] | (p[3] << 8));
+  c.add      = (int16_t)(uint16_t)(p[4] | (p[5] << 8));
+  c.dir      = p[6] ? 1 : 0;
+}
+
+// Все интервалы команды должны лечь в [SC_MIN_IVL, 65535].
+static inline bool scValid(const StepCmd& c) {
+  if (!c.count) return false;
+  int32_t first = c.interval;
+  int32_t last = first + (int32_t)c.add * (c.count - 1);
+  return first >= SC_MIN_IVL && last >= SC_MIN_IVL && first <= 65535 && last <= 65535;
+}
+
+// ----- Разворачивание на устройстве -----
+
+struct StepIter {
+  StepCmd  cur;
+  uint16_t left;     // шагов осталось в cur
+  int32_t  ivl;      // интервал следующего шага
+  uint32_t rem;      // остаток от округления периода группы, тики * шаги
+  uint32_t loaded;   // команд взято из буфера
+};
+
+static inline bool scIterLoad(StepIter& it, StepCmdBuffer& b) {
+  if (it.left) return true;
+  if (!scLevel(b)) return false;
+  it.cur = b.c[b.tail];
+  b.tail = (b.tail + 1) & (SC_BUF - 1);
+  it.left = it.cur.count;
+  it.ivl = it.cur.interval;
+  it.loaded++;
+  return true;
+}
+
+// Собирает следующую запись очереди: steps шагов с периодом ticks.
+// Группа не пересекает смену направления; false — команд больше нет.
+static inline bool scNextGroup(StepIter& it, StepCmdBuffer& b, uint16_t& ticks, uint8_t& steps, uint8_t& dir) {
+  if (!scIterLoad(it, b)) return false;
+
+  dir = it.cur.dir;
+  uint32_t sum = 0;
+  uint8_t n = 0;
+
+  while (n < SC_GROUP_MAX && sum < SC_MIN_TICKS) {
+    if (!it.left) {
+      if (!scLevel(b) || b.c[b.tail].dir != dir) break;
+      scIterLoad(it, b);
+    }
+    sum += (uint32_t)it.ivl;
+    it.ivl += it.cur.add;
+    it.left--;
+    n++;
+  }
+
+  // равномерный период по группе; дробная часть переносится в следующую
+  sum += it.rem;
+  uint32_t t = sum / n;
+  it.rem = sum - t * n;
+  if (t * n < SC_MIN_TICKS) t = (SC_MIN_TICKS + n - 1) / n;    // короткий хвост у смены направления
+  if (t > 65535) t = 65535;
+
+  ticks = (uint16_t)t;
+  steps = n;
+  return true;
+}
+
+// ----- Компрессор (хост) -----
+
+// Время шага k (1..n) сегмента от t0: t0 + k*I + add*k(k-1)/2.
+static inline int64_t scPredict(int64_t t0, int64_t ivl, int64_t add, int64_t k) {
+  return t0 + k * ivl + add * k * (k - 1) / 2;
+}
+
+// Подбор add для сегмента t[0..n-1] от t0 с первым интервалом ivl
+// (по последнему шагу) и проверка допуска на всех шагах.
+static inline bool scFit(const uint64_t* t, size_t n, int64_t t0, int64_t ivl, int64_t tol, int64_t& add) {
+  if (n == 1) { add = 0; return true; }
+  int64_t span = (int64_t)t[n - 1] - t0 - (int64_t)n * ivl;
+  int64_t den = (int64_t)n * (n - 1) / 2;
+  add = (span >= 0) ? (span + den / 2) / den : -((-span + den / 2) / den);
+  if (add > 32767 || add < -32768) return false;
+
+  for (size_t k = 0; k < n; k++) {
+    int64_t e = scPredict(t0, ivl, add, k + 1) - (int64_t)t[k];
+    if (e > tol || e < -tol) return false;
+  }
+  int64_t last = ivl + add * (int64_t)(n - 1);
+  return last >= SC_MIN_IVL && last <= 65535;
+}
+
+// Сжатие возрастающих времён шагов t[0..n-1] (тики, от t0) одного
+// направления. Ошибка каждого шага не больше tol; ошибка не копится,
+// т.к. следующий сегмент стартует с предсказанного времени.
+// Возвращает число команд (0 — не влезло в cap или интервал вне диапазона).
+static inline size_t scCompress(const uint64_t* t, size_t n, uint64_t t0, uint8_t dir, uint32_t tol,
+                                StepCmd* out, size_t cap) {
+  size_t i = 0, m = 0;
+  int64_t base = (int64_t)t0;
+
+  while (i < n) {
+    if (m >= cap) return 0;
+
+    int64_t ivl = (int64_t)t[i] - base;
+    if (ivl < SC_MIN_IVL && ivl + (int64_t)tol >= SC_MIN_IVL) ivl = SC_MIN_IVL;
+    if (ivl < SC_MIN_IVL || ivl > 65535) return 0;
+
+    // удваиваем длину, пока подходит, затем бисекция
+    size_t good = 1, bad = 0;
+    int64_t add = 0, a;
+    size_t lim = n - i < 65535 ? n - i : 65535;
+    while (good < lim) {
+      size_t len = good * 2 < lim ? good * 2 : lim;
+      if (scFit(&t[i], len, base, ivl, tol, a)) { good = len; add = a; }
+      else { bad = len; break; }
+    }
+    while (bad && bad - good > 1) {
+      size_t mid = (good + bad) / 2;
+      if (scFit(&t[i], mid, base, ivl, tol, a)) { good = mid; add = a; }
+      else bad = mid;
+    }
+    if (good == 1) add = 0;
+
+    out[m].interval = (uint16_t)ivl;
+    out[m].count = (uint16_t)good;
+    out[m].add = (int16_t)add;
+    out[m].dir = dir;
+    m++;
+
+    base = scPredict(base, ivl, add, good);
+    i += good;
+  }
+  return m;
+}
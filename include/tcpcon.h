@@ -0,0 +1,203 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+// Консоль по TCP: до TCON_MAX сессий в одной задаче на неблокирующих
+// сокетах (lwip на ESP32, BSD на хосте — см. tools/tcon_check.cpp).
+// Разбор строк — свой у каждой сессии, команды выполняет вызывающий.
+//
+// У каждой сессии своё кольцо вывода TCON_OUT. Отправка — сколько
+// возьмёт сокет, без ожидания, так что медленный клиент не тормозит
+// остальных. Пока кольцо заполнено больше чем наполовину, ввод сессии
+// не читается: новые команды ждут в TCP, а не плодят вывод, который
+// некуда деть. Вывод одной команды сверх места в кольце отбрасывается
+// с пометкой. Сессию, которая не принимает ничего TCON_STALL_MS,
+// закрываем.
+
+#ifndef TCON_MAX
+#define TCON_MAX 3
+#endif
+#ifndef TCON_LINE
+#define TCON_LINE 96
+#endif
+#ifndef TCON_OUT
+#define TCON_OUT 4096
+#endif
+#ifndef TCON_STALL_MS
+#define TCON_STALL_MS 10000
+#endif
+
+struct TconSession {
+  int fd;                      // -1 — свободна
+  char line[TCON_LINE];
+  uint16_t n;
+  uint8_t iac;                 // осталось пропустить байт telnet-согласования
+  uint8_t out[TCON_OUT];
+  uint32_t head, len;          // кольцо вывода
+  uint32_t lost;               // отброшено с последней пометки
+  uint32_t stallMs;            // с какого момента кольцо не двигается
+};
+
+struct Tcon {
+  int lfd;
+  TconSession s[TCON_MAX];
+  uint32_t accepted, rejected, kicked, lost;
+};
+
+static inline void tconPut(TconSession& s, const char* p, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    // telnet ждёт CRLF; println() уже даёт CRLF — не удваиваем
+    bool nl = (p[i] == '\n') && !(s.len && s.out[(s.head + s.len - 1) % TCON_OUT] == '\r');
+    if (s.len + (nl ? 2 : 1) > TCON_OUT) {
+      s.lost += (uint32_t)(n - i);
+      return;
+    }
+    if (nl) s.out[(s.head + s.len++) % TCON_OUT] = '\r';
+    s.out[(s.head + s.len++) % TCON_OUT] = (uint8_t)p[i];
+  }
+}
+
+static inline void tconPuts(TconSession& s, const char* p) {
+  tconPut(s, p, strlen(p));
+}
+
+static inline bool tconBegin(Tcon& t, uint16_t port) {
+  memset(&t, 0, sizeof(t));
+  for (TconSession& s : t.s) s.fd = -1;
+
+  t.lfd = socket(AF_INET, SOCK_STREAM, 0);
+  if (t.lfd < 0) return false;
+  int one = 1;
+  setsockopt(t.lfd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+  sockaddr_in a;
+  memset(&a, 0, sizeof(a));
+  a.sin_family = AF_INET;
+  a.sin_port = htons(port);
+  a.sin_addr.s_addr = htonl(INADDR_ANY);
+  if (bind(t.lfd, (sockaddr*)&a, sizeof(a)) < 0 || listen(t.lfd, 2) < 0) {
+    close(t.lfd);
+    t.lfd = -1;
+    return false;
+  }
+  fcntl(t.lfd, F_SETFL, fcntl(t.lfd, F_GETFL, 0) | O_NONBLOCK);
+  return true;
+}
+
+static inline void tconClose(TconSession& s) {
+  if (s.fd >= 0) close(s.fd);
+  s.fd = -1;
+}
+
+static inline int tconCount(const Tcon& t) {
+  int c = 0;
+  for (const TconSession& s : t.s) c += (s.fd >= 0);
+  return c;
+}
+
+// Отдать сокету сколько возьмёт. false — соединение закрыто.
+static inline bool tconFlush(Tcon& t, TconSession& s, uint32_t now) {
+  if (!s.len && s.lost) {
+    char note[40];
+    int k = snprintf(note, sizeof(note), "\n[%lu bytes dropped]\n", (unsigned long)s.lost);
+    t.lost += s.lost;
+    s.lost = 0;
+    tconPut(s, note, (size_t)k);
+  }
+
+  bool moved = false;
+  while (s.len) {
+    uint32_t chunk = TCON_OUT - s.head;
+    if (chunk > s.len) chunk = s.len;
+    ssize_t r = send(s.fd, s.out + s.head, chunk, MSG_DONTWAIT);
+    if (r < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+    if (r <= 0) return false;
+    s.head = (s.head + (uint32_t)r) % TCON_OUT;
+    s.len -= (uint32_t)r;
+    moved = true;
+    if ((uint32_t)r < chunk) break;
+  }
+
+  if (!s.len || moved) s.stallMs = now;
+  return now - s.stallMs < TCON_STALL_MS;
+}
+
+// Один проход: принять новых, отдать вывод, прочитать ввод.
+// exec(s, line) — строка без перевода строки; line == nullptr — новая
+// сессия (приветствие). Вывод — через tconPut(s, ...).
+template <typename F>
+static inline void tconPoll(Tcon& t, uint32_t now, F exec) {
+  if (t.lfd < 0) return;
+
+  int fd;
+  while ((fd = accept(t.lfd, nullptr, nullptr)) >= 0) {
+    TconSession* s = nullptr;
+    for (TconSession& x : t.s) if (x.fd < 0) { s = &x; break; }
+    if (!s) {
+      static const char busy[] = "busy\r\n";
+      send(fd, busy, sizeof(busy) - 1, MSG_DONTWAIT);
+      close(fd);
+      t.rejected++;
+      continue;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    memset(s, 0, sizeof(*s));
+    s->fd = fd;
+    s->stallMs = now;
+    t.accepted++;
+    exec(*s, (char*)nullptr);
+  }
+
+  for (TconSession& s : t.s) {
+    if (s.fd < 0) continue;
+    if (!tconFlush(t, s, now)) {
+      if (s.len) t.kicked++;
+      t.lost += s.lost;
+      tconClose(s);
+      continue;
+    }
+
+    // вывод не уходит — команды не читаем, пусть ждут в TCP. Читаем
+    // с MSG_PEEK и забираем только разобранное: после команды, которая
+    // заполнила кольцо, остаток ввода остаётся в сокете.
+    while (s.fd >= 0 && s.len <= TCON_OUT / 2) {
+      uint8_t b[64];
+      ssize_t r = recv(s.fd, b, sizeof(b), MSG_PEEK | MSG_DONTWAIT);
+      if (r < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+      if (r <= 0) {
+        tconClose(s);
+        break;
+      }
+      ssize_t used = 0;
+      while (used < r && s.len <= TCON_OUT / 2) {
+        uint8_t c = b[used++];
+        if (s.iac) {
+          // IAC WILL/WONT/DO/DONT <opt> — ещё байт
+          s.iac = (s.iac == 2 && c >= 251 && c <= 254) ? 1 : 0;
+          continue;
+        }
+        if (c == 0xFF) { s.iac = 2; continue; }
+        if (c == '\r' || c == 0) continue;
+        if (c == '\n') {
+          s.line[s.n] = 0;
+          s.n = 0;
+          exec(s, s.line);
+          continue;
+        }
+        if (s.n < TCON_LINE - 1) s.line[s.n++] = (char)c;
+      }
+      recv(s.fd, b, (size_t)used, MSG_DONTWAIT);
+    }
+  }
+}
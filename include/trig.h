@@ -0,0 +1,169 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <math.h>
+
+#include "stepcomp.h"
+
+// Старт по внешнему фронту. При взведении (arm) рампа разгона до
+// заданной скорости заранее считается в записи очереди FastAccelStepper
+// {ticks, steps}: TRIG_PRIME записей кладутся в очередь без запуска,
+// следующая ждёт в памяти. По фронту StepTask (его будит прерывание)
+// только добавляет её с запуском очереди — никакой арифметики между
+// фронтом и первым шагом.
+// Дальше StepTask доливает очередь тем же генератором: разгон, ход,
+// торможение до нуля по stop.
+//
+// Генератор — равноускоренное движение по шагам: e = v^2 / 2a (в шагах)
+// растёт на 1 с каждым шагом разгона и убывает при торможении, время
+// перехода e1 -> e2 — sqrt(2/a) * |e2 - e1| / (sqrt(e2) + sqrt(e1)) (в такой
+// форме нет вычитания близких чисел во float). Шаги группируются,
+// как в stepcomp.h: не больше SC_GROUP_MAX и не короче SC_MIN_TICKS.
+// Проверка на хосте — tools/trig_check.cpp.
+
+#ifndef TRIG_PRIME
+#define TRIG_PRIME 8             // записей в очереди до фронта
+#endif
+
+#define TRIG_TICKS_S 16000000.0f // тики очереди FAS
+
+// Длительность записи, к которой стремится генератор: с запасом над
+// SC_MIN_TICKS на округление периода и перенос остатка.
+#define TRIG_GROUP_TICKS (SC_MIN_TICKS + 2 * SC_GROUP_MAX)
+
+enum TrigState : uint8_t {
+  TRIG_IDLE,
+  TRIG_ARMED,        // очередь заполнена, ждём фронт
+  TRIG_RUN,
+  TRIG_DONE,         // остановились по stop
+  TRIG_ABORT         // авария, en=0, снят до фронта
+};
+
+struct TrigRamp {
+  float a;           // шагов/с^2
+  uint32_t e;        // текущая скорость как v^2 / 2a, шагов
+  float eT;          // цель так же
+  float hz;          // цель, Гц (0 — стоп)
+  float rem;         // дробные тики, переносятся в следующую запись
+  uint32_t steps;    // выдано шагов
+  uint16_t pauseTicks;
+  uint16_t pauses;   // записей-пауз (steps = 0) до следующего шага
+};
+
+static inline const char* trigStateName(uint8_t s) {
+  switch (s) {
+    case TRIG_ARMED: return "armed";
+    case TRIG_RUN:   return "run";
+    case TRIG_DONE:  return "done";
+    case TRIG_ABORT: return "abort";
+    default:         return "idle";
+  }
+}
+
+static inline void trigRampTarget(TrigRamp& r, uint32_t hz) {
+  r.hz = (float)hz;
+  r.eT = r.hz * r.hz / (2.0f * r.a);
+}
+
+static inline void trigRampInit(TrigRamp& r, uint32_t hz, uint32_t accel) {
+  r.a = accel ? (float)accel : 1.0f;
+  r.e = 0;
+  r.rem = 0;
+  r.steps = 0;
+  r.pauses = 0;
+  trigRampTarget(r, hz);
+}
+
+// Следующая запись: steps шагов с периодом ticks. Запись может
+// захватить конец одной фазы и начало следующей, чтобы не выйти короче
+// SC_MIN_TICKS; короче бывает только последняя перед остановкой — её
+// период растягивается, как хвост в scNextGroup. Шаг медленнее 65535
+// тиков (~245 Гц, начало разгона с малым ускорением) дополняется
+// записями-паузами: шаг идёт в начале своей записи, пауза — после.
+// false — стоим и цель ноль, шагов больше не будет.
+static inline bool trigRampNext(TrigRamp& r, uint16_t& ticks, uint8_t& steps) {
+  if (r.pauses) {
+    r.pauses--;
+    ticks = r.pauseTicks;
+    steps = 0;
+    return true;
+  }
+
+  const float k = TRIG_TICKS_S * sqrtf(2.0f / r.a);     // тиков на единицу sqrt(e)
+  float T = 0;
+  uint32_t n = 0;
+
+  while (n < SC_GROUP_MAX && T < TRIG_GROUP_TICKS) {
+    // фаза и сколько шагов в ней осталось
+    int phase;                   // +1 разгон, 0 ход, -1 торможение
+    float e = (float)r.e;
+    float room;
+    if (e + 1.0f <= r.eT) {
+      phase = 1;
+      room = floorf(r.eT - e);
+    } else if (r.e && (r.hz == 0 || e - 1.0f >= r.eT)) {
+      phase = -1;
+      room = r.hz == 0 ? e : floorf(e - r.eT);
+    } else if (r.hz > 0) {
+      phase = 0;
+      room = SC_GROUP_MAX;
+    } else {
+      break;
+    }
+
+    // шагов — сколько нужно до TRIG_GROUP_TICKS по текущей скорости
+    float v = phase == 0 ? r.hz : sqrtf(2.0f * r.a * (r.e ? e : 1.0f));
+    float m = ceilf((TRIG_GROUP_TICKS - T) * v / TRIG_TICKS_S);
+    if (m < 1) m = 1;
+    if (m > SC_GROUP_MAX - n) m = (float)(SC_GROUP_MAX - n);
+    if (m > room) m = room;
+
+    if (phase == 0) {
+      T += m * TRIG_TICKS_S / r.hz;
+    } else {
+      uint32_t e2 = phase > 0 ? r.e + (uint32_t)m : r.e - (uint32_t)m;
+      T += k * m / (sqrtf((float)e2) + sqrtf(e));
+      r.e = e2;
+    }
+    n += (uint32_t)m;
+  }
+  if (!n) return false;
+
+  // целые тики; разница с точным временем (и с поправками ниже, тогда
+  // отрицательная) переносится в следующую запись
+  T += r.rem;
+  float t = floorf(T / n);
+  if (t * n < SC_MIN_TICKS) t = ceilf((float)SC_MIN_TICKS / n);
+  if (t < SC_MIN_IVL) t = SC_MIN_IVL;
+  float span = t * n;
+  if (t > 65535) {
+    // здесь n == 1: шаг и p - 1 пауз поровну
+    float p = ceilf(t / 65535.0f);
+    t = floorf(t / p);
+    span = t * p;
+    r.pauses = (uint16_t)(p - 1);
+    r.pauseTicks = (uint16_t)t;
+  }
+  r.rem = T - span;
+
+  ticks = (uint16_t)t;
+  steps = (uint8_t)n;
+  r.steps += n;
+  return true;
+}
+
+// Задержка фронт -> первый шаг, нс.
+struct TrigStats {
+  uint32_t n;
+  uint32_t lastNs, minNs, maxNs;
+  uint64_t sumNs;
+};
+
+static inline void trigStatsAdd(TrigStats& s, uint32_t ns) {
+  if (!s.n || ns < s.minNs) s.minNs = ns;
+  if (ns > s.maxNs) s.maxNs = ns;
+  s.lastNs = ns;
+  s.sumNs += ns;
+  s.n++;
+}
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+// Спектр вибрации: кадр из VIB_N отсчётов АЦП акселерометра, окно Ханна,
+// комплексное БПФ radix-2 в Q15 с масштабированием на каждом этапе
+// (выход = сумма / N, переполнения нет), модуль и пики с параболической
+// интерполяцией частоты. Таблицы синусов и окна считаются один раз
+// во float, само БПФ — целочисленное, одинаковое на устройстве и хосте.
+
+#define VIB_N       1024
+#define VIB_LOG2N   10
+#define VIB_PEAKS   4
+#define VIB_FLOOR_K 6          // пик — выше среднего уровня в VIB_FLOOR_K раз
+
+struct VibFft {
+  int16_t  cosT[VIB_N / 2];
+  int16_t  sinT[VIB_N / 2];
+  int16_t  win[VIB_N];
+  int16_t  re[VIB_N];
+  int16_t  im[VIB_N];
+  uint16_t mag[VIB_N / 2];
+};
+
+struct VibPeak {
+  uint32_t mhz;        // частота, мГц
+  uint16_t amp;        // модуль, отсчёты БПФ
+};
+
+static inline int16_t vibQ15(float v) {
+  float s = v * 32767.0f;
+  return (int16_t)(s >= 0 ? s + 0.5f : s - 0.5f);
+}
+
+static inline void vibInit(VibFft& f) {
+  for (int i = 0; i < VIB_N / 2; i++) {
+    float a = 2.0f * (float)M_PI * i / VIB_N;
+    f.cosT[i] = vibQ15(cosf(a));
+    f.sinT[i] = vibQ15(sinf(a));
+  }
+  for (int i = 0; i < VIB_N; i++) {
+    f.win[i] = vibQ15(0.5f - 0.5f * cosf(2.0f * (float)M_PI * i / VIB_N));
+  }
+}
+
+// Отсчёты АЦП (12 бит) -> re/im: без постоянной составляющей, окно,
+// бит-реверсная перестановка сразу при загрузке.
+static inline void vibLoad(VibFft& f, const uint16_t* x) {
+  int32_t sum = 0;
+  for (int i = 0; i < VIB_N; i++) sum += x[i];
+  int32_t dc = sum / VIB_N;
+
+  for (int i = 0; i < VIB_N; i++) {
+    uint32_t r = 0;
+    for (int b = 0; b < VIB_LOG2N; b++) r |= ((i >> b) & 1u) << (VIB_LOG2N - 1 - b);
+    int32_t v = (x[i] - dc) << 4;                       // 12 бит -> Q15
+    if (v > 32767) v = 32767;
+    if (v < -32768) v = -32768;
+    f.re[r] = (int16_t)((v * f.win[i] + 16384) >> 15);
+    f.im[r] = 0;
+  }
+}
+
+static inline int16_t vibMul(int16_t a, int16_t w) {
+  return (int16_t)(((int32_t)a * w + 16384) >> 15);
+}
+
+// БПФ с прореживанием по времени, вход уже переставлен vibLoad().
+static inline void vibFft(VibFft& f) {
+  for (int len = 2, step = VIB_N / 2; len <= VIB_N; len <<= 1, step >>= 1) {
+    int half = len >> 1;
+    for (int i = 0; i < VIB_N; i += len) {
+      for (int j = 0; j < half; j++) {
+        int16_t wr = f.cosT[j * step];
+        int16_t wi = f.sinT[j * step];
+        int a = i + j, b = a + half;
+        // W = e^{-i*phi}: (br + i*bi)(wr - i*wi)
+        int32_t tr = vibMul(f.re[b], wr) + vibMul(f.im[b], wi);
+        int32_t ti = vibMul(f.im[b], wr) - vibMul(f.re[b], wi);
+        int32_t ar = f.re[a], ai = f.im[a];
+        f.re[a] = (int16_t)((ar + tr) >> 1);
+        f.im[a] = (int16_t)((ai + ti) >> 1);
+        f.re[b] = (int16_t)((ar - tr) >> 1);
+        f.im[b] = (int16_t)((ai - ti) >> 1);
+      }
+    }
+  }
+}
+
+static inline uint16_t vibSqrt(uint32_t v) {
+  uint32_t r = 0, bit = 1u << 30;
+  while (bit > v) bit >>= 2;
+  while (bit) {
+    if (v >= r + bit) { v -= r + bit; r = (r >> 1) + bit; }
+    else r >>= 1;
+    bit >>= 2;
+  }
+  return (uint16_t)r;
+}
+
+static inline void vibMag(VibFft& f) {
+  for (int k = 0; k < VIB_N / 2; k++) {
+    int32_t r = f.re[k], i = f.im[k];
+    f.mag[k] = vibSqrt((uint32_t)(r * r) + (uint32_t)(i * i));
+  }
+}
+
+// Общий уровень вибрации кадра (RMS по спектру без постоянной составляющей).
+static inline uint32_t vibLevel(const VibFft& f) {
+  uint64_t e = 0;
+  for (int k = 1; k < VIB_N / 2; k++) e += (uint32_t)f.mag[k] * f.mag[k];
+  return (uint32_t)sqrtf((float)e);
+}
+
+// До VIB_PEAKS локальных максимумов над шумом, по убыванию амплитуды.
+// fs — частота дискретизации, Гц. Возвращает число пиков.
+static inline uint8_t vibPeaks(const VibFft& f, uint32_t fs, VibPeak* out) {
+  uint32_t sum = 0;
+  for (int k = 1; k < VIB_N / 2; k++) sum += f.mag[k];
+  uint32_t floor = sum / (VIB_N / 2 - 1) * VIB_FLOOR_K + 1;
+
+  uint8_t n = 0;
+  for (int k = 2; k < VIB_N / 2 - 1; k++) {
+    uint16_t m = f.mag[k];
+    if (m < floor || m < f.mag[k - 1] || m <= f.mag[k + 1]) continue;
+
+    // вершина параболы по трём точкам, смещение в 1/256 бина
+    int32_t l = f.mag[k - 1], r = f.mag[k + 1];
+    int32_t den = 2 * (2 * (int32_t)m - l - r);
+    int32_t d = den ? ((r - l) * 256) / den : 0;
+    uint32_t mhz = (uint32_t)(((int64_t)(k * 256 + d) * fs * 1000) / (VIB_N * 256));
+
+    // вставка с сортировкой
+    uint8_t pos = n;
+    while (pos > 0 && out[pos - 1].amp < m) pos--;
+    if (pos >= VIB_PEAKS) continue;
+    for (uint8_t q = (n < VIB_PEAKS ? n : VIB_PEAKS - 1); q > pos; q--) out[q] = out[q - 1];
+    out[pos].mhz = mhz;
+    out[pos].amp = m;
+    if (n < VIB_PEAKS) n++;
+  }
+  return n;
+}
@@ -1,17 +1,149 @@
 #include <Arduino.h>
 #include <string.h>
 #include <stdlib.h>
+#include <esp_system.h>
+#include <esp_timer.h>
+#include <esp_partition.h>
+#include <esp_ipc.h>
+#include <esp_debug_helpers.h>
+#include <freertos/xtensa_context.h>
 
 #include <WiFi.h>
 #include <WebServer.h>
+#include <WiFiUdp.h>
+#include <Preferences.h>
 
 #include <FastAccelStepper.h>
+#include <driver/pcnt.h>
+#include <driver/adc.h>
+#include <driver/twai.h>
+#include <driver/gpio.h>
+#include <soc/io_mux_reg.h>
 
+#include "cam.h"
+#include "mpg.h"
+#include "ain.h"
+#include "canproto.h"
+#include "modbus.h"
+#include "shaper.h"
+#include "pvt.h"
+#include "stepcomp.h"
+#include "arc.h"
+#include "pfail.h"
+#include "vibfft.h"
+#include "resscan.h"
+#include "atune.h"
+#include "dlog.h"
+#include "tcpcon.h"
+#include "status.h"
+#include "cmdlog.h"
+#include "motion.h"
+#include "trig.h"
+#include "life.h"
+#include "rampbuf.h"
+
+#if CONFIG_IDF_TARGET_ESP32S3
+// ESP32-S3 (env:esp32s3): GPIO22–25 нет, 26–37 заняты флешем и PSRAM
+// модуля, 19/20 — USB. АЦП1 — GPIO1–10, PCNT — четыре блока.
+#define PIN_STEP  38
+#define PIN_DIR   39
+#define PIN_EN    40  // EN активен LOW
+#define PIN_AL    41
+
+#define PIN_MST_A 5
+#define PIN_MST_B 6
+
+#define PCNT_MST  PCNT_UNIT_2
+#define PCNT_MPG  PCNT_UNIT_3
+
+#define PIN_MPG_A 7
+#define PIN_MPG_B 8
+
+// GPIO1 = ADC1_CH0, GPIO4 = ADC1_CH3
+#define AIN_CH    ADC1_CHANNEL_0
+#define VIB_CH    ADC1_CHANNEL_3
+
+#define PIN_CAN_TX GPIO_NUM_9
+#define PIN_CAN_RX GPIO_NUM_10
+
+#ifndef PIN_PF
+#define PIN_PF 21
+#endif
+#else
 #define PIN_STEP  25
 #define PIN_DIR   26
 #define PIN_EN    27  // EN активен LOW
 #define PIN_AL    34
 
+// Вход мастер-оси (энкодер A/B, PCNT)
+#define PIN_MST_A 32
+#define PIN_MST_B 33
+
+// FastAccelStepper занимает младшие блоки PCNT под генерацию шагов
+#define PCNT_MST  PCNT_UNIT_6
+#define PCNT_MPG  PCNT_UNIT_7
+
+// Маховичок (MPG), A/B
+#define PIN_MPG_A 18
+#define PIN_MPG_B 19
+
+// Аналоговое задание скорости: GPIO36 = ADC1_CH0 (0–10 В через делитель)
+#define AIN_CH    ADC1_CHANNEL_0
+
+// Акселерометр (аналоговый выход): GPIO39 = ADC1_CH3, тот же DMA-поток АЦП
+#define VIB_CH    ADC1_CHANNEL_3
+
+// CAN (TWAI), нужен внешний трансивер
+#define PIN_CAN_TX GPIO_NUM_5
+#define PIN_CAN_RX GPIO_NUM_4
+#endif
+
+#ifndef CAN_NODE
+#define CAN_NODE 1
+#endif
+
+// Modbus RTU на UART2, RS-485: DE/RE драйвера — на RTS
+#define PIN_MB_RX 16
+#define PIN_MB_TX 17
+#define PIN_MB_DE 13
+
+#ifndef MB_SLAVE
+#define MB_SLAVE 1
+#endif
+#ifndef MB_BAUD
+#define MB_BAUD 19200
+#endif
+
+#ifndef PVT_PORT
+#define PVT_PORT 5005
+#endif
+
+// Энкодер двигателя для подбора ускорения — на входе мастер-оси
+// (PIN_MST_A/B, PCNT_MST): ATUNE_ENC_NUM отсчётов на ATUNE_ENC_DEN шагов
+#ifndef ATUNE_ENC_NUM
+#define ATUNE_ENC_NUM 1
+#endif
+#ifndef ATUNE_ENC_DEN
+#define ATUNE_ENC_DEN 1
+#endif
+
+// Какую координату дуги ведёт эта плата: ARC_X / ARC_Y / ARC_Z
+#ifndef ARC_AXIS
+#define ARC_AXIS ARC_X
+#endif
+
+#ifndef LOG_PORT
+#define LOG_PORT 5006
+#endif
+#ifndef TCON_PORT
+#define TCON_PORT 23
+#endif
+
+// Отложенный лог (dlog.h): LOGE/LOGW/LOGI/LOGD; уровень — LOG_LEVEL при сборке
+static Dlog g_log;
+#define DLOG_Q     g_log
+#define DLOG_NOW() micros()
+
 // WiFi (STA)
 static const char* WIFI_SSID_C = WIFI_SSID;
 static const char* WIFI_PASS_C = WIFI_PASS;
@@ -24,20 +156,51 @@ static volatile uint8_t  g_dir      = 0;         // 0/1
 static volatile uint8_t  g_en       = 1;         // 0/1
 static volatile bool     g_alarm    = false;
 
-static volatile bool     g_runReq   = false;
-static volatile bool     g_dirPend  = false;
-static volatile uint8_t  g_dirNext  = 0;
+// start/stop, направление, en и авария — автомат motion.h; пишет только StepTask
+static Motion s_mo;
+
+static volatile bool     g_mpgOn    = false;
+static volatile uint8_t  g_mpgScale = 1;
+
+static volatile uint8_t  g_shapeType = SHAPE_NONE;   // != NONE — скорость ведёт shapeTick()
+
+static volatile uint8_t  g_pvtState = PVT_IDLE;
+static volatile uint8_t  g_scState  = PVT_IDLE;   // те же состояния, что у PVT
+static volatile uint8_t  g_trigState = TRIG_IDLE;
 
-enum CmdType : uint8_t { CMD_START, CMD_STOP, CMD_FREQ, CMD_DIR, CMD_EN, CMD_RAMP, CMD_STATUS, CMD_ACCEL };
+static volatile bool     g_arcOn    = false;
+
+static volatile bool     g_vibOn    = false;
+
+// Запрещённые полосы скоростей (resscan.h); на время прохода по частоте не действуют.
+static ResBand           g_resBand[RES_MAX_BANDS];
+static volatile uint8_t  g_resBands = 0;
+static volatile bool     g_scanOn   = false;
+
+static volatile bool     g_tuneOn   = false;
+
+enum CmdType : uint8_t { CMD_START, CMD_STOP, CMD_FREQ, CMD_DIR, CMD_EN, CMD_RAMP, CMD_STATUS, CMD_ACCEL,
+                         CMD_CAM, CMD_CAM_MASTER, CMD_MPG, CMD_SHAPE, CMD_PVT, CMD_STEPCMD, CMD_ARC,
+                         CMD_RES, CMD_TUNE, CMD_TRIG, CMD_LIFE };
+
+enum CamOp : uint8_t { CAM_OFF, CAM_ON, CAM_LOAD };
+enum CamMaster : uint8_t { CAM_MST_ENC, CAM_MST_VIRT };
+enum MpgOp : uint8_t { MPG_OFF, MPG_ON, MPG_SCALE };
+enum ResOp : uint8_t { RES_SCAN, RES_STOP, RES_CLEAR };
 
 struct Cmd {
   CmdType type;
   uint32_t a;
   uint32_t b;
+  uint32_t seq;      // номер в s_cmdLog; 0 — без учёта (консоль, CAN, Modbus)
 };
 
 static QueueHandle_t qCmd;
 
+// Команды из HTTP: номер, id клиента и результат (cmdlog.h).
+static CmdLog s_cmdLog;
+static portMUX_TYPE s_cmdMux = portMUX_INITIALIZER_UNLOCKED;
+
 static inline uint32_t clamp_u32(uint32_t v, uint32_t lo, uint32_t hi) {
   if (v < lo) return lo;
   if (v > hi) return hi;
@@ -50,6 +213,117 @@ static inline bool readAlarm() {
 
 static FastAccelStepperEngine engine;
 static FastAccelStepper* stepper = nullptr;
+static TaskHandle_t s_stepTask = nullptr;
+
+// Заготовки, которые пишут консоль (UART и сессии TCP) и Web, а
+// применяет StepTask: таблица кулачка, дуга, параметры прохода. Разбор —
+// в локальный буфер, копия в заготовку и обратно — под s_stageLock.
+static SemaphoreHandle_t s_stageLock = nullptr;
+
+static void stageLock()   { xSemaphoreTake(s_stageLock, portMAX_DELAY); }
+static void stageUnlock() { xSemaphoreGive(s_stageLock); }
+
+// ===== PCNT =====
+// Счётчик PCNT 16-битный и сбрасывается в 0 на пределах;
+// опрашиваем чаще, чем он успевает пройти полдиапазона, и расширяем до 32 бит.
+static const int16_t PCNT_LIM = 32767;
+
+struct PcntAxis {
+  pcnt_unit_t unit;
+  int16_t last;
+  int32_t pos;
+};
+
+static void pcntInit(PcntAxis& ax, pcnt_unit_t unit, int pinA, int pinB) {
+  pcnt_config_t c = {};
+  c.pulse_gpio_num = pinA;
+  c.ctrl_gpio_num  = pinB;
+  c.channel   = PCNT_CHANNEL_0;
+  c.unit      = unit;
+  c.pos_mode  = PCNT_COUNT_INC;
+  c.neg_mode  = PCNT_COUNT_DEC;
+  c.lctrl_mode = PCNT_MODE_REVERSE;
+  c.hctrl_mode = PCNT_MODE_KEEP;
+  c.counter_h_lim = PCNT_LIM;
+  c.counter_l_lim = -PCNT_LIM;
+  pcnt_unit_config(&c);
+
+  pcnt_set_filter_value(unit, 100);
+  pcnt_filter_enable(unit);
+  pcnt_counter_pause(unit);
+  pcnt_counter_clear(unit);
+  pcnt_counter_resume(unit);
+
+  ax.unit = unit;
+  ax.last = 0;
+  ax.pos = 0;
+}
+
+static int32_t pcntPoll(PcntAxis& ax) {
+  int16_t cur = 0;
+  pcnt_get_counter_value(ax.unit, &cur);
+  int32_t d = (int32_t)cur - ax.last;
+  if (d >  PCNT_LIM / 2) d -= PCNT_LIM;
+  if (d < -PCNT_LIM / 2) d += PCNT_LIM;
+  ax.last = cur;
+  ax.pos = (int32_t)((uint32_t)ax.pos + (uint32_t)d);   // переполняется по модулю, без UB
+  return d;
+}
+
+// Позиционное слежение с фиксированным тиком: цель на следующий тик,
+// скорость с запасом 25%, чтобы догнать её до следующего вызова.
+static void followTarget(int32_t target, int32_t& last, uint32_t dt_us) {
+  uint32_t d = (uint32_t)abs(target - last);
+  uint64_t hz = (uint64_t)d * 1000000ULL / dt_us;
+  last = target;
+
+  stepper->setSpeedInHz(clamp_u32((uint32_t)(hz + hz / 4), 1, FREQ_MAX));
+  stepper->setAcceleration(clamp_u32(g_accel, 1, 2000000));
+  stepper->moveTo(target);
+}
+
+// ===== Cam =====
+static const uint32_t CAM_TICK_US = 1000;
+
+static CamTable g_cam[2];
+static CamTable g_camNext;                     // заготовка, под s_stageLock
+static volatile uint8_t  g_camIdx    = 0;      // активная таблица; вторая — для загрузки
+static volatile bool     g_camOn     = false;
+static volatile uint8_t  g_camMaster = CAM_MST_ENC;
+static volatile int32_t  g_camMstPos = 0;      // позиция мастера относительно начала профиля
+
+static PcntAxis       s_mstEnc;
+static CamVirtualAxis s_mstVirt = {0, 0, 0};
+static CamMasterPath s_camMst   = {0, 0};
+static int32_t  s_camSlvOrigin  = 0;
+static int32_t  s_camLastTarget = 0;
+static uint32_t s_camLastUs     = 0;
+
+static int32_t camMasterPos() {
+  return (g_camMaster == CAM_MST_VIRT) ? camVirtualPos(s_mstVirt) : s_mstEnc.pos;
+}
+
+static inline bool pvtActive() {
+  return g_pvtState == PVT_PREFILL || g_pvtState == PVT_RUN;
+}
+
+static inline bool scActive() {
+  return g_scState == PVT_PREFILL || g_scState == PVT_RUN;
+}
+
+static inline bool trigActive() {
+  return g_trigState == TRIG_ARMED || g_trigState == TRIG_RUN;
+}
+
+// Режимы, сами кормящие очередь FAS: потоки PVT и команд шагов, старт по фронту.
+static inline bool streamActive() {
+  return pvtActive() || scActive() || trigActive();
+}
+
+// Заданная скорость с учётом запрещённых полос.
+static inline uint32_t resFreq(uint32_t hz) {
+  return g_scanOn ? hz : resAvoid(g_resBand, g_resBands, hz);
+}
 
 static void applyEnablePin() {
   digitalWrite(PIN_EN, g_en ? HIGH : LOW);
@@ -61,126 +335,2883 @@ static inline void applyDirPin() {
 
 static void applyParamsToStepper() {
   if (!stepper) return;
-  stepper->setSpeedInHz(clamp_u32(g_userFreq, 1, FREQ_MAX));
+  if (g_shapeType != SHAPE_NONE) return;
+  stepper->setSpeedInHz(resFreq(clamp_u32(g_userFreq, 1, FREQ_MAX)));
   stepper->setAcceleration(clamp_u32(g_accel, 1, 2000000));
 }
 
 static void applyRunDirectionToUpdateSpeed() {
   if (!stepper) return;
-  if (!g_runReq) return;
+  if (!s_mo.want) return;
+  if (g_shapeType != SHAPE_NONE) return;
 
   if (g_dir) stepper->runBackward();
   else       stepper->runForward();
 }
 
-static void requestStart() {
-  if (!stepper || !g_en || g_alarm) return;
-  applyParamsToStepper();
-  g_runReq = true;
-  applyRunDirectionToUpdateSpeed();
-}
+// Выключить все режимы, ведущие двигатель сами, и тормозить.
+static void stopModes() {
+  g_camOn = false;
+  g_mpgOn = false;
+  g_arcOn = false;
+  g_tuneOn = false;
+  if (pvtActive()) {
+    // потоки сами кормят очередь шагов: рампой не остановить — только сбросом
+    g_pvtState = PVT_IDLE;
+    if (stepper) stepper->forceStop();
+  }
+  if (scActive()) {
+    g_scState = PVT_IDLE;
+    if (stepper) stepper->forceStop();
+  }
+  if (trigActive()) {
+    g_trigState = TRIG_ABORT;
+    gpio_intr_disable((gpio_num_t)PIN_STEP);
+    if (stepper) stepper->forceStop();
+  }
+  if (stepper) stepper->stopMove();
+}
+
+// ===== Motion =====
+static void moRun() {
+  applyParamsToStepper();
+  applyRunDirectionToUpdateSpeed();
+}
+
+static void moStop() {
+  // при формировании скорость к нулю сведёт shapeTick()
+  if (stepper && g_shapeType == SHAPE_NONE) stepper->stopMove();
+}
+
+static void moSetDir(uint8_t dir) {
+  g_dir = dir;
+  applyDirPin();
+}
+
+static uint32_t moUs() {
+  return micros();
+}
+
+static const MoHooks s_moHooks = {moRun, moStop, stopModes, moSetDir, moUs};
+
+static inline void moEvent(uint8_t ev, uint32_t arg = 0) {
+  moPost(s_mo, ev, arg, s_moHooks);
+}
+
+static void requestStart() {
+  if (!stepper) return;
+  if (g_camOn || g_mpgOn || g_arcOn || g_tuneOn || streamActive()) return;
+  moEvent(MO_EV_START);
+}
+
+static void requestStop() {
+  stopModes();
+  moEvent(MO_EV_STOP);
+}
+
+static void camEngage() {
+  const CamTable& t = g_cam[g_camIdx];
+  if (!stepper || !g_en || g_alarm || g_mpgOn || g_arcOn || streamActive() || t.n < 2) return;
+  if (stepper->isRunning()) return;
+
+  moEvent(MO_EV_STOP);
+  camMasterStart(s_camMst, camMasterPos());
+  s_camSlvOrigin  = stepper->getCurrentPosition() - camEval(t, 0);
+  s_camLastTarget = stepper->getCurrentPosition();
+  s_camLastUs     = micros();
+  g_camMstPos     = 0;
+  g_camOn = true;
+}
+
+// Вызывается на каждом проходе StepTask; работает с шагом CAM_TICK_US.
+static void camTick() {
+  uint32_t now = micros();
+  uint32_t dt = now - s_camLastUs;
+  if (dt < CAM_TICK_US) return;
+  s_camLastUs = now;
+
+  camVirtualTick(s_mstVirt, dt);
+  pcntPoll(s_mstEnc);
+
+  if (!g_camOn || !stepper) return;
+
+  int64_t x = camMasterUpdate(s_camMst, camMasterPos());
+  int32_t target = s_camSlvOrigin + camEval(g_cam[g_camIdx], x);
+  g_camMstPos = (int32_t)x;
+
+  followTarget(target, s_camLastTarget, dt);
+}
+
+// ===== MPG =====
+static const uint32_t MPG_TICK_US = 1000;
+
+static PcntAxis  s_mpgEnc;
+static MpgFilter s_mpg = {1, 20000, 200000, 2000};
+static int32_t   s_mpgLastTarget = 0;
+static uint32_t  s_mpgLastUs     = 0;
+
+static void mpgEngage() {
+  if (!stepper || !g_en || g_alarm || g_camOn || g_arcOn || streamActive()) return;
+  if (stepper->isRunning()) return;
+
+  moEvent(MO_EV_STOP);
+  pcntPoll(s_mpgEnc);
+  mpgReset(s_mpg, stepper->getCurrentPosition());
+  s_mpgLastTarget = mpgPos(s_mpg);
+  s_mpgLastUs = micros();
+  g_mpgOn = true;
+}
+
+static void mpgTick() {
+  uint32_t now = micros();
+  uint32_t dt = now - s_mpgLastUs;
+  if (dt < MPG_TICK_US) return;
+  s_mpgLastUs = now;
+
+  int32_t d = pcntPoll(s_mpgEnc);
+  if (!g_mpgOn || !stepper) return;
+
+  // скорость и ускорение маховичка ограничены теми же g_userFreq/g_accel
+  s_mpg.vmax  = clamp_u32(g_userFreq, 1, FREQ_MAX);
+  s_mpg.accel = clamp_u32(g_accel, 1, 2000000);
+  s_mpg.scale = g_mpgScale;
+
+  mpgFeed(s_mpg, d);
+  mpgStep(s_mpg, dt);
+
+  int32_t target = mpgPos(s_mpg);
+  if (target != s_mpgLastTarget) followTarget(target, s_mpgLastTarget, dt);
+}
+
+// ===== Input shaping =====
+// Скорость считается здесь же с тиком SHAPE_TICK_US: трапеция по g_accel,
+// затем свёртка с импульсами шейпера; FastAccelStepper только
+// отрабатывает готовую скорость.
+static const uint32_t SHAPE_TICK_US = 1000;
+
+static Shaper   s_shape;
+static uint16_t g_shapeHz    = 40;     // Гц
+static uint16_t g_shapeZeta  = 50;     // демпфирование, промилле
+static int32_t  s_shapeVcmd  = 0;
+static int32_t  s_shapeVout  = 0;
+static uint32_t s_shapeLastUs = 0;
+
+static bool shapeConfigure(uint8_t type, uint16_t hz, uint16_t zeta) {
+  if (stepper && stepper->isRunning()) return false;
+  if (!shaperConfig(s_shape, type, hz, zeta / 1000.0f, SHAPE_TICK_US)) return false;
+
+  shaperReset(s_shape, 0);
+  s_shapeVcmd = 0;
+  s_shapeVout = 0;
+  g_shapeHz = hz;
+  g_shapeZeta = zeta;
+  g_shapeType = type;
+  if (type == SHAPE_NONE) applyParamsToStepper();
+  return true;
+}
+
+static void shapeTick() {
+  uint32_t now = micros();
+  uint32_t dt = now - s_shapeLastUs;
+  if (dt < SHAPE_TICK_US) return;
+  s_shapeLastUs = now;
+
+  if (g_shapeType == SHAPE_NONE || !stepper) return;
+
+  // жёсткая остановка (авария, EN, stopMove) — история больше не валидна
+  if (!stepper->isRunning() && s_shapeVout > 0) {
+    shaperReset(s_shape, 0);
+    s_shapeVcmd = 0;
+    s_shapeVout = 0;
+    return;
+  }
+
+  bool run = moDrive(s_mo);
+  int32_t target = run ? (int32_t)resFreq(clamp_u32(g_userFreq, 1, FREQ_MAX)) : 0;
+  if (s_shapeVcmd == 0 && target == 0 && s_shapeVout == 0) return;
+
+  s_shapeVcmd = shapeRamp(s_shapeVcmd, target, g_accel, SHAPE_TICK_US);
+  int32_t v = shaperPush(s_shape, s_shapeVcmd);
+  if (v == s_shapeVout) return;
+  s_shapeVout = v;
+
+  if (v > 0) {
+    // своё ускорение FAS выше наклона формированной скорости, чтобы не мешать
+    stepper->setSpeedInHz((uint32_t)v);
+    stepper->setAcceleration(clamp_u32(g_accel * 2, 1, 4000000));
+    if (g_dir) stepper->runBackward();
+    else       stepper->runForward();
+  } else {
+    stepper->stopMove();
+  }
+}
+
+// Текущая скорость, Гц: сформированная или FastAccelStepper.
+static uint32_t moSpeedNow() {
+  if (!stepper) return 0;
+  if (g_shapeType != SHAPE_NONE) return (uint32_t)s_shapeVout;
+  int32_t mhz = stepper->getCurrentSpeedInMilliHz();
+  return (uint32_t)(mhz < 0 ? -mhz : mhz) / 1000;
+}
+
+// Новые f/acc: сразу в FastAccelStepper, а автомат решает, разгон это
+// или торможение.
+static void moSpeed() {
+  applyParamsToStepper();
+  moEvent(MO_EV_SPEED, resFreq(clamp_u32(g_userFreq, 1, FREQ_MAX)) > moSpeedNow());
+}
+
+// ===== PVT =====
+// Точки приходят по UDP (StreamTask), StepTask режет кривую Эрмита на
+// срезы (pvtGenSlice) и доливает их записями прямо в очередь FAS, как
+// поток команд шагов: рамп FAS нет, и двигатель проходит точки в их
+// время, а не догоняет цель с отставанием ~v^2/2a. Часы потока — сама
+// очередь: она стартует, когда в буфере набралось g_pvtPrefill точек;
+// запас буфера поглощает джиттер сети. Очередь выбрана, а точек нет —
+// двигатель встаёт на конце последнего среза (PVT_UNDERFLOW).
+
+static PvtBuffer g_pvt = {};
+static volatile uint16_t g_pvtPrefill   = 10;
+static volatile uint32_t g_pvtUnderflow = 0;
+static volatile uint32_t g_pvtDrops     = 0;
+static volatile bool     s_pvtPending   = false;   // START принят, CMD_PVT ещё не разобран
+
+static PvtGen s_pvtGen;
+
+static void pvtTick() {
+  if (!stepper) return;
+
+  if (g_pvtState == PVT_PREFILL) {
+    if (pvtLevel(g_pvt) < g_pvtPrefill && !g_pvt.ended) return;
+    if (!pvtLevel(g_pvt) || !g_en || g_alarm || g_camOn || g_mpgOn || g_arcOn || scActive() || trigActive() ||
+        stepper->isRunning()) {
+      g_pvtState = PVT_IDLE;
+      return;
+    }
+    moEvent(MO_EV_STOP);
+    pvtGenStart(s_pvtGen, g_pvt);
+    g_pvtState = PVT_RUN;
+  }
+
+  if (g_pvtState != PVT_RUN) return;
+
+  int r = PVT_GEN_SLICE;
+  while (!stepper->isQueueFull()) {
+    if (s_pvtGen.i == s_pvtGen.n) {
+      r = pvtGenSlice(s_pvtGen, g_pvt);
+      if (r != PVT_GEN_SLICE) break;
+    }
+    const PvtEntry& e = s_pvtGen.e[s_pvtGen.i];
+    stepper_command_s c;
+    c.ticks = e.ticks;
+    c.steps = e.steps;
+    c.count_up = e.up;
+    if (r == PVT_GEN_FAST || stepper->addQueueEntry(&c, true) != AQE_OK) {
+      r = PVT_GEN_FAST;
+      break;
+    }
+    s_pvtGen.i++;
+  }
+
+  if (r == PVT_GEN_FAST) {
+    // срез чаще, чем тянет очередь: поток прерван, как при потере точек
+    stepper->forceStop();
+    g_pvtUnderflow++;
+    g_pvtState = PVT_UNDERFLOW;
+    return;
+  }
+  if (r == PVT_GEN_SLICE || stepper->isRunning()) return;
+
+  if (r == PVT_GEN_DONE) g_pvtState = PVT_DONE;
+  else {
+    g_pvtUnderflow++;
+    g_pvtState = PVT_UNDERFLOW;
+  }
+}
+
+// ===== Step commands =====
+// Хост сам планирует шаги и шлёт их сжатыми {interval, count, add}.
+// StepTask на каждом проходе доливает очередь FastAccelStepper
+// записями, собранными из этих команд; рампы FAS не участвуют.
+static StepCmdBuffer g_sc = {};
+static StepIter s_scIt = {};
+static volatile uint16_t g_scPrefill   = 32;
+static volatile uint32_t g_scUnderflow = 0;
+static volatile uint32_t g_scDrops     = 0;
+static volatile bool     s_scPending   = false;   // START принят, CMD_STEPCMD ещё не разобран
+static volatile uint32_t g_scRate      = 0;   // команд/с, измерено
+static uint32_t s_scRateMs     = 0;
+static uint32_t s_scRateLoaded = 0;
+
+static void scTick() {
+  if (!stepper) return;
+
+  if (g_scState == PVT_PREFILL) {
+    if (scLevel(g_sc) < g_scPrefill && !g_sc.ended) return;
+    if (!scLevel(g_sc) || !g_en || g_alarm || g_camOn || g_mpgOn || g_arcOn || pvtActive() || trigActive() ||
+        stepper->isRunning()) {
+      g_scState = PVT_IDLE;
+      return;
+    }
+    moEvent(MO_EV_STOP);
+    s_scIt = {};
+    s_scRateLoaded = 0;
+    s_scRateMs = millis();
+    g_scState = PVT_RUN;
+  }
+
+  if (g_scState != PVT_RUN) return;
+
+  bool more = true;
+  while (!stepper->isQueueFull()) {
+    stepper_command_s c;
+    uint8_t dir;
+    if (!scNextGroup(s_scIt, g_sc, c.ticks, c.steps, dir)) { more = false; break; }
+    c.count_up = (dir == 0);
+    if (stepper->addQueueEntry(&c, true) != AQE_OK) {
+      stepper->forceStop();
+      g_scState = PVT_UNDERFLOW;
+      return;
+    }
+  }
+
+  uint32_t now = millis();
+  if ((uint32_t)(now - s_scRateMs) >= 1000) {
+    g_scRate = (s_scIt.loaded - s_scRateLoaded) * 1000 / (now - s_scRateMs);
+    s_scRateLoaded = s_scIt.loaded;
+    s_scRateMs = now;
+  }
+
+  if (more || stepper->isRunning()) return;
+
+  // очередь выбрана до конца: либо поток закончен, либо хост не успел
+  if (g_sc.ended) g_scState = PVT_DONE;
+  else {
+    g_scUnderflow++;
+    g_scState = PVT_UNDERFLOW;
+  }
+}
+
+// ===== Arc =====
+// Дуга/винт целиком одной командой: хорды по допуску g_arcTol и подача
+// по пути считаются здесь же с тиком ARC_TICK_US, позиция своей оси
+// (ARC_AXIS) ведётся через followTarget(). Новая дуга готовится
+// в g_arcNext и принимается только на стоящем двигателе.
+static const uint32_t ARC_TICK_US = 1000;
+
+static Arc g_arcNext = {};                     // под s_stageLock
+static Arc s_arc     = {};
+static volatile uint32_t g_arcFeed = 10000;    // шаг/с по пути
+static volatile uint32_t g_arcTol  = 500;      // стрелка хорды, миллишаги
+static volatile int32_t  g_arcS    = 0;        // пройдено по пути, шаги
+
+static ArcFeed  s_arcFeed       = {0, 0};
+static int32_t  s_arcOrigin     = 0;
+static int32_t  s_arcLastTarget = 0;
+static uint32_t s_arcLastUs     = 0;
+
+static void arcEngage() {
+  if (!stepper || !g_en || g_alarm || g_camOn || g_mpgOn || g_arcOn || streamActive()) return;
+  stageLock();
+  Arc next = g_arcNext;
+  stageUnlock();
+  if (stepper->isRunning() || next.n == 0) return;
+
+  moEvent(MO_EV_STOP);
+  s_arc = next;
+  s_arcFeed = {0, 0};
+  s_arcOrigin = stepper->getCurrentPosition();
+  s_arcLastTarget = s_arcOrigin;
+  s_arcLastUs = micros();
+  g_arcS = 0;
+  g_arcOn = true;
+}
+
+static void arcTick() {
+  uint32_t now = micros();
+  uint32_t dt = now - s_arcLastUs;
+  if (dt < ARC_TICK_US) return;
+  s_arcLastUs = now;
+
+  if (!g_arcOn || !stepper) return;
+
+  arcFeedTick(s_arcFeed, s_arc.len, (float)clamp_u32(g_arcFeed, 1, FREQ_MAX), (float)g_accel, dt * 1e-6f);
+  float p[3];
+  arcEval(s_arc, s_arcFeed.s, p);
+  g_arcS = (int32_t)s_arcFeed.s;
+
+  followTarget(s_arcOrigin + (int32_t)lrintf(p[ARC_AXIS]), s_arcLastTarget, dt);
+  if (s_arcFeed.s >= s_arc.len) g_arcOn = false;   // конечная цель уже задана, доедет сам
+}
+
+// ===== Retention =====
+// Позиция, направление и основные параметры дублируются в RTC slow
+// memory: RTC_NOINIT_ATTR не обнуляется при программном сбросе,
+// панике и сторожевых таймерах. Два слота пишутся по очереди, у каждого
+// своя контрольная сумма, так что сброс посреди записи портит только
+// один. При загрузке берётся свежий целый слот — если причина сброса
+// это допускает. Движение после сброса не возобновляется.
+#define RETAIN_MAGIC 0x52544E31u   // "RTN1"
+
+struct Retained {
+  uint32_t magic;
+  uint32_t seq;
+  int32_t  pos;
+  uint32_t freq;
+  uint32_t accel;
+  uint8_t  dir;
+  uint8_t  en;
+  uint8_t  moving;
+  uint8_t  runReq;
+  uint32_t sum;
+};
+
+RTC_NOINIT_ATTR static Retained s_retain[2];
+static uint32_t s_retainSeq = 0;
+
+enum RetainResult : uint8_t { RETAIN_NONE, RETAIN_EXACT, RETAIN_MOVING };
+static volatile uint8_t g_restored = RETAIN_NONE;   // MOVING — на сбросе ехали, позиция ± шаги последней 1 мс
+static volatile uint8_t g_resetReason = 0;
+
+static uint32_t retainSum(const Retained& r) {
+  const uint32_t* w = (const uint32_t*)&r;
+  uint32_t s = 2166136261u;
+  for (size_t i = 0; i < offsetof(Retained, sum) / 4; i++) s = (s ^ w[i]) * 16777619u;
+  return s;
+}
+
+static inline bool retainValid(const Retained& r) {
+  return r.magic == RETAIN_MAGIC && r.sum == retainSum(r);
+}
+
+// Каждый проход StepTask: десяток слов в RTC, без блокировок.
+static void retainSave() {
+  Retained& r = s_retain[++s_retainSeq & 1];
+  r.magic  = RETAIN_MAGIC;
+  r.seq    = s_retainSeq;
+  r.pos    = stepper->getCurrentPosition();
+  r.freq   = g_userFreq;
+  r.accel  = g_accel;
+  r.dir    = g_dir;
+  r.en     = g_en;
+  r.moving = stepper->isRunning() ? 1 : 0;
+  r.runReq = s_mo.want ? 1 : 0;
+  r.sum    = retainSum(r);
+}
+
+static void retainRestore() {
+  esp_reset_reason_t why = esp_reset_reason();
+  g_resetReason = (uint8_t)why;
+
+  // после включения питания RTC — мусор; после brownout — не доверяем
+  bool ok = why == ESP_RST_SW || why == ESP_RST_PANIC || why == ESP_RST_INT_WDT ||
+            why == ESP_RST_TASK_WDT || why == ESP_RST_WDT || why == ESP_RST_DEEPSLEEP;
+
+  const Retained* r = nullptr;
+  if (ok) {
+    bool v0 = retainValid(s_retain[0]), v1 = retainValid(s_retain[1]);
+    if (v0 && v1) r = (int32_t)(s_retain[1].seq - s_retain[0].seq) > 0 ? &s_retain[1] : &s_retain[0];
+    else if (v0)  r = &s_retain[0];
+    else if (v1)  r = &s_retain[1];
+  }
+
+  if (!r) {
+    memset(s_retain, 0, sizeof(s_retain));
+    return;
+  }
+
+  s_retainSeq = r->seq;
+  g_userFreq = clamp_u32(r->freq, 1, FREQ_MAX);
+  g_accel    = clamp_u32(r->accel, 1, 2000000);
+  g_dir      = r->dir ? 1 : 0;
+  g_en       = r->en ? 1 : 0;
+  applyDirPin();
+  applyEnablePin();
+  stepper->setCurrentPosition(r->pos);
+  g_restored = r->moving ? RETAIN_MOVING : RETAIN_EXACT;
+}
+
+// ===== Power fail =====
+// Компаратор на питании силовой части (PIN_PF, LOW — питание уходит)
+// будит PowerTask. Двигатель и режимы — дело StepTask: PowerTask
+// поднимает s_pfReq и будит её, StepTask в начале прохода (pfStep)
+// останавливает шаги, снимает позицию и стоит, пока PowerTask пишет одну
+// запись в заранее стёртый слот раздела "pfail" (см. pfail.h). Если
+// StepTask не ответила за PF_STEP_WAIT_US (занята длинной записью NVS),
+// PowerTask приостанавливает её и останавливает шаги сама — единственное
+// место, где FAS трогают из чужой задачи, и только при стоящей StepTask;
+// режимы в любом случае снимает StepTask после возобновления. Запас
+// конденсаторов по 3.3 В должен перекрывать время записи — оно
+// меряется и дописывается в саму запись, максимум — в статусе.
+// Вернулось питание без сброса — запись помечается применённой,
+// StepTask продолжает со стоящим двигателем.
+#ifndef PIN_PF
+#define PIN_PF 35
+#endif
+#define PF_SUBTYPE     0x40
+#define PF_RECOVER_MS  100
+#ifndef PF_STEP_WAIT_US
+#define PF_STEP_WAIT_US 2000
+#endif
+
+static const esp_partition_t* s_pfPart = nullptr;
+static PfPlan       s_pfPlan = {};
+static TaskHandle_t s_pfTask = nullptr;
+static volatile bool     s_pfTest      = false;
+static volatile bool     g_pfOk        = false;   // слот под запись готов
+static volatile bool     g_pfRestored  = false;
+static volatile uint32_t g_pfSaves     = 0;
+static volatile uint32_t g_pfSaveUs    = 0;
+static volatile uint32_t g_pfSaveMaxUs = 0;
+static volatile uint32_t g_pfBootUs    = 0;       // время сохранения записи, применённой при загрузке
+// обмен PowerTask <-> StepTask
+static volatile bool     s_pfReq       = false;   // остановиться и ждать
+static volatile bool     s_pfParked    = false;   // StepTask стоит, снимок ниже готов
+static volatile bool     s_pfStopModes = false;   // после аварии снять режимы
+static volatile bool     s_pfMoving    = false;
+static volatile int32_t  s_pfPos       = 0;
+
+static void IRAM_ATTR pfIsr() {
+  BaseType_t hp = pdFALSE;
+  vTaskNotifyGiveFromISR(s_pfTask, &hp);
+  portYIELD_FROM_ISR(hp);
+}
+
+static inline size_t pfAddr(uint8_t sec, uint16_t slot) {
+  return (size_t)sec * PF_SECTOR + (size_t)slot * PF_REC;
+}
+
+// Разбор раздела и подготовка слота. Стирание — только здесь, не при аварии.
+static bool pfPrepare() {
+  uint8_t* buf = (uint8_t*)malloc(PF_SECTOR);
+  if (!buf) return false;
+
+  PfSector s[2];
+  bool ok = true;
+  for (uint8_t i = 0; i < 2 && ok; i++) {
+    ok = esp_partition_read(s_pfPart, pfAddr(i, 0), buf, PF_SECTOR) == ESP_OK;
+    if (ok) pfScan(buf, s[i]);
+  }
+  free(buf);
+  if (!ok) return false;
+
+  pfPlan(s, s_pfPlan);
+  if (s_pfPlan.erase) return esp_partition_erase_range(s_pfPart, pfAddr(s_pfPlan.sec, 0), PF_SECTOR) == ESP_OK;
+  return true;
+}
+
+static void pfMarkUsed() {
+  if (!s_pfPlan.found || s_pfPlan.rec.used != 0xFF) return;
+  uint8_t z = 0;
+  esp_partition_write(s_pfPart, pfAddr(s_pfPlan.recSec, s_pfPlan.recSlot) + offsetof(PfRecord, used), &z, 1);
+}
+
+// Загрузка: применить запись, если она свежая и RTC-копия не восстановилась.
+static void pfInit() {
+  s_pfPart = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, (esp_partition_subtype_t)PF_SUBTYPE, "pfail");
+  if (!s_pfPart || s_pfPart->size < 2 * PF_SECTOR || !pfPrepare()) {
+    s_pfPart = nullptr;
+    return;
+  }
+
+  const PfRecord& r = s_pfPlan.rec;
+  if (s_pfPlan.found && r.used == 0xFF && g_restored == RETAIN_NONE) {
+    g_userFreq = clamp_u32(r.freq, 1, FREQ_MAX);
+    g_accel    = clamp_u32(r.accel, 1, 2000000);
+    g_dir      = r.dir ? 1 : 0;
+    g_en       = (r.flags & PF_F_EN) ? 1 : 0;
+    applyDirPin();
+    applyEnablePin();
+    stepper->setCurrentPosition(r.pos);
+    g_pfRestored = true;
+    g_pfBootUs = r.saveUs;
+  }
+  pfMarkUsed();
+  g_pfOk = true;
+}
+
+// Останов шагов и снимок для записи; из StepTask или при приостановленной StepTask.
+static void pfHalt() {
+  s_pfMoving = stepper->isRunning();
+  stepper->forceStop();
+  s_pfPos = stepper->getCurrentPosition();
+}
+
+// В начале прохода StepTask.
+static void pfStep() {
+  if (s_pfReq) {
+    pfHalt();
+    s_pfParked = true;
+    xTaskNotifyGive(s_pfTask);
+    while (s_pfReq) ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(10));
+    s_pfParked = false;
+  }
+  if (s_pfStopModes) {
+    s_pfStopModes = false;
+    requestStop();
+  }
+}
+
+static void pfSave(int64_t t0) {
+  PfRecord r;
+  memset(&r, 0xFF, sizeof(r));
+  r.magic = PF_MAGIC;
+  r.dir   = g_dir;
+  r.flags = (g_en ? PF_F_EN : 0) | (s_pfMoving ? PF_F_MOVING : 0) | (s_mo.want ? PF_F_RUNREQ : 0);
+  r.seq   = s_pfPlan.seq;
+  r.pos   = s_pfPos;
+  r.freq  = g_userFreq;
+  r.accel = g_accel;
+  r.sum   = pfSum(r);
+
+  size_t a = pfAddr(s_pfPlan.sec, s_pfPlan.slot);
+  esp_partition_write(s_pfPart, a, &r, offsetof(PfRecord, saveUs));
+  uint32_t us = (uint32_t)(esp_timer_get_time() - t0);
+  esp_partition_write(s_pfPart, a + offsetof(PfRecord, saveUs), &us, sizeof(us));
+
+  g_pfOk = false;    // слот израсходован, следующий — после pfPrepare()
+  g_pfSaves++;
+  g_pfSaveUs = us;
+  if (us > g_pfSaveMaxUs) g_pfSaveMaxUs = us;
+}
+
+static void PowerTask(void* arg) {
+  while (true) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+    bool test = s_pfTest;
+    s_pfTest = false;
+    if (!g_pfOk || (!test && digitalRead(PIN_PF))) continue;   // помеха на входе
+
+    int64_t t0 = esp_timer_get_time();
+    s_pfParked = false;
+    s_pfReq = true;
+    xTaskNotifyGive(s_stepTask);
+    while (!s_pfParked && esp_timer_get_time() - t0 < PF_STEP_WAIT_US) ulTaskNotifyTake(pdTRUE, 1);
+    bool parked = s_pfParked;
+    if (!parked) {
+      vTaskSuspend(s_stepTask);
+      pfHalt();
+    }
+    pfSave(t0);
+    LOGW("power fail%s: saved in %lu us", test ? " (test)" : "", (unsigned long)g_pfSaveUs);
+
+    // питание могло и вернуться: ждём его стабильным, потом работаем дальше
+    uint32_t okMs = 0;
+    while (!test && okMs < PF_RECOVER_MS) {
+      vTaskDelay(pdMS_TO_TICKS(10));
+      okMs = digitalRead(PIN_PF) ? okMs + 10 : 0;
+    }
+
+    // режимы и автомат снимет StepTask (pfStep)
+    g_pfOk = pfPrepare();
+    pfMarkUsed();
+    s_pfStopModes = true;
+    s_pfReq = false;
+    if (parked) xTaskNotifyGive(s_stepTask);
+    else vTaskResume(s_stepTask);
+  }
+}
+
+static void pfStart() {
+  if (!s_pfPart) return;
+  pinMode(PIN_PF, INPUT);
+  xTaskCreatePinnedToCore(PowerTask, "Power", 3072, nullptr, 5, &s_pfTask, 1);
+  attachInterrupt(digitalPinToInterrupt(PIN_PF), pfIsr, FALLING);
+}
+
+// ===== NVS writer =====
+// Запись в NVS идёт миллисекундами и требует стека, поэтому StepTask её не
+// делает: снимает копию данных и будит NvsTask (приоритет 1). want —
+// данные надо записать (ставит StepTask), busy — копия снята и ждёт записи
+// (ставит StepTask, снимает NvsTask); пока busy, копию не трогают, новая
+// снимется следующим проходом nvsStage().
+struct NvsJob {
+  volatile bool want;
+  volatile bool busy;
+};
+
+static TaskHandle_t s_nvsTask = nullptr;
+
+// ===== Lifetime counters =====
+// Копятся в StepTask (life.h), в NVS — одним блобом, только если что-то
+// изменилось и не чаще s_lifePeriodS (из ресурса флеша). Запись во флеш
+// на время останавливает кэш обоих ядер, поэтому пишем на стоящем
+// двигателе, а на ходу — не чаще LIFE_RUN_FLUSH_S. Досрочно — при en=0
+// (не чаще LIFE_MIN_S), по `life save` (только без движения) и перед
+// esp_restart(). При пропадании питания теряется не больше одного периода.
+#ifndef LIFE_RUN_FLUSH_S
+#define LIFE_RUN_FLUSH_S 3600
+#endif
+#ifndef LIFE_MIN_S
+#define LIFE_MIN_S 60
+#endif
+
+static LifeData  g_life = {};
+static LifeTrack s_lifeTrk = {};
+static volatile bool s_lifeDirty = false;
+static uint32_t  s_lifeSavedMs = 0;
+static uint32_t  s_lifePeriodS = 0;
+static volatile uint32_t g_lifeSaveUs = 0;
+static LifeData  s_lifeOut;                // копия под запись
+static NvsJob    s_nvsLife = {};
+
+// Неудача — снова dirty, запишется по расписанию.
+static void lifeWrite(const LifeData& d) {
+  uint32_t t0 = micros();
+  Preferences nvs;
+  if (!nvs.begin("life", false)) {
+    s_lifeDirty = true;
+    return;
+  }
+  nvs.putBytes("data", &d, sizeof(d));
+  nvs.end();
+  g_lifeSaveUs = micros() - t0;
+}
+
+// Из StepTask: запишет NvsTask.
+static void lifeSave() {
+  s_nvsLife.want = true;
+}
+
+// Перед esp_restart() задачи уже не дождаться — пишем сразу.
+static void lifeShutdown() {
+  if (!s_lifeDirty) return;
+  g_life.saves++;
+  s_lifeDirty = false;
+  lifeWrite(g_life);
+}
+
+static void lifeLoad() {
+  Preferences nvs;
+  bool ok = nvs.begin("life", true);
+  if (!ok || nvs.getBytes("data", &g_life, sizeof(g_life)) != sizeof(g_life) || !lifeValid(g_life)) lifeReset(g_life);
+  if (ok) nvs.end();
+
+  g_life.boots++;
+  s_lifeDirty = true;
+  s_lifePeriodS = lifeFlushPeriodS(LIFE_NVS_BYTES, sizeof(LifeData));
+  lifeResync(s_lifeTrk, stepper->getCurrentPosition(), millis());
+  esp_register_shutdown_handler(lifeShutdown);
+}
+
+// Каждый проход StepTask: приращение позиции и время в движении.
+static inline void lifePass() {
+  if (lifeTick(g_life.ax[0], s_lifeTrk, stepper->getCurrentPosition(), stepper->isRunning(), millis())) {
+    s_lifeDirty = true;
+  }
+}
+
+// Раз в 10 мс: пиковая скорость и запись по расписанию.
+static void lifePoll(uint32_t now) {
+  int32_t mhz = stepper->getCurrentSpeedInMilliHz();
+  if (lifePeak(g_life.ax[0], (uint32_t)(mhz < 0 ? -mhz : mhz) / 1000)) s_lifeDirty = true;
+
+  if (!s_lifeDirty) return;
+  uint32_t age = now - s_lifeSavedMs;
+  if (age < s_lifePeriodS * 1000UL) return;
+  if (stepper->isRunning() && age < LIFE_RUN_FLUSH_S * 1000UL) return;
+  lifeSave();
+}
+
+// ===== Ramp buffers =====
+// Пакетное масштабирование таблиц периодов (rampbuf.h): на S3 — PIE,
+// иначе скалярно. При загрузке общий набор проверок сверяет ядро со
+// скалярным; расхождение — предупреждение в лог и simd=0. `rb` — проверка,
+// хэш (тот же, что у tools/rampbuf_check.cpp) и такты на слово обоих.
+static uint16_t s_rbIn[RB_CHECK_N]  RB_ALIGNED;
+static uint16_t s_rbRef[RB_CHECK_N] RB_ALIGNED;
+static uint16_t s_rbOut[RB_CHECK_N] RB_ALIGNED;
+static bool     g_rbSimd = false;
+// буферы и регистры PIE — одни на все задачи консоли
+static SemaphoreHandle_t s_rbLock = nullptr;
+
+static RbResult rbSelfTest() {
+  return rbCheck(rbScale, s_rbIn, s_rbRef, s_rbOut);
+}
+
+static void rbInit() {
+  RbResult r = rbSelfTest();
+  g_rbSimd = RB_SIMD && !r.mismatches;
+  if (r.mismatches) LOGW("rb: %lu mismatches, scalar only", (unsigned long)r.mismatches);
+}
+
+// Такты на один проход по RB_CHECK_N словам, лучший из reps.
+static uint32_t rbCycles(RbKernel k, int reps) {
+  rbUnitFill(s_rbIn, 1000, RB_CHECK_N);
+  RbScale s = rbScaleFor(g_accel);
+  uint32_t best = UINT32_MAX;
+  for (int i = 0; i < reps; i++) {
+    uint32_t c0 = ESP.getCycleCount();
+    k(s_rbOut, s_rbIn, RB_CHECK_N, s);
+    uint32_t c = ESP.getCycleCount() - c0;
+    if (c < best) best = c;
+  }
+  return best;
+}
+
+// ===== Resonance scan =====
+// Проход по частоте шагов от f0 до f1 (геометрическая сетка): на каждой
+// точке — выход на скорость, выдержка RES_SETTLE_MS, затем средний
+// vibLevel() по RES_FRAMES кадрам VibTask. Едет вперёд непрерывно,
+// как по "start". После остановки — resAnalyze(); полосы пишутся в NVS
+// и сразу действуют на заданную скорость (applyParamsToStepper, shapeTick).
+static const uint32_t  RES_SETTLE_MS = 150;
+static const uint8_t   RES_FRAMES    = 4;
+static const uint32_t  RES_MOVE_MS   = 5000;   // не вышли на скорость — меряем как есть
+static const ResParams RES_PARAMS    = {448, 20, 30};
+
+enum ScanState : uint8_t { SCAN_IDLE, SCAN_MOVE, SCAN_SETTLE, SCAN_MEASURE, SCAN_FINISH, SCAN_DONE, SCAN_ABORT };
+
+struct ScanReq {
+  uint32_t f0;
+  uint32_t f1;
+  uint16_t n;
+};
+
+struct ResStore {
+  uint8_t n;
+  ResBand b[RES_MAX_BANDS];
+};
+
+static ScanReq  g_scanReq = {200, 20000, 64};        // готовится до CMD_RES, под s_stageLock
+static ResPoint g_scanPts[RES_MAX_PTS];
+static volatile uint8_t  g_scanState = SCAN_IDLE;
+static volatile uint16_t g_scanI     = 0;            // точек измерено
+static volatile uint32_t g_vibLevel  = 0;            // пишет VibTask
+static volatile uint32_t g_vibSeq    = 0;
+
+static ScanReq  s_scan;
+static uint32_t s_scanT       = 0;
+static uint32_t s_scanSeq     = 0;
+static uint32_t s_scanAcc     = 0;
+static uint8_t  s_scanFrames  = 0;
+static bool     s_scanSkip    = false;
+static bool     s_scanVibWas  = false;
+static uint32_t s_scanUserHz  = 0;
+
+static void resLoad() {
+  Preferences nvs;
+  if (!nvs.begin("res", true)) return;
+  ResStore s;
+  if (nvs.getBytes("bands", &s, sizeof(s)) == sizeof(s) && s.n <= RES_MAX_BANDS) {
+    memcpy(g_resBand, s.b, sizeof(s.b));
+    g_resBands = s.n;
+  }
+  nvs.end();
+}
+
+static ResStore s_resOut;                  // копия под запись
+static NvsJob   s_nvsRes = {};
+
+static void resWrite(const ResStore& s) {
+  Preferences nvs;
+  if (!nvs.begin("res", false)) return;
+  nvs.putBytes("bands", &s, sizeof(s));
+  nvs.end();
+}
+
+// Из StepTask: запишет NvsTask.
+static void resSave() {
+  s_nvsRes.want = true;
+}
+
+static void scanPoint(uint16_t i) {
+  float k = s_scan.n > 1 ? (float)i / (s_scan.n - 1) : 0.0f;
+  g_userFreq = clamp_u32((uint32_t)lrintf(s_scan.f0 * powf((float)s_scan.f1 / s_scan.f0, k)), 1, FREQ_MAX);
+  moSpeed();
+  s_scanT = millis();
+  g_scanState = SCAN_MOVE;
+}
+
+static void scanStart() {
+  stageLock();
+  ScanReq r = g_scanReq;
+  stageUnlock();
+  if (!stepper || !g_en || g_alarm || g_scanOn || g_shapeType != SHAPE_NONE) return;
+  if (g_camOn || g_mpgOn || g_arcOn || streamActive() || stepper->isRunning()) return;
+  if (r.n < 2 || r.n > RES_MAX_PTS || r.f0 < 1 || r.f1 <= r.f0 || r.f1 > FREQ_MAX) return;
+
+  s_scan = r;
+  s_scanUserHz = g_userFreq;
+  s_scanVibWas = g_vibOn;
+  g_vibOn = true;
+  g_scanI = 0;
+  g_scanOn = true;
+  scanPoint(0);
+  requestStart();
+}
+
+static void scanEnd(uint8_t state) {
+  g_scanOn = false;
+  g_scanState = state;
+  g_vibOn = s_scanVibWas;
+  g_userFreq = s_scanUserHz;
+  applyParamsToStepper();
+}
+
+static void scanAbort() {
+  if (!g_scanOn) return;
+  moEvent(MO_EV_STOP);
+  scanEnd(SCAN_ABORT);
+}
+
+static void scanTick() {
+  if (!g_scanOn || !stepper) return;
+  uint32_t now = millis();
+
+  // stop, авария, EN, другой режим — проход прерван
+  if (g_scanState != SCAN_FINISH && !s_mo.want) {
+    scanEnd(SCAN_ABORT);
+    return;
+  }
+
+  switch (g_scanState) {
+    case SCAN_MOVE: {
+      int32_t mhz = stepper->getCurrentSpeedInMilliHz();
+      uint64_t cur = (uint64_t)(mhz < 0 ? -mhz : mhz) * 100;
+      if (cur >= (uint64_t)g_userFreq * 99000 || (uint32_t)(now - s_scanT) >= RES_MOVE_MS) {
+        s_scanT = now;
+        g_scanState = SCAN_SETTLE;
+      }
+      break;
+    }
+
+    case SCAN_SETTLE:
+      if ((uint32_t)(now - s_scanT) < RES_SETTLE_MS) break;
+      s_scanSeq = g_vibSeq;
+      s_scanAcc = 0;
+      s_scanFrames = 0;
+      s_scanSkip = true;        // кадр, начатый ещё до выдержки
+      g_scanState = SCAN_MEASURE;
+      break;
+
+    case SCAN_MEASURE:
+      if (g_vibSeq == s_scanSeq) break;
+      s_scanSeq = g_vibSeq;
+      if (s_scanSkip) { s_scanSkip = false; break; }
+      s_scanAcc += g_vibLevel;
+      if (++s_scanFrames < RES_FRAMES) break;
+
+      g_scanPts[g_scanI] = {g_userFreq, s_scanAcc / RES_FRAMES};
+      if (++g_scanI < s_scan.n) {
+        scanPoint(g_scanI);
+        break;
+      }
+      moEvent(MO_EV_STOP);
+      g_scanState = SCAN_FINISH;
+      break;
+
+    case SCAN_FINISH:
+      if (stepper->isRunning()) break;
+      g_resBands = resAnalyze(g_scanPts, g_scanI, RES_PARAMS, g_resBand);
+      resSave();
+      LOGI("res scan: %u points, %u bands", (unsigned)g_scanI, (unsigned)g_resBands);
+      scanEnd(SCAN_DONE);
+      break;
+  }
+}
+
+// ===== Accel tuning =====
+// Ходы на g_tuneDist шагов туда-обратно со скоростью g_userFreq и
+// растущим ускорением (atune.h). Каждую 1 мс позиция FAS сверяется
+// с энкодером двигателя; ошибка больше g_tuneTol — срыв: forceStop
+// и позиция FAS переписывается по энкодеру. Итог с запасом становится
+// g_accel и хранится в NVS. Время хода меряется на исходном ускорении
+// (первый ход) и на итоговом (проверка).
+static const uint32_t TUNE_TICK_US = 1000;
+static const uint8_t  TUNE_REPS    = 3;
+static const uint8_t  TUNE_BISECT  = 4;
+static const uint16_t TUNE_GROWTH  = 1250;   // x1.25 на шаг поиска
+static const uint16_t TUNE_MARGIN  = 750;    // итог — 75% надёжного
+
+enum TuneState : uint8_t { TUNE_IDLE, TUNE_MOVE, TUNE_DONE, TUNE_FAIL, TUNE_ABORT };
+
+static Atune s_tune = {};
+static volatile uint8_t  g_tuneState  = TUNE_IDLE;
+static volatile uint32_t g_tuneDist   = 3200;   // шаги
+static volatile uint32_t g_tuneTol    = 32;     // шаги
+static volatile uint32_t g_tuneAccel  = 0;      // ускорение текущего хода
+static volatile uint32_t g_tuneFrom   = 0;      // g_accel до подбора
+static volatile uint32_t g_tuneOldUs  = 0;      // время хода на g_tuneFrom
+static volatile uint32_t g_tuneNewUs  = 0;      // время хода на итоге
+static volatile int32_t  g_tuneMaxErr = 0;      // по последнему ходу
+
+static int32_t  s_tuneOrigin    = 0;
+static int32_t  s_tuneEncOrigin = 0;
+static int32_t  s_tuneSign      = 1;
+static uint32_t s_tuneT0        = 0;
+static uint32_t s_tuneLastUs    = 0;
+
+static void atuneLoad() {
+  Preferences nvs;
+  if (!nvs.begin("atune", true)) return;
+  g_accel = clamp_u32(nvs.getUInt("accel", g_accel), 1, 2000000);
+  nvs.end();
+}
+
+static uint32_t s_atuneOut;                // копия под запись
+static NvsJob   s_nvsAtune = {};
+
+static void atuneWrite(uint32_t accel) {
+  Preferences nvs;
+  if (!nvs.begin("atune", false)) return;
+  nvs.putUInt("accel", accel);
+  nvs.end();
+}
+
+// Из StepTask: запишет NvsTask.
+static void atuneSave() {
+  s_nvsAtune.want = true;
+}
+
+static void tuneMove() {
+  s_tuneOrigin = stepper->getCurrentPosition();
+  s_tuneEncOrigin = s_mstEnc.pos;
+  s_tuneSign = -s_tuneSign;
+  g_tuneAccel = s_tune.accel;
+  g_tuneMaxErr = 0;
+
+  stepper->setSpeedInHz(resFreq(clamp_u32(g_userFreq, 1, FREQ_MAX)));
+  stepper->setAcceleration(clamp_u32(s_tune.accel, 1, 2000000));
+  stepper->moveTo(s_tuneOrigin + s_tuneSign * (int32_t)g_tuneDist);
+  s_tuneT0 = micros();
+  g_tuneState = TUNE_MOVE;
+}
+
+static void tuneStart(uint32_t dist) {
+  if (!stepper || !g_en || g_alarm || g_tuneOn || g_scanOn || g_shapeType != SHAPE_NONE) return;
+  if (g_camOn || g_mpgOn || g_arcOn || streamActive() || stepper->isRunning()) return;
+  if (dist) g_tuneDist = clamp_u32(dist, 16, 1000000);
+
+  const AtuneCfg c = {clamp_u32(g_accel, 1, 2000000), 2000000, TUNE_GROWTH, TUNE_REPS, TUNE_BISECT, TUNE_MARGIN};
+  atuneBegin(s_tune, c);
+  moEvent(MO_EV_STOP);
+  g_tuneFrom = g_accel;
+  g_tuneOldUs = 0;
+  g_tuneNewUs = 0;
+  s_tuneSign = -1;               // первый ход — вперёд
+  g_tuneOn = true;
+  tuneMove();
+}
+
+static void tuneEnd(uint8_t state) {
+  g_tuneOn = false;
+  g_tuneState = state;
+  applyParamsToStepper();
+}
+
+static void tuneTick() {
+  uint32_t now = micros();
+  uint32_t dt = now - s_tuneLastUs;
+  if (dt < TUNE_TICK_US) return;
+  s_tuneLastUs = now;
+
+  if (g_tuneState != TUNE_MOVE || !stepper) return;
+
+  // stop, авария, EN или другой режим — подбор прерван; пробный ход
+  // тормозим, если двигатель не забрал другой режим
+  bool other = s_mo.want || g_camOn || g_mpgOn || g_arcOn || g_scanOn || streamActive();
+  if (!g_tuneOn || !g_en || g_alarm || other) {
+    if (!other) stepper->stopMove();
+    tuneEnd(TUNE_ABORT);
+    return;
+  }
+
+  int32_t enc = s_mstEnc.pos - s_tuneEncOrigin;
+  int32_t err = atuneErr(enc, stepper->getCurrentPosition() - s_tuneOrigin, ATUNE_ENC_NUM, ATUNE_ENC_DEN);
+  if (abs(err) > g_tuneMaxErr) g_tuneMaxErr = abs(err);
+
+  bool running = stepper->isRunning();
+  if (running && g_tuneMaxErr > (int32_t)g_tuneTol) {
+    stepper->forceStop();
+    running = false;
+  }
+  if (running) return;
+
+  bool ok = g_tuneMaxErr <= (int32_t)g_tuneTol;
+  if (!ok) {
+    // двигатель остался там, где его видит энкодер
+    stepper->setCurrentPosition(s_tuneOrigin + (int32_t)((int64_t)enc * ATUNE_ENC_DEN / ATUNE_ENC_NUM));
+    lifeResync(s_lifeTrk, stepper->getCurrentPosition(), millis());
+  }
+
+  uint32_t us = micros() - s_tuneT0;
+  if (s_tune.trials == 0 && ok) g_tuneOldUs = us;
+  if (s_tune.phase == AT_VERIFY && ok) g_tuneNewUs = us;
+
+  if (atuneNext(s_tune, ok)) {
+    tuneMove();
+    return;
+  }
+  if (s_tune.phase == AT_DONE) {
+    g_accel = s_tune.result;
+    atuneSave();
+    LOGI("tune: accel %lu -> %lu after %u moves", (unsigned long)g_tuneFrom, (unsigned long)g_accel, (unsigned)s_tune.trials);
+    tuneEnd(TUNE_DONE);
+  } else {
+    tuneEnd(TUNE_FAIL);
+  }
+}
+
+// ===== Trigger start =====
+// trig arm: рампа до заданной скорости в направлении dir считается сразу
+// (trig.h), TRIG_PRIME записей ложатся в очередь FAS без запуска, ещё
+// одна ждёт в s_trigKick. Очередь FAS не для прерываний (её блокировка,
+// её же доливает StepTask), поэтому прерывание по фронту на PIN_TRIG
+// только запоминает такт и будит StepTask уведомлением; первым делом в
+// проходе trigKick() добавляет s_trigKick с запуском очереди. Дальше
+// trigTick() доливает очередь, trig off или stop — торможение до нуля.
+// Платы на одной линии запуска стартуют с разбросом в пределах своих
+// задержек.
+//
+// Задержка фронт -> первый шаг меряется счётчиком тактов: второе
+// прерывание — по фронту на самом PIN_STEP (вход включён поверх выхода
+// FAS), оба на ядре 1. В замер входит всё: пробуждение StepTask (или
+// дохождение текущего прохода до конца) и добавление записи; не входит
+// только вход в прерывание до чтения счётчика (~1–2 мкс).
+#ifndef PIN_TRIG
+#define PIN_TRIG 14
+#endif
+#ifndef TRIG_EDGE
+#define TRIG_EDGE RISING
+#endif
+
+static TrigRamp          s_trigRamp = {};
+static stepper_command_s s_trigKick = {};
+static TrigStats         g_trigStats = {};
+static volatile uint32_t s_trigEdgeCc   = 0;
+static volatile uint32_t s_trigStepCc   = 0;
+static volatile bool     s_trigFired    = false;
+static volatile bool     s_trigStepSeen = false;
+static volatile uint32_t g_trigEdges    = 0;    // все фронты, и без взведения
+static volatile uint32_t g_trigArmUs    = 0;    // сколько заняло взведение
+
+static void IRAM_ATTR trigIsr() {
+  uint32_t cc = ESP.getCycleCount();
+  g_trigEdges++;
+  if (g_trigState != TRIG_ARMED || s_trigFired) return;
+  s_trigEdgeCc = cc;
+  s_trigFired = true;
+  BaseType_t woken = pdFALSE;
+  vTaskNotifyGiveFromISR(s_stepTask, &woken);
+  if (woken) portYIELD_FROM_ISR();
+}
+
+static void IRAM_ATTR trigStepIsr(void*) {
+  s_trigStepCc = ESP.getCycleCount();
+  s_trigStepSeen = true;
+  gpio_intr_disable((gpio_num_t)PIN_STEP);
+}
+
+static void trigInit() {
+  pinMode(PIN_TRIG, INPUT);
+  attachInterrupt(digitalPinToInterrupt(PIN_TRIG), trigIsr, TRIG_EDGE);
+  // сервис прерываний GPIO уже поставлен attachInterrupt
+  PIN_INPUT_ENABLE(GPIO_PIN_MUX_REG[PIN_STEP]);
+  gpio_set_intr_type((gpio_num_t)PIN_STEP, GPIO_INTR_POSEDGE);
+  gpio_isr_handler_add((gpio_num_t)PIN_STEP, trigStepIsr, nullptr);
+  gpio_intr_disable((gpio_num_t)PIN_STEP);
+}
+
+static void trigArm() {
+  if (!stepper || !g_en || g_alarm || g_scanOn || g_tuneOn) return;
+  if (g_camOn || g_mpgOn || g_arcOn || streamActive() || stepper->isRunning()) return;
+
+  uint32_t t0 = micros();
+  moEvent(MO_EV_STOP);
+  trigRampInit(s_trigRamp, resFreq(clamp_u32(g_userFreq, 1, FREQ_MAX)), clamp_u32(g_accel, 1, 2000000));
+
+  stepper_command_s c;
+  c.count_up = (g_dir == 0);
+  for (int i = 0; i <= TRIG_PRIME; i++) {
+    if (!trigRampNext(s_trigRamp, c.ticks, c.steps)) {
+      // рампа кончилась раньше: заготовленное не должно уйти следующему старту
+      if (i) stepper->forceStop();
+      g_trigState = TRIG_ABORT;
+      return;
+    }
+    if (i == TRIG_PRIME) {
+      s_trigKick = c;
+      break;
+    }
+    if (stepper->addQueueEntry(&c, false) != AQE_OK) {
+      stepper->forceStop();
+      g_trigState = TRIG_ABORT;
+      return;
+    }
+  }
+
+  s_trigStepSeen = false;
+  s_trigFired = false;
+  gpio_intr_enable((gpio_num_t)PIN_STEP);
+  g_trigArmUs = micros() - t0;
+  g_trigState = TRIG_ARMED;
+}
+
+// Фронт пришёл: запуск заготовленной очереди. Начало каждого прохода
+// StepTask, до команд.
+static void trigKick() {
+  if (!s_trigFired) return;
+  s_trigFired = false;
+  if (g_trigState != TRIG_ARMED) return;
+  if (stepper->addQueueEntry(&s_trigKick, true) != AQE_OK) {
+    gpio_intr_disable((gpio_num_t)PIN_STEP);
+    stepper->forceStop();
+    g_trigState = TRIG_ABORT;
+    return;
+  }
+  g_trigState = TRIG_RUN;
+}
+
+static void trigOff() {
+  s_trigFired = false;
+  if (g_trigState == TRIG_ARMED) {
+    g_trigState = TRIG_IDLE;
+    gpio_intr_disable((gpio_num_t)PIN_STEP);
+    stepper->forceStop();        // заготовленная очередь так и не запускалась
+  } else if (g_trigState == TRIG_RUN) {
+    trigRampTarget(s_trigRamp, 0);
+  }
+}
+
+static void trigTick() {
+  if (s_trigStepSeen) {
+    s_trigStepSeen = false;
+    uint32_t ns = (uint32_t)((uint64_t)(s_trigStepCc - s_trigEdgeCc) * 1000 / ESP.getCpuFreqMHz());
+    trigStatsAdd(g_trigStats, ns);
+    LOGI("trig: first step %lu ns after edge", (unsigned long)ns);
+  }
+
+  if (g_trigState != TRIG_RUN || !stepper) return;
+
+  stepper_command_s c;
+  c.count_up = (g_dir == 0);
+  while (!stepper->isQueueFull()) {
+    if (!trigRampNext(s_trigRamp, c.ticks, c.steps)) {
+      if (!stepper->isRunning()) g_trigState = TRIG_DONE;
+      return;
+    }
+    if (stepper->addQueueEntry(&c, true) != AQE_OK) {
+      stepper->forceStop();
+      g_trigState = TRIG_ABORT;
+      return;
+    }
+  }
+}
+
+// Снимок данных для NvsTask (из StepTask); барьер — копия видна раньше busy.
+static void nvsStage() {
+  bool any = false;
+  if (s_nvsLife.want && !s_nvsLife.busy) {
+    g_life.saves++;
+    s_lifeOut = g_life;
+    s_lifeDirty = false;
+    s_lifeSavedMs = millis();
+    s_nvsLife.want = false;
+    __sync_synchronize();
+    s_nvsLife.busy = any = true;
+  }
+  if (s_nvsRes.want && !s_nvsRes.busy) {
+    s_resOut = {};
+    s_resOut.n = g_resBands;
+    memcpy(s_resOut.b, g_resBand, sizeof(s_resOut.b));
+    s_nvsRes.want = false;
+    __sync_synchronize();
+    s_nvsRes.busy = any = true;
+  }
+  if (s_nvsAtune.want && !s_nvsAtune.busy) {
+    s_atuneOut = g_accel;
+    s_nvsAtune.want = false;
+    __sync_synchronize();
+    s_nvsAtune.busy = any = true;
+  }
+  if (any) xTaskNotifyGive(s_nvsTask);
+}
+
+static void NvsTask(void* arg) {
+  while (true) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    if (s_nvsLife.busy) {
+      lifeWrite(s_lifeOut);
+      __sync_synchronize();
+      s_nvsLife.busy = false;
+    }
+    if (s_nvsRes.busy) {
+      resWrite(s_resOut);
+      __sync_synchronize();
+      s_nvsRes.busy = false;
+    }
+    if (s_nvsAtune.busy) {
+      atuneWrite(s_atuneOut);
+      __sync_synchronize();
+      s_nvsAtune.busy = false;
+    }
+  }
+}
+
+// Двигатель едет или его ведёт какой-либо режим.
+static bool motionActive() {
+  return s_mo.want || (stepper && stepper->isRunning()) || g_camOn || g_mpgOn || g_arcOn || g_tuneOn || g_scanOn ||
+         trigActive() || streamActive();
+}
+
+// Чем кончилась команда: для включающих режим — включился ли он.
+static uint8_t cmdOutcome(const Cmd& c) {
+  bool ok = true;
+  switch (c.type) {
+    case CMD_START: ok = s_mo.want; break;
+    case CMD_CAM:   if (c.a == CAM_ON) ok = g_camOn; break;
+    case CMD_MPG:   if (c.a == MPG_ON) ok = g_mpgOn; break;
+    case CMD_ARC:   if (c.a) ok = g_arcOn; break;
+    case CMD_RES:   if (c.a == RES_SCAN) ok = g_scanOn; break;
+    case CMD_TUNE:  if (c.a) ok = g_tuneOn; break;
+    case CMD_TRIG:  if (c.a) ok = trigActive(); break;
+    case CMD_CAM_MASTER: ok = !g_camOn; break;
+    case CMD_LIFE:  ok = !motionActive(); break;
+    default: break;
+  }
+  return ok ? CMD_ST_DONE : CMD_ST_REFUSED;
+}
+
+static void StepTask(void* arg) {
+  uint32_t lastPollMs = 0;
+
+  while (true) {
+    pfStep();
+    trigKick();
+
+    Cmd cmd;
+    while (xQueueReceive(qCmd, &cmd, 0) == pdTRUE) {
+      switch (cmd.type) {
+        case CMD_START:
+          requestStart();
+          break;
+
+        case CMD_STOP:
+          // с формированием тормозим по той же сформированной рампе — только
+          // если двигатель не ведёт режим: дуга и потоки PVT и команд шагов
+          // сами остановку не увидят
+          if (g_trigState == TRIG_RUN) trigOff();
+          else if (g_shapeType != SHAPE_NONE && !g_camOn && !g_mpgOn && !g_arcOn && !pvtActive() && !scActive())
+            moEvent(MO_EV_STOP);
+          else requestStop();
+          break;
+
+        case CMD_FREQ:
+          g_userFreq = clamp_u32(cmd.a, 1, FREQ_MAX);
+          moSpeed();
+          break;
+
+        case CMD_ACCEL:
+          g_accel = clamp_u32(cmd.a, 1, 2000000);
+          moSpeed();
+          break;
+
+        case CMD_DIR:
+          // направление старта по фронту уже в заготовленной очереди
+          if (!trigActive()) moEvent(MO_EV_DIR, cmd.a ? 1 : 0);
+          break;
+
+        case CMD_EN:
+          g_en = cmd.a ? 1 : 0;
+          applyEnablePin();
+          moEvent(g_en ? MO_EV_ENABLE : MO_EV_DISABLE);
+          if (!g_en && s_lifeDirty && millis() - s_lifeSavedMs >= LIFE_MIN_S * 1000UL) lifeSave();
+          break;
+
+        case CMD_RAMP: {
+          uint32_t target = clamp_u32(cmd.a, 1, FREQ_MAX);
+          uint32_t ms = clamp_u32(cmd.b, 50, 60000);
+
+          uint32_t cur = g_userFreq;
+          uint32_t diff = (target > cur) ? (target - cur) : (cur - target);
+          uint32_t acc = (diff == 0) ? g_accel : (uint32_t)((uint64_t)diff * 1000ULL / ms);
+
+          g_userFreq = target;
+          g_accel = clamp_u32(acc, 1, 2000000);
+
+          moSpeed();
+          requestStart();
+          break;
+        }
+
+        case CMD_CAM:
+          if (cmd.a == CAM_ON) camEngage();
+          else if (cmd.a == CAM_OFF) {
+            g_camOn = false;
+            if (stepper) stepper->stopMove();
+          } else if (cmd.a == CAM_LOAD) {
+            // новая таблица — во второй буфер; на ходу без скачка
+            // переключаться нельзя, поэтому кулачок останавливаем
+            if (g_camOn) {
+              g_camOn = false;
+              if (stepper) stepper->stopMove();
+            }
+            stageLock();
+            g_cam[g_camIdx ^ 1] = g_camNext;
+            stageUnlock();
+            g_camIdx ^= 1;
+          }
+          break;
+
+        case CMD_CAM_MASTER:
+          if (g_camOn) break;
+          g_camMaster = cmd.a ? CAM_MST_VIRT : CAM_MST_ENC;
+          s_mstVirt.rate = (int32_t)cmd.b;
+          break;
+
+        case CMD_MPG:
+          if (cmd.a == MPG_ON) mpgEngage();
+          else if (cmd.a == MPG_OFF) {
+            g_mpgOn = false;
+            if (stepper) stepper->stopMove();
+          } else if (cmd.a == MPG_SCALE) {
+            g_mpgScale = (cmd.b >= 100) ? 100 : (cmd.b >= 10) ? 10 : 1;
+          }
+          break;
+
+        case CMD_SHAPE:
+          shapeConfigure((uint8_t)(cmd.a & 0xFF), (uint16_t)(cmd.a >> 16), (uint16_t)cmd.b);
+          break;
+
+        case CMD_PVT:
+          if (!pvtActive()) g_pvtState = PVT_PREFILL;
+          s_pvtPending = false;
+          break;
+
+        case CMD_STEPCMD:
+          if (!scActive()) g_scState = PVT_PREFILL;
+          s_scPending = false;
+          break;
+
+        case CMD_ARC:
+          if (cmd.a) arcEngage();
+          else if (g_arcOn) {
+            g_arcOn = false;
+            if (stepper) stepper->stopMove();
+          }
+          break;
+
+        case CMD_RES:
+          if (cmd.a == RES_SCAN) scanStart();
+          else if (cmd.a == RES_STOP) scanAbort();
+          else if (cmd.a == RES_CLEAR && !g_scanOn) {
+            g_resBands = 0;
+            resSave();
+            moSpeed();
+          }
+          break;
+
+        case CMD_TUNE:
+          if (cmd.a) tuneStart(cmd.b);
+          else if (g_tuneOn) {
+            g_tuneOn = false;        // tuneTick() вернёт параметры
+            stepper->stopMove();
+          }
+          break;
+
+        case CMD_TRIG:
+          if (cmd.a) trigArm();
+          else trigOff();
+          break;
+
+        case CMD_LIFE:
+          // по запросу — без проверки периода, но только без движения
+          if (!motionActive()) lifeSave();
+          break;
+
+        case CMD_STATUS:
+          break;
+      }
+
+      if (cmd.seq) {
+        uint8_t st = cmdOutcome(cmd);
+        portENTER_CRITICAL(&s_cmdMux);
+        CmdRec* r = cmdlogBySeq(s_cmdLog, cmd.seq);
+        if (r) r->st = st;
+        portEXIT_CRITICAL(&s_cmdMux);
+      }
+    }
+
+    camTick();
+    mpgTick();
+    shapeTick();
+    pvtTick();
+    scTick();
+    arcTick();
+    scanTick();
+    tuneTick();
+    trigTick();
+
+    uint32_t now = millis();
+    if ((uint32_t)(now - lastPollMs) >= 10) {
+      lastPollMs = now;
+      bool al = readAlarm();
+      if (al != g_alarm) {
+        g_alarm = al;
+        moEvent(al ? MO_EV_ALARM : MO_EV_CLEAR);
+        if (al) {
+          g_life.alarms++;
+          s_lifeDirty = true;
+        }
+      }
+      if (stepper) lifePoll(now);
+    }
+    nvsStage();
+
+    if (stepper) {
+      // на скорости — в пределах 1 %, но не точнее 2 Гц
+      uint32_t want = resFreq(clamp_u32(g_userFreq, 1, FREQ_MAX));
+      uint32_t cur = moSpeedNow();
+      uint32_t diff = cur > want ? cur - want : want - cur;
+      uint32_t tol = want / 100 > 2 ? want / 100 : 2;
+      moFeed(s_mo, stepper->isRunning(), diff <= tol, s_moHooks);
+    }
+
+    if (stepper) {
+      retainSave();
+      lifePass();
+    }
+
+    // 1 мс или раньше — по фронту trig
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(1));
+  }
+}
+
+// ===== Analog input =====
+// АЦП в непрерывном режиме с DMA; задача только разбирает готовые кадры.
+// Каналы AIN и VIB чередуются, на каждый — половина частоты преобразований.
+static const uint32_t ADC_SAMPLE_HZ = 40000;
+static const uint32_t VIB_FS        = ADC_SAMPLE_HZ / 2;
+static const uint32_t ADC_FRAME     = 256;   // байт за одно прерывание DMA
+
+static AinParams g_ainCfg = {6, 40, 24, 1, 100000};
+static volatile bool     g_ainOn  = false;
+static volatile bool     g_ainRst = false;
+static volatile uint16_t g_ainRaw = 0;      // фильтрованное значение, отсчёты
+static volatile uint32_t g_ainSps = 0;      // отсчётов/с, измерено
+static volatile uint32_t g_ainUps = 0;      // обновлений задания/с, измерено
+
+// Кадры вибрации: AdcTask заполняет один буфер, VibTask считает другой.
+static uint16_t s_vibBuf[2][VIB_N];
+static uint16_t s_vibN    = 0;
+static uint8_t  s_vibFill = 0;
+static volatile uint8_t  s_vibFrame   = 0;
+static volatile bool     s_vibBusy    = false;
+static volatile uint32_t s_vibStepMhz = 0;     // скорость шагов на момент кадра
+static TaskHandle_t s_vibTask = nullptr;
+static volatile uint32_t g_vibDrops  = 0;      // кадров пропущено: VibTask не успела
+
+static void vibPush(uint16_t v) {
+  s_vibBuf[s_vibFill][s_vibN++] = v;
+  if (s_vibN < VIB_N) return;
+  s_vibN = 0;
+
+  if (s_vibBusy || !s_vibTask) {
+    g_vibDrops++;
+    return;
+  }
+  int32_t mhz = stepper ? stepper->getCurrentSpeedInMilliHz() : 0;
+  s_vibStepMhz = (uint32_t)(mhz < 0 ? -mhz : mhz);
+  s_vibFrame = s_vibFill;
+  s_vibBusy = true;
+  s_vibFill ^= 1;
+  xTaskNotifyGive(s_vibTask);
+}
+
+// Формат записи DMA АЦП: на S3 — только TYPE2.
+#if CONFIG_IDF_TARGET_ESP32S3
+#define ADC_FORMAT ADC_DIGI_OUTPUT_FORMAT_TYPE2
+#define ADC_RES(d) ((d)->type2)
+#else
+#define ADC_FORMAT ADC_DIGI_OUTPUT_FORMAT_TYPE1
+#define ADC_RES(d) ((d)->type1)
+#endif
+
+static void adcInit() {
+  adc_digi_init_config_t ic = {};
+  ic.max_store_buf_size = 4 * ADC_FRAME;
+  ic.conv_num_each_intr = ADC_FRAME;
+  ic.adc1_chan_mask = BIT(AIN_CH) | BIT(VIB_CH);
+  ic.adc2_chan_mask = 0;
+  adc_digi_initialize(&ic);
+
+  static adc_digi_pattern_config_t pat[2];
+  pat[0].atten = ADC_ATTEN_DB_11;
+  pat[0].channel = AIN_CH;
+  pat[0].unit = 0;
+  pat[0].bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
+  pat[1] = pat[0];
+  pat[1].channel = VIB_CH;
+
+  adc_digi_configuration_t dc = {};
+  dc.conv_limit_en = 1;
+  dc.conv_limit_num = 250;
+  dc.sample_freq_hz = ADC_SAMPLE_HZ;
+  dc.conv_mode = ADC_CONV_SINGLE_UNIT_1;
+  dc.format = ADC_FORMAT;
+  dc.pattern_num = 2;
+  dc.adc_pattern = pat;
+  adc_digi_controller_configure(&dc);
+
+  adc_digi_start();
+}
+
+static void AdcTask(void* arg) {
+  static uint8_t buf[ADC_FRAME];
+  AinFilter f;
+  ainReset(f);
+
+  uint32_t samples = 0, updates = 0;
+  uint32_t t0 = millis();
+
+  while (true) {
+    uint32_t got = 0;
+    if (adc_digi_read_bytes(buf, sizeof(buf), &got, 100) == ESP_OK) {
+      if (g_ainRst) { g_ainRst = false; ainReset(f); }
+
+      AinParams p = g_ainCfg;
+      bool changed = false;
+      for (uint32_t i = 0; i + SOC_ADC_DIGI_RESULT_BYTES <= got; i += SOC_ADC_DIGI_RESULT_BYTES) {
+        const adc_digi_output_data_t* d = (const adc_digi_output_data_t*)&buf[i];
+        if (ADC_RES(d).channel == VIB_CH) {
+          if (g_vibOn) vibPush(ADC_RES(d).data);
+          continue;
+        }
+        if (ADC_RES(d).channel != AIN_CH) continue;
+        samples++;
+        if (ainPush(f, p, ADC_RES(d).data)) changed = true;
+      }
+      g_ainRaw = ainValue(f);
+
+      // одно задание на кадр, даже если порог пересекли несколько раз
+      if (changed && g_ainOn) {
+        Cmd c{CMD_FREQ, ainFreq(f, p), 0};
+        if (xQueueSend(qCmd, &c, 0) == pdTRUE) updates++;
+      }
+    }
+
+    uint32_t now = millis();
+    if ((uint32_t)(now - t0) >= 1000) {
+      g_ainSps = samples * 1000 / (now - t0);
+      g_ainUps = updates * 1000 / (now - t0);
+      samples = updates = 0;
+      t0 = now;
+    }
+  }
+}
+
+// ===== Vibration =====
+// БПФ кадра вибрации на ядре 1 с низшим приоритетом: там только StepTask
+// с коротким тиком, ядро 0 занято WiFi и обменом. Пики — в мГц и
+// в отношении к текущей частоте шагов (промилле), так резонанс от
+// шагов отличается от механики, не зависящей от скорости.
+static VibFft  s_vib;
+static VibPeak g_vibPeak[VIB_PEAKS];
+static volatile uint8_t  g_vibPeaks   = 0;
+static volatile uint32_t g_vibStepHz  = 0;
+static volatile uint32_t g_vibUs      = 0;     // время обработки кадра
+static volatile uint32_t g_vibFps     = 0;
+static portMUX_TYPE s_vibMux = portMUX_INITIALIZER_UNLOCKED;
+
+static void VibTask(void* arg) {
+  vibInit(s_vib);
+  uint32_t frames = 0;
+  uint32_t t0 = millis();
+
+  while (true) {
+    if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(1000))) {
+      uint32_t us0 = micros();
+      uint32_t step = s_vibStepMhz;
+      vibLoad(s_vib, s_vibBuf[s_vibFrame]);
+      s_vibBusy = false;             // кадр скопирован, буфер свободен
+      vibFft(s_vib);
+      vibMag(s_vib);
+
+      VibPeak pk[VIB_PEAKS];
+      uint8_t n = vibPeaks(s_vib, VIB_FS, pk);
+      portENTER_CRITICAL(&s_vibMux);
+      memcpy(g_vibPeak, pk, sizeof(pk));
+      g_vibPeaks = n;
+      g_vibStepHz = step / 1000;
+      portEXIT_CRITICAL(&s_vibMux);
+
+      g_vibLevel = vibLevel(s_vib);
+      g_vibSeq++;
+      g_vibUs = micros() - us0;
+      frames++;
+    }
+
+    uint32_t now = millis();
+    if ((uint32_t)(now - t0) >= 1000) {
+      g_vibFps = frames * 1000 / (now - t0);
+      frames = 0;
+      t0 = now;
+    }
+  }
+}
+
+// Снимок пиков; ratio — частота пика к частоте шагов, промилле (0 — стоим).
+static uint8_t vibSnapshot(VibPeak* pk, uint32_t& stepHz) {
+  portENTER_CRITICAL(&s_vibMux);
+  uint8_t n = g_vibPeaks;
+  memcpy(pk, g_vibPeak, sizeof(g_vibPeak));
+  stepHz = g_vibStepHz;
+  portEXIT_CRITICAL(&s_vibMux);
+  return n;
+}
+
+static inline uint32_t vibRatio(uint32_t mhz, uint32_t stepHz) {
+  return stepHz ? (uint32_t)((uint64_t)mhz / stepHz) : 0;
+}
+
+// ===== Profiler =====
+// Выборочный профилировщик: на каждом ядре свой аппаратный таймер
+// (группа 1, таймеры 2 и 3) с прерыванием, выделенным на этом ядре.
+// Прерывание берёт кадр прерванной задачи (pxTopOfStack текущей TCB —
+// туда его кладёт вход в прерывание первого уровня), PC и до
+// PROF_DEPTH-1 адресов возврата, пишет в кольцо своего ядра без
+// блокировок. Символы — на хосте: tools/prof_fold.cpp по ELF.
+// Выключен — таймеры остановлены, прерываний нет. Код в критических
+// секциях (прерывания запрещены) в выборку не попадает: отсчёт
+// приходится на выход из секции.
+#ifndef PROF_N
+#define PROF_N     512       // отсчётов на ядро
+#endif
+#define PROF_DEPTH 4
+#define PROF_TIMER 2         // таймеры PROF_TIMER и PROF_TIMER + 1
+
+struct ProfSample {
+  TaskHandle_t task;         // nullptr — прервано другое прерывание
+  uint32_t pc[PROF_DEPTH];   // pc[0] — точный; дальше адреса возврата (окно в старших битах)
+};
+
+static ProfSample s_prof[2][PROF_N];
+static volatile uint32_t s_profHead[2]   = {0, 0};   // всего отсчётов
+static volatile uint32_t s_profCycles[2] = {0, 0};   // тактов в прерывании
+static hw_timer_t* s_profTimer[2] = {nullptr, nullptr};
+static volatile bool     g_profOn = false;
+static volatile uint32_t g_profHz = 4000;
+
+static void IRAM_ATTR profIsr() {
+  uint32_t c0 = ESP.getCycleCount();
+  uint8_t core = xPortGetCoreID();
+  ProfSample& s = s_prof[core][s_profHead[core] % PROF_N];
+  memset(s.pc, 0, sizeof(s.pc));
+
+  if (xPortInterruptedFromISRContext()) {
+    s.task = nullptr;
+  } else {
+    s.task = xTaskGetCurrentTaskHandle();
+    const XtExcFrame* f = *(const XtExcFrame* const*)s.task;   // pxTopOfStack — первое поле TCB
+    esp_backtrace_frame_t bt = {(uint32_t)f->pc, (uint32_t)f->a1, (uint32_t)f->a0, nullptr};
+    s.pc[0] = bt.pc;
+    for (uint8_t d = 1; d < PROF_DEPTH && bt.next_pc; d++) {
+      if (!esp_backtrace_get_next_frame(&bt)) break;
+      s.pc[d] = bt.pc;
+    }
+  }
+
+  s_profHead[core]++;
+  s_profCycles[core] += ESP.getCycleCount() - c0;
+}
+
+// Выполняется на нужном ядре (esp_ipc): прерывание таймера достаётся ему.
+static void profAlloc(void* arg) {
+  uintptr_t core = (uintptr_t)arg;
+  hw_timer_t* t = timerBegin(PROF_TIMER + core, 80, true);     // 1 МГц
+  timerAttachInterrupt(t, profIsr, true);
+  s_profTimer[core] = t;
+}
+
+static void profInit() {
+  for (uintptr_t c = 0; c < 2; c++) esp_ipc_call_blocking(c, profAlloc, (void*)c);
+}
+
+static void profSet(bool on) {
+  for (uint8_t c = 0; c < 2; c++) {
+    hw_timer_t* t = s_profTimer[c];
+    if (!t) continue;
+    timerAlarmDisable(t);
+    if (!on) continue;
+    timerAlarmWrite(t, 1000000 / clamp_u32(g_profHz, 10, 20000), true);
+    timerWrite(t, 0);
+    timerAlarmEnable(t);
+  }
+  g_profOn = on;
+}
+
+static void profClear() {
+  bool on = g_profOn;
+  profSet(false);
+  for (uint8_t c = 0; c < 2; c++) s_profHead[c] = s_profCycles[c] = 0;
+  profSet(on);
+}
+
+// Среднее время прерывания, такты.
+static uint32_t profIsrCycles(uint8_t core) {
+  return s_profHead[core] ? s_profCycles[core] / s_profHead[core] : 0;
+}
+
+// Текстовый дамп последних отсчётов, кусками по размеру буфера:
+//   # prof hz=<hz> depth=<n> cpu_mhz=<mhz>
+//   # core <c> samples <всего> kept <в кольце> isr_cycles <среднее>
+//   <core> <task> <pc> <ret1> ...
+// Имена задач без пробелов; isr — прервано другое прерывание.
+// Профилирование на время дампа приостанавливается.
+template <typename Emit>
+static void profDump(Emit emit) {
+  bool on = g_profOn;
+  profSet(false);
+
+  char buf[512];
+  size_t len = snprintf(buf, sizeof(buf), "# prof hz=%lu depth=%u cpu_mhz=%lu\n",
+                        (unsigned long)g_profHz, (unsigned)PROF_DEPTH, (unsigned long)ESP.getCpuFreqMHz());
+  for (uint8_t c = 0; c < 2; c++) {
+    uint32_t head = s_profHead[c];
+    uint32_t kept = head < PROF_N ? head : PROF_N;
+    len += snprintf(buf + len, sizeof(buf) - len, "# core %u samples %lu kept %lu isr_cycles %lu\n",
+                    (unsigned)c, (unsigned long)head, (unsigned long)kept, (unsigned long)profIsrCycles(c));
+
+    for (uint32_t i = head - kept; i != head; i++) {
+      if (len > sizeof(buf) - 96) {
+        emit(buf);
+        len = 0;
+      }
+      const ProfSample& s = s_prof[c][i % PROF_N];
+      char name[16] = "isr";
+      if (s.task) snprintf(name, sizeof(name), "%s", pcTaskGetName(s.task));
+      for (char* q = name; *q; q++) if (*q == ' ') *q = '_';
+
+      len += snprintf(buf + len, sizeof(buf) - len, "%u %s", (unsigned)c, name);
+      for (uint8_t d = 0; d < PROF_DEPTH && s.pc[d]; d++) {
+        len += snprintf(buf + len, sizeof(buf) - len, " %08lx", (unsigned long)s.pc[d]);
+      }
+      buf[len++] = '\n';
+      buf[len] = 0;
+    }
+  }
+  emit(buf);
+  profSet(on);
+}
+
+// ===== CAN =====
+// Задача спит в twai_receive ровно до следующей рассылки STATUS,
+// поэтому циклический статус почти ничего не стоит.
+static volatile uint32_t g_canPeriodMs = 100;   // 0 — статус только по SYNC
+static volatile uint32_t g_canRx = 0;
+static volatile uint32_t g_canTx = 0;
+static volatile bool     g_canOk = false;
+
+static void canSendStatus() {
+  CanStatus st;
+  st.flags = (s_mo.want ? CAN_ST_RUNREQ : 0) |
+             ((stepper && stepper->isRunning()) ? CAN_ST_RUNNING : 0) |
+             (g_dir ? CAN_ST_DIR : 0) |
+             (g_en ? CAN_ST_EN : 0) |
+             (g_alarm ? CAN_ST_ALARM : 0);
+  st.freq = g_userFreq;
+  st.pos = stepper ? stepper->getCurrentPosition() : 0;
+
+  CanFrame f;
+  canEncodeStatus(f, CAN_NODE, st);
+
+  twai_message_t m = {};
+  m.identifier = f.id;
+  m.data_length_code = f.dlc;
+  memcpy(m.data, f.data, f.dlc);
+  if (twai_transmit(&m, 0) == ESP_OK) g_canTx++;
+}
+
+static void canApply(const CanReq& r) {
+  Cmd c{CMD_STATUS, 0, 0};
+
+  if (r.kind == CAN_REQ_SETPOINT) {
+    c = {CMD_FREQ, r.a, 0};
+    xQueueSend(qCmd, &c, 0);
+    if (r.b) {
+      c = {CMD_ACCEL, r.b, 0};
+      xQueueSend(qCmd, &c, 0);
+    }
+    return;
+  }
+
+  switch (r.op) {
+    case CAN_OP_STOP:  c = {CMD_STOP, 0, 0}; break;
+    case CAN_OP_START: c = {CMD_START, 0, 0}; break;
+    case CAN_OP_DIR:   c = {CMD_DIR, r.a ? 1u : 0u, 0}; break;
+    case CAN_OP_EN:    c = {CMD_EN, r.a ? 1u : 0u, 0}; break;
+    case CAN_OP_RAMP:  c = {CMD_RAMP, r.a, r.b}; break;
+    case CAN_OP_RATE:  g_canPeriodMs = clamp_u32(r.a, 0, 60000); return;
+  }
+  xQueueSend(qCmd, &c, 0);
+}
+
+static void CanTask(void* arg) {
+  twai_general_config_t g = TWAI_GENERAL_CONFIG_DEFAULT(PIN_CAN_TX, PIN_CAN_RX, TWAI_MODE_NORMAL);
+  twai_timing_config_t t = TWAI_TIMING_CONFIG_500KBITS();
+  twai_filter_config_t fl = TWAI_FILTER_CONFIG_ACCEPT_ALL();
+
+  if (twai_driver_install(&g, &t, &fl) != ESP_OK || twai_start() != ESP_OK) {
+    LOGE("CAN init failed");
+    vTaskDelete(nullptr);
+  }
+  g_canOk = true;
+
+  uint32_t next = millis();
+
+  while (true) {
+    uint32_t period = g_canPeriodMs;
+    uint32_t now = millis();
+    uint32_t wait = 100;
+    if (period) {
+      if ((int32_t)(next - now) <= 0) {
+        canSendStatus();
+        next += period;
+        if ((int32_t)(next - now) <= 0) next = now + period;
+      }
+      wait = next - now;
+      if (wait > period) wait = period;
+    }
+
+    twai_message_t m;
+    if (twai_receive(&m, pdMS_TO_TICKS(wait)) == ESP_OK) {
+      if (m.extd || m.rtr) continue;
+      g_canRx++;
+
+      CanFrame f;
+      f.id = m.identifier;
+      f.dlc = m.data_length_code > 8 ? 8 : m.data_length_code;
+      memcpy(f.data, m.data, f.dlc);
+
+      CanReq r;
+      if (!canDecode(f, CAN_NODE, r)) continue;
+      if (r.kind == CAN_REQ_SYNC) canSendStatus();
+      else canApply(r);
+    }
+
+    // bus-off: восстановление, после него драйвер в STOPPED — запускаем снова
+    twai_status_info_t si;
+    if (twai_get_status_info(&si) == ESP_OK) {
+      if (si.state == TWAI_STATE_BUS_OFF) twai_initiate_recovery();
+      else if (si.state == TWAI_STATE_STOPPED) twai_start();
+    }
+  }
+}
+
+// ===== Modbus RTU =====
+// Конец кадра определяет сам UART по таймауту приёма (~3.5 символа),
+// колбэк только будит задачу — опроса линии нет.
+static RegMap g_regs = {};
+static TaskHandle_t s_mbTask = nullptr;
+static volatile uint32_t g_mbReq = 0;
+static volatile uint32_t g_mbErr = 0;
+
+static void mbOnRx() {
+  if (s_mbTask) xTaskNotifyGive(s_mbTask);
+}
+
+static void mbApply(uint8_t op, uint32_t a, uint32_t b) {
+  Cmd c{CMD_STATUS, 0, 0};
+  switch (op) {
+    case REG_OP_FREQ:  c = {CMD_FREQ, a, 0}; break;
+    case REG_OP_ACC:   c = {CMD_ACCEL, a, 0}; break;
+    case REG_OP_DIR:   c = {CMD_DIR, a, 0}; break;
+    case REG_OP_EN:    c = {CMD_EN, a, 0}; break;
+    case REG_OP_START: c = {CMD_START, 0, 0}; break;
+    case REG_OP_STOP:  c = {CMD_STOP, 0, 0}; break;
+    case REG_OP_RAMP:  c = {CMD_RAMP, a, b}; break;
+    default: return;
+  }
+  xQueueSend(qCmd, &c, 0);
+}
+
+static RegStatus regStatusNow() {
+  RegStatus st;
+  st.flags = (s_mo.want ? REG_ST_RUNREQ : 0) |
+             ((stepper && stepper->isRunning()) ? REG_ST_RUNNING : 0) |
+             (g_dir ? REG_ST_DIR : 0) |
+             (g_en ? REG_ST_EN : 0) |
+             (g_alarm ? REG_ST_ALARM : 0);
+  st.freq = g_userFreq;
+  st.acc = g_accel;
+  st.pos = stepper ? stepper->getCurrentPosition() : 0;
+  return st;
+}
+
+static void ModbusTask(void* arg) {
+  static uint8_t q[MB_ADU_MAX];
+  static uint8_t r[MB_ADU_MAX];
+
+  s_mbTask = xTaskGetCurrentTaskHandle();
+
+  g_regs.hold[REG_FREQ]     = (uint16_t)g_userFreq;
+  g_regs.hold[REG_FREQ + 1] = (uint16_t)(g_userFreq >> 16);
+  g_regs.hold[REG_ACC]      = (uint16_t)g_accel;
+  g_regs.hold[REG_ACC + 1]  = (uint16_t)(g_accel >> 16);
+  g_regs.hold[REG_DIR]      = g_dir;
+  g_regs.hold[REG_EN]       = g_en;
+
+  Serial2.setRxBufferSize(MB_ADU_MAX * 2);
+  Serial2.begin(MB_BAUD, SERIAL_8N1, PIN_MB_RX, PIN_MB_TX);
+  Serial2.setPins(PIN_MB_RX, PIN_MB_TX, -1, PIN_MB_DE);
+  Serial2.setMode(UART_MODE_RS485_HALF_DUPLEX);
+  Serial2.setRxTimeout(4);
+  Serial2.onReceive(mbOnRx, true);
+
+  while (true) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+    size_t n = 0;
+    while (Serial2.available() && n < sizeof(q)) q[n++] = (uint8_t)Serial2.read();
+    // кадр длиннее ADU — мусор, дочитываем и выбрасываем
+    if (Serial2.available()) {
+      while (Serial2.available()) Serial2.read();
+      g_mbErr++;
+      continue;
+    }
+
+    RegStatus st = regStatusNow();
+    size_t len = mbProcess(g_regs, st, MB_SLAVE, q, n, r, mbApply);
+    g_mbReq++;
+    if (len) Serial2.write(r, len);
+  }
+}
+
+// ===== UDP streams =====
+// Один UDP-порт на оба потока: PVT-точки ('P' 'V') и сжатые команды
+// шагов ('S' 'C'). На каждый пакет — ответ с уровнем буфера.
+static void pvtRx(const uint8_t* buf, int n, uint8_t* r) {
+  uint8_t flags = buf[3];
+  uint32_t seq = pvtGet32(&buf[4]);
+  uint8_t count = (uint8_t)((n - PVT_HDR) / PVT_PT);
+
+  // новый поток — только когда StepTask буфер не читает. Между START и
+  // разбором CMD_PVT поток уже принят: хост льёт предзаполнение подряд
+  bool accept = pvtActive() || s_pvtPending;
+  bool start = (flags & PVT_F_START) && !accept;
+  if (start) {
+    g_pvt.tail = g_pvt.head;
+    g_pvt.ended = false;
+    s_pvtPending = true;
+    accept = true;
+  }
+
+  if (accept && !g_pvt.ended) {
+    for (uint8_t i = 0; i < count; i++) {
+      const uint8_t* q = &buf[PVT_HDR + i * PVT_PT];
+      PvtPoint p = {pvtGet32(q), (int32_t)pvtGet32(q + 4), (int32_t)pvtGet32(q + 8)};
+      if (!pvtPush(g_pvt, p)) g_pvtDrops++;
+    }
+    if (flags & PVT_F_END) g_pvt.ended = true;
+    if (start) {
+      Cmd c{CMD_PVT, 0, 0};
+      if (xQueueSend(qCmd, &c, 0) != pdTRUE) s_pvtPending = false;
+    }
+  } else {
+    g_pvtDrops += count;
+  }
+
+  r[0] = 'P';
+  r[1] = 'S';
+  r[2] = g_pvtState;
+  r[3] = (uint8_t)(g_pvtDrops > 255 ? 255 : g_pvtDrops);
+  pvtPut32(&r[4], seq);
+  pvtPut16(&r[8], pvtLevel(g_pvt));
+  pvtPut16(&r[10], pvtFree(g_pvt));
+}
+
+static void scRx(const uint8_t* buf, int n, uint8_t* r) {
+  uint8_t flags = buf[3];
+  uint32_t seq = pvtGet32(&buf[4]);
+  uint16_t count = (uint16_t)((n - SC_HDR) / SC_CMD_BYTES);
+
+  // как в pvtRx: предзаполнение сразу за START принимается
+  bool accept = scActive() || s_scPending;
+  bool start = (flags & SC_F_START) && !accept;
+  if (start) {
+    g_sc.tail = g_sc.head;
+    g_sc.ended = false;
+    s_scPending = true;
+    accept = true;
+  }
+
+  if (accept && !g_sc.ended) {
+    for (uint16_t i = 0; i < count; i++) {
+      StepCmd c;
+      scDecode(&buf[SC_HDR + i * SC_CMD_BYTES], c);
+      if (!scValid(c) || !scPush(g_sc, c)) g_scDrops++;
+    }
+    if (flags & SC_F_END) g_sc.ended = true;
+    if (start) {
+      Cmd c{CMD_STEPCMD, 0, 0};
+      if (xQueueSend(qCmd, &c, 0) != pdTRUE) s_scPending = false;
+    }
+  } else {
+    g_scDrops += count;
+  }
+
+  r[0] = 'S';
+  r[1] = 'S';
+  r[2] = g_scState;
+  r[3] = (uint8_t)(g_scDrops > 255 ? 255 : g_scDrops);
+  pvtPut32(&r[4], seq);
+  pvtPut16(&r[8], scLevel(g_sc));
+  pvtPut16(&r[10], scFree(g_sc));
+}
+
+static void StreamTask(void* arg) {
+  static uint8_t buf[SC_HDR + SC_MAX_CMDS * SC_CMD_BYTES];
+  WiFiUDP udp;
+  udp.begin(PVT_PORT);
+
+  while (true) {
+    int n = udp.parsePacket();
+    if (n <= 0) {
+      vTaskDelay(pdMS_TO_TICKS(1));
+      continue;
+    }
+
+    n = udp.read(buf, sizeof(buf));
+    if (n < PVT_HDR) continue;
+
+    uint8_t r[PVT_REPLY];
+    if (buf[0] == 'P' && buf[1] == 'V' && buf[2] == PVT_VER) pvtRx(buf, n, r);
+    else if (buf[0] == 'S' && buf[1] == 'C' && buf[2] == SC_VER) scRx(buf, n, r);
+    else continue;
+
+    udp.beginPacket(udp.remoteIP(), udp.remotePort());
+    udp.write(r, sizeof(r));
+    udp.endPacket();
+  }
+}
+
+// ===== Log =====
+// LogTask забирает готовые записи из кольца и шлёт их датаграммами
+// на адрес последней подписки (любая датаграмма на LOG_PORT); разбор —
+// tools/log_decode.cpp. Пока подписчика нет, записи копятся в кольце,
+// так что подписавшийся после загрузки видит и её.
+static const uint32_t LOG_FLUSH_MS = 50;
+
+static volatile uint32_t g_logSent = 0;     // датаграмм
+static IPAddress s_logPeer;
+static uint16_t  s_logPeerPort = 0;
+
+static void LogTask(void* arg) {
+  static uint8_t pkt[1400];
+  size_t len = DLOG_PKT_HDR;
+  uint32_t seq = 0, t0 = 0;
+  WiFiUDP udp;
+  udp.begin(LOG_PORT);
+
+  while (true) {
+    if (udp.parsePacket() > 0) {
+      uint8_t b[8];
+      udp.read(b, sizeof(b));
+      s_logPeer = udp.remoteIP();
+      s_logPeerPort = udp.remotePort();
+    }
+
+    if (s_logPeerPort) {
+      uint32_t w[DLOG_RECW];
+      while (len + sizeof(w) <= sizeof(pkt)) {
+        uint32_t n = dlogGet(g_log, w);
+        if (!n) break;
+        if (len == DLOG_PKT_HDR) t0 = millis();    // отсчёт — с первой записи пакета
+        memcpy(pkt + len, w, n * 4);
+        len += n * 4;
+      }
+
+      if (len > DLOG_PKT_HDR && (len + sizeof(w) > sizeof(pkt) || millis() - t0 >= LOG_FLUSH_MS)) {
+        uint32_t drops = g_log.drops.load();
+        pkt[0] = 'D';
+        pkt[1] = 'L';
+        pkt[2] = DLOG_VER;
+        pkt[3] = 0;
+        memcpy(pkt + 4, &seq, 4);
+        memcpy(pkt + 8, &drops, 4);
+        udp.beginPacket(s_logPeer, s_logPeerPort);
+        udp.write(pkt, len);
+        udp.endPacket();
+        seq++;
+        g_logSent++;
+        len = DLOG_PKT_HDR;
+        continue;                                  // может, в кольце ещё есть
+      }
+    }
+    vTaskDelay(pdMS_TO_TICKS(10));
+  }
+}
+
+// ===== WiFi =====
+// Последние удачные канал, BSSID и аренда DHCP лежат в NVS. С ними
+// подключение идёт сразу на ассоциацию с известной точкой, без
+// сканирования всех каналов; если за WIFI_FAST_MS не вышло — обычное
+// подключение со сканированием, кэш обновится по его итогам.
+// Статический IP (WIFI_IP / WIFI_GW / WIFI_MASK) убирает ещё и DHCP;
+// WIFI_REUSE_LEASE=1 берёт последнюю аренду как статику (быстро, но
+// если аренду за это время отдали другому — будет конфликт адресов).
+// Переподключение после обрыва ведёт wifiPoll() из WebTask.
+#ifndef WIFI_FAST_MS
+#define WIFI_FAST_MS 3000
+#endif
+#ifndef WIFI_RETRY_MS
+#define WIFI_RETRY_MS 15000
+#endif
+#ifndef WIFI_REUSE_LEASE
+#define WIFI_REUSE_LEASE 0
+#endif
+
+struct WifiCache {
+  uint8_t  ch;
+  uint8_t  bssid[6];
+  uint32_t ip, gw, mask, dns;
+};
+
+enum WifiState : uint8_t { WIFI_DOWN, WIFI_FAST, WIFI_FULL, WIFI_UP };
+
+static WifiCache s_wifiCache  = {};
+static bool      s_wifiCached = false;
+static uint32_t  s_wifiT0     = 0;     // millis() начала подключения (с момента обрыва)
+static uint32_t  s_wifiTryMs  = 0;     // millis() начала текущей попытки
+
+static volatile uint8_t  g_wifiState  = WIFI_DOWN;
+static volatile bool     g_wifiGotIp  = false;
+static volatile bool     g_wifiLost   = false;
+static volatile uint32_t g_wifiConnMs = 0;     // длительность последнего подключения
+static volatile uint32_t g_wifiDrops  = 0;
+static volatile uint8_t  g_wifiFastOk = 0;     // последнее подключение — по кэшу
+
+static void wifiEvent(arduino_event_id_t ev) {
+  if (ev == ARDUINO_EVENT_WIFI_STA_GOT_IP) g_wifiGotIp = true;
+  else if (ev == ARDUINO_EVENT_WIFI_STA_DISCONNECTED) g_wifiLost = true;
+}
+
+static void wifiCacheLoad() {
+  Preferences nvs;
+  if (!nvs.begin("wifi", true)) return;
+  s_wifiCached = nvs.getBytes("cache", &s_wifiCache, sizeof(s_wifiCache)) == sizeof(s_wifiCache) &&
+                 s_wifiCache.ch >= 1 && s_wifiCache.ch <= 14;
+  nvs.end();
+}
+
+// Пишем только при изменении — обычно это раз на смену точки доступа.
+static void wifiCacheStore() {
+  WifiCache c = {};
+  c.ch = (uint8_t)WiFi.channel();
+  const uint8_t* b = WiFi.BSSID();
+  if (b) memcpy(c.bssid, b, sizeof(c.bssid));
+  c.ip   = (uint32_t)WiFi.localIP();
+  c.gw   = (uint32_t)WiFi.gatewayIP();
+  c.mask = (uint32_t)WiFi.subnetMask();
+  c.dns  = (uint32_t)WiFi.dnsIP();
+
+  if (s_wifiCached && !memcmp(&c, &s_wifiCache, sizeof(c))) return;
+  s_wifiCache = c;
+  s_wifiCached = true;
+
+  Preferences nvs;
+  if (!nvs.begin("wifi", false)) return;
+  nvs.putBytes("cache", &c, sizeof(c));
+  nvs.end();
+}
+
+static void wifiBegin(bool fast) {
+  g_wifiGotIp = false;
+  WiFi.disconnect();
+
+#if defined(WIFI_IP)
+  IPAddress ip, gw, mask;
+  ip.fromString(WIFI_IP);
+  gw.fromString(WIFI_GW);
+  mask.fromString(WIFI_MASK);
+  WiFi.config(ip, gw, mask, gw);
+#else
+  if (fast && WIFI_REUSE_LEASE && s_wifiCache.ip) {
+    WiFi.config(IPAddress(s_wifiCache.ip), IPAddress(s_wifiCache.gw),
+                IPAddress(s_wifiCache.mask), IPAddress(s_wifiCache.dns));
+  } else {
+    WiFi.config(INADDR_NONE, INADDR_NONE, INADDR_NONE);
+  }
+#endif
+
+  if (fast) WiFi.begin(WIFI_SSID_C, WIFI_PASS_C, s_wifiCache.ch, s_wifiCache.bssid);
+  else      WiFi.begin(WIFI_SSID_C, WIFI_PASS_C);
+
+  s_wifiTryMs = millis();
+  g_wifiState = fast ? WIFI_FAST : WIFI_FULL;
+}
+
+static void wifiPoll() {
+  uint32_t now = millis();
+
+  switch (g_wifiState) {
+    case WIFI_UP:
+      if (!g_wifiLost) return;
+      g_wifiDrops++;
+      LOGW("wifi lost, reconnecting");
+      s_wifiT0 = now;
+      wifiBegin(s_wifiCached);
+      return;
+
+    case WIFI_FAST:
+    case WIFI_FULL:
+      if (g_wifiGotIp) {
+        g_wifiConnMs = now - s_wifiT0;
+        g_wifiFastOk = (g_wifiState == WIFI_FAST);
+        g_wifiLost = false;
+        g_wifiState = WIFI_UP;
+        wifiCacheStore();
+        LOGI("wifi up in %lu ms (%s)", (unsigned long)g_wifiConnMs, g_wifiFastOk ? "fast" : "scan");
+        return;
+      }
+      // точка сменила канал или пропала — кэш не помог, сканируем
+      if (g_wifiState == WIFI_FAST && now - s_wifiTryMs >= WIFI_FAST_MS) wifiBegin(false);
+      else if (g_wifiState == WIFI_FULL && now - s_wifiTryMs >= WIFI_RETRY_MS) wifiBegin(s_wifiCached);
+      return;
+
+    default:
+      s_wifiT0 = now;
+      wifiBegin(s_wifiCached);
+      return;
+  }
+}
+
+static Tcon s_tcon;              // TCP-консоль, см. TconTask
+static StatusCache s_status;     // /api/status; пишет только WebTask
+static uint32_t g_lpParked = 0, g_lpWoken = 0, g_lpTimeouts = 0, g_lpBusy = 0;   // long-poll
+
+// ===== Console =====
+// Таблица команд общая для UART (ConsoleTask) и TCP (TconTask): ответ
+// пишется в переданный Print. Команда не ждёт дольше CON_SEND_MS, общие
+// заготовки — под s_stageLock.
+#ifndef CON_SEND_MS
+#define CON_SEND_MS 20
+#endif
+
+static void consoleHelp(Print& out) {
+  out.println("Commands:");
+  out.println("  start | stop");
+  out.println("  f <hz>");
+  out.println("  acc <hz_per_s>");
+  out.println("  dir <0|1>");
+  out.println("  en <0|1>");
+  out.println("  ramp <hz> <ms>");
+  out.println("  cam <m:s,m:s,...> | cam on | cam off");
+  out.println("  cam master enc | cam master virt <hz>");
+  out.println("  mpg on | mpg off | mpg x1|x10|x100");
+  out.println("  ain on | ain off | ain cfg <shift> <deadband> <hyst> <fmin> <fmax>");
+  out.println("  can rate <ms>");
+  out.println("  shape off | shape zv|zvd|ei <hz> <zeta_permille>");
+  out.println("  pvt prefill <points>");
+  out.println("  sc prefill <cmds>");
+  out.println("  arc <x> <y> <z> <i> <j> cw|ccw | arc stop | arc feed <hz> | arc tol <millisteps>");
+  out.println("  pf | pf test");
+  out.println("  vib | vib on | vib off");
+  out.println("  log");
+  out.println("  prof | prof on [hz] | prof off | prof clear | prof dump");
+  out.println("  tune | tune start [dist] | tune stop | tune tol <steps>");
+  out.println("  trig | trig arm | trig off");
+  out.println("  life | life save");
+  out.println("  rb");
+  out.println("  res | res scan <f0> <f1> <points> | res stop | res clear | res dump");
+  out.println("  status");
+  out.println("  mo");
+  out.println("  tcon");
+}
+
+static void consoleExec(char* p, Print& out) {
+  // очередь полна дольше CON_SEND_MS — ERR, сессия не встаёт
+  auto send = [](Cmd c) -> bool {
+    return xQueueSend(qCmd, &c, pdMS_TO_TICKS(CON_SEND_MS)) == pdTRUE;
+  };
+
+  while (*p == ' ' || *p == '\t') p++;
+  if (*p == 0) return;
+
+  if (!strcmp(p, "start")) { out.println(send({CMD_START,0,0}) ? "ok" : "ERR"); return; }
+  if (!strcmp(p, "stop"))  { out.println(send({CMD_STOP,0,0}) ? "ok" : "ERR"); return; }
+
+  if (!strcmp(p, "status")) {
+    out.printf("runReq=%d running=%d freq=%lu dir=%u en=%u alarm=%d acc=%lu\n",
+               (int)s_mo.want,
+               stepper ? (int)stepper->isRunning() : 0,
+               (unsigned long)g_userFreq,
+               (unsigned)g_dir,
+               (unsigned)g_en,
+               (int)g_alarm,
+               (unsigned long)g_accel);
+    out.printf("cam=%d master=%s mpos=%ld pts=%u\n",
+               (int)g_camOn,
+               g_camMaster == CAM_MST_VIRT ? "virt" : "enc",
+               (long)g_camMstPos,
+               (unsigned)g_cam[g_camIdx].n);
+    out.printf("mpg=%d scale=x%u\n", (int)g_mpgOn, (unsigned)g_mpgScale);
+    out.printf("pos=%ld restored=%u reset=%u\n",
+               stepper ? (long)stepper->getCurrentPosition() : 0L,
+               (unsigned)g_restored,
+               (unsigned)g_resetReason);
+    out.printf("pf=%d restored=%d saves=%lu save_us=%lu max_us=%lu boot_us=%lu\n",
+               (int)g_pfOk,
+               (int)g_pfRestored,
+               (unsigned long)g_pfSaves,
+               (unsigned long)g_pfSaveUs,
+               (unsigned long)g_pfSaveMaxUs,
+               (unsigned long)g_pfBootUs);
+    out.printf("ain=%d raw=%u sps=%lu ups=%lu shift=%u db=%u hyst=%u fmin=%lu fmax=%lu\n",
+               (int)g_ainOn,
+               (unsigned)g_ainRaw,
+               (unsigned long)g_ainSps,
+               (unsigned long)g_ainUps,
+               (unsigned)g_ainCfg.iirShift,
+               (unsigned)g_ainCfg.deadband,
+               (unsigned)g_ainCfg.hyst,
+               (unsigned long)g_ainCfg.fMin,
+               (unsigned long)g_ainCfg.fMax);
+    out.printf("can=%d node=%u rate=%lu rx=%lu tx=%lu\n",
+               (int)g_canOk,
+               (unsigned)CAN_NODE,
+               (unsigned long)g_canPeriodMs,
+               (unsigned long)g_canRx,
+               (unsigned long)g_canTx);
+    out.printf("modbus slave=%u baud=%lu req=%lu err=%lu\n",
+               (unsigned)MB_SLAVE,
+               (unsigned long)MB_BAUD,
+               (unsigned long)g_mbReq,
+               (unsigned long)g_mbErr);
+    out.printf("shape=%u hz=%u zeta=%u\n",
+               (unsigned)g_shapeType,
+               (unsigned)g_shapeHz,
+               (unsigned)g_shapeZeta);
+    out.printf("pvt=%u level=%u prefill=%u underflow=%lu drops=%lu\n",
+               (unsigned)g_pvtState,
+               (unsigned)pvtLevel(g_pvt),
+               (unsigned)g_pvtPrefill,
+               (unsigned long)g_pvtUnderflow,
+               (unsigned long)g_pvtDrops);
+    out.printf("sc=%u level=%u prefill=%u underflow=%lu drops=%lu rate=%lu\n",
+               (unsigned)g_scState,
+               (unsigned)scLevel(g_sc),
+               (unsigned)g_scPrefill,
+               (unsigned long)g_scUnderflow,
+               (unsigned long)g_scDrops,
+               (unsigned long)g_scRate);
+    out.printf("arc=%d axis=%u s=%ld len=%ld chords=%lu feed=%lu tol=%lu\n",
+               g_arcOn ? 1 : 0,
+               (unsigned)ARC_AXIS,
+               (long)g_arcS,
+               (long)s_arc.len,
+               (unsigned long)s_arc.n,
+               (unsigned long)g_arcFeed,
+               (unsigned long)g_arcTol);
+    out.printf("scan=%u pts=%u bands=%u\n",
+               (unsigned)g_scanState,
+               (unsigned)g_scanI,
+               (unsigned)g_resBands);
+    out.printf("tune=%u trial=%lu from=%lu old_us=%lu new_us=%lu\n",
+               (unsigned)g_tuneState,
+               (unsigned long)g_tuneAccel,
+               (unsigned long)g_tuneFrom,
+               (unsigned long)g_tuneOldUs,
+               (unsigned long)g_tuneNewUs);
+    out.printf("http status gen=%lu encodes=%lu sent=%lu not_modified=%lu\n",
+               (unsigned long)s_status.gen,
+               (unsigned long)s_status.encodes,
+               (unsigned long)s_status.hits,
+               (unsigned long)s_status.notModified);
+    out.printf("longpoll parked=%lu woken=%lu timeouts=%lu busy=%lu\n",
+               (unsigned long)g_lpParked,
+               (unsigned long)g_lpWoken,
+               (unsigned long)g_lpTimeouts,
+               (unsigned long)g_lpBusy);
+    out.printf("wifi=%u conn_ms=%lu fast=%u drops=%lu cached=%u ch=%u\n",
+               (unsigned)g_wifiState,
+               (unsigned long)g_wifiConnMs,
+               (unsigned)g_wifiFastOk,
+               (unsigned long)g_wifiDrops,
+               s_wifiCached ? 1u : 0u,
+               (unsigned)s_wifiCache.ch);
+    return;
+  }
+
+  if (!strcmp(p, "vib on"))  { g_vibOn = true;  out.println("ok"); return; }
+  if (!strcmp(p, "vib off")) { g_vibOn = false; out.println("ok"); return; }
+  if (!strcmp(p, "vib")) {
+    VibPeak pk[VIB_PEAKS];
+    uint32_t stepHz = 0;
+    uint8_t n = vibSnapshot(pk, stepHz);
+    out.printf("vib=%d fs=%lu fps=%lu drops=%lu us=%lu step_hz=%lu\n",
+               (int)g_vibOn,
+               (unsigned long)VIB_FS,
+               (unsigned long)g_vibFps,
+               (unsigned long)g_vibDrops,
+               (unsigned long)g_vibUs,
+               (unsigned long)stepHz);
+    for (uint8_t i = 0; i < n; i++) {
+      uint32_t r = vibRatio(pk[i].mhz, stepHz);
+      out.printf("  %lu.%03lu Hz amp=%u x_step=%lu.%03lu\n",
+                 (unsigned long)(pk[i].mhz / 1000), (unsigned long)(pk[i].mhz % 1000),
+                 (unsigned)pk[i].amp,
+                 (unsigned long)(r / 1000), (unsigned long)(r % 1000));
+    }
+    return;
+  }
+
+  if (!strcmp(p, "mo")) {
+    // копия: автомат пишет StepTask на другом ядре
+    Motion m = s_mo;
+    out.printf("mo state=%s want=%d dir=%u next=%u transitions=%lu ignored=%lu\n",
+               moStateName(m.state),
+               (int)m.want,
+               (unsigned)m.dir,
+               (unsigned)m.dirNext,
+               (unsigned long)m.transitions,
+               (unsigned long)m.ignored);
+    out.print("act_max_us");
+    for (int i = 0; i < MO_STATES; i++) out.printf(" %s=%u", moStateName(i), (unsigned)m.actMaxUs[i]);
+    out.println();
+    // от старых к новым; dt — сколько пробыли в предыдущем состоянии
+    uint32_t n = m.transitions < MO_TRACE ? m.transitions : MO_TRACE;
+    for (uint32_t i = m.transitions - n; i < m.transitions; i++) {
+      const MoTrace& t = m.trace[i % MO_TRACE];
+      uint32_t dt = i > m.transitions - n ? t.us - m.trace[(i - 1) % MO_TRACE].us : 0;
+      out.printf("  %10lu us %-8s %-8s -> %-8s act=%u us dt=%lu us\n",
+                 (unsigned long)t.us,
+                 moEventName(t.ev),
+                 moStateName(t.from),
+                 moStateName(t.to),
+                 (unsigned)t.actUs,
+                 (unsigned long)dt);
+    }
+    return;
+  }
+
+  if (!strcmp(p, "tcon")) {
+    out.printf("tcon port=%u sessions=%d/%d accepted=%lu rejected=%lu kicked=%lu dropped=%lu\n",
+               (unsigned)TCON_PORT,
+               tconCount(s_tcon),
+               TCON_MAX,
+               (unsigned long)s_tcon.accepted,
+               (unsigned long)s_tcon.rejected,
+               (unsigned long)s_tcon.kicked,
+               (unsigned long)s_tcon.lost);
+    return;
+  }
+
+  if (!strcmp(p, "log")) {
+    out.printf("log level=%u port=%u peer=%s records=%lu drops=%lu sent=%lu\n",
+               (unsigned)LOG_LEVEL,
+               (unsigned)LOG_PORT,
+               s_logPeerPort ? s_logPeer.toString().c_str() : "-",
+               (unsigned long)g_log.puts.load(),
+               (unsigned long)g_log.drops.load(),
+               (unsigned long)g_logSent);
+    return;
+  }
+
+  if (!strcmp(p, "prof")) {
+    out.printf("prof=%d hz=%lu samples=%lu/%lu isr_cycles=%lu/%lu\n",
+               (int)g_profOn,
+               (unsigned long)g_profHz,
+               (unsigned long)s_profHead[0],
+               (unsigned long)s_profHead[1],
+               (unsigned long)profIsrCycles(0),
+               (unsigned long)profIsrCycles(1));
+    return;
+  }
+  if (!strcmp(p, "prof on") || !strncmp(p, "prof on ", 8)) {
+    if (p[7]) g_profHz = clamp_u32(strtoul(p + 8, nullptr, 10), 10, 20000);
+    profSet(true);
+    out.println("ok");
+    return;
+  }
+  if (!strcmp(p, "prof off"))   { profSet(false); out.println("ok"); return; }
+  if (!strcmp(p, "prof clear")) { profClear();    out.println("ok"); return; }
+  if (!strcmp(p, "prof dump")) {
+    profDump([&out](const char* s) { out.print(s); });
+    return;
+  }
+
+  if (!strcmp(p, "tune")) {
+    uint32_t o = g_tuneOldUs, nw = g_tuneNewUs;
+    out.printf("tune=%u accel=%lu trial=%lu trials=%u err=%ld tol=%lu dist=%lu\n",
+               (unsigned)g_tuneState,
+               (unsigned long)g_accel,
+               (unsigned long)g_tuneAccel,
+               (unsigned)s_tune.trials,
+               (long)g_tuneMaxErr,
+               (unsigned long)g_tuneTol,
+               (unsigned long)g_tuneDist);
+    if (g_tuneState == TUNE_DONE) {
+      out.printf("accel %lu -> %lu, move %lu -> %lu us (%ld%% shorter)\n",
+                 (unsigned long)g_tuneFrom,
+                 (unsigned long)s_tune.result,
+                 (unsigned long)o,
+                 (unsigned long)nw,
+                 o ? (long)(((int64_t)o - nw) * 100 / o) : 0L);
+    }
+    return;
+  }
+  if (!strcmp(p, "tune stop")) { out.println(send({CMD_TUNE, 0, 0}) ? "ok" : "ERR"); return; }
+  if (!strcmp(p, "tune start") || !strncmp(p, "tune start ", 11)) {
+    out.println(send({CMD_TUNE, 1, (uint32_t)strtoul(p + 10, nullptr, 10)}) ? "ok" : "ERR");
+    return;
+  }
+  if (!strncmp(p, "tune tol ", 9)) {
+    g_tuneTol = clamp_u32(strtoul(p + 9, nullptr, 10), 1, 100000);
+    out.println("ok");
+    return;
+  }
+
+  if (!strcmp(p, "trig")) {
+    TrigStats s = g_trigStats;
+    out.printf("trig=%s pin=%u edges=%lu arm_us=%lu steps=%lu\n",
+               trigStateName(g_trigState),
+               (unsigned)PIN_TRIG,
+               (unsigned long)g_trigEdges,
+               (unsigned long)g_trigArmUs,
+               (unsigned long)s_trigRamp.steps);
+    out.printf("edge->step n=%lu last=%lu min=%lu max=%lu avg=%lu ns\n",
+               (unsigned long)s.n,
+               (unsigned long)s.lastNs,
+               (unsigned long)s.minNs,
+               (unsigned long)s.maxNs,
+               s.n ? (unsigned long)(s.sumNs / s.n) : 0UL);
+    return;
+  }
+  if (!strcmp(p, "trig arm")) { out.println(send({CMD_TRIG, 1, 0}) ? "ok" : "ERR"); return; }
+  if (!strcmp(p, "trig off")) { out.println(send({CMD_TRIG, 0, 0}) ? "ok" : "ERR"); return; }
 
-static void requestStop() {
-  g_runReq = false;
-  if (stepper) stepper->stopMove();
-}
+  if (!strcmp(p, "life")) {
+    LifeData d = g_life;
+    const LifeAxis& a = d.ax[0];
+    out.printf("steps=%llu run_s=%llu reversals=%lu peak_hz=%lu\n",
+               (unsigned long long)a.steps,
+               (unsigned long long)(a.runMs / 1000),
+               (unsigned long)a.reversals,
+               (unsigned long)a.peakHz);
+    out.printf("boots=%lu alarms=%lu saves=%lu dirty=%d age_s=%lu period_s=%lu save_us=%lu\n",
+               (unsigned long)d.boots,
+               (unsigned long)d.alarms,
+               (unsigned long)d.saves,
+               (int)s_lifeDirty,
+               (unsigned long)((millis() - s_lifeSavedMs) / 1000),
+               (unsigned long)s_lifePeriodS,
+               (unsigned long)g_lifeSaveUs);
+    return;
+  }
+  if (!strcmp(p, "life save")) {
+    // на ходу запись не делается (флеш останавливает кэш)
+    if (motionActive()) { out.println("ERR moving"); return; }
+    out.println(send({CMD_LIFE, 0, 0}) ? "ok" : "ERR");
+    return;
+  }
 
-static void requestDir(uint8_t newDir) {
-  newDir = newDir ? 1 : 0;
-  if (newDir == g_dir) return;
+  if (!strcmp(p, "rb")) {
+    xSemaphoreTake(s_rbLock, portMAX_DELAY);
+    RbResult r = rbSelfTest();
+    out.printf("rb: simd=%d cases=%lu words=%lu mismatches=%lu hash=%08lx\n",
+               (int)g_rbSimd,
+               (unsigned long)r.cases,
+               (unsigned long)r.words,
+               (unsigned long)r.mismatches,
+               (unsigned long)r.hash);
+    uint32_t sc = rbCycles(rbScaleC, 20);
+    uint32_t vc = rbCycles(rbScale, 20);
+    xSemaphoreGive(s_rbLock);
+    out.printf("scalar %lu cyc (%lu.%02lu/word), kernel %lu cyc (%lu.%02lu/word), speedup x%lu.%02lu\n",
+               (unsigned long)sc,
+               (unsigned long)(sc / RB_CHECK_N), (unsigned long)(sc * 100 / RB_CHECK_N % 100),
+               (unsigned long)vc,
+               (unsigned long)(vc / RB_CHECK_N), (unsigned long)(vc * 100 / RB_CHECK_N % 100),
+               (unsigned long)(sc / vc), (unsigned long)(sc * 100 / vc % 100));
+    return;
+  }
 
-  g_dirNext = newDir;
+  if (!strcmp(p, "res")) {
+    out.printf("scan=%u pts=%u/%u bands=%u\n",
+               (unsigned)g_scanState,
+               (unsigned)g_scanI,
+               (unsigned)(g_scanOn ? s_scan.n : g_scanI),
+               (unsigned)g_resBands);
+    for (uint8_t i = 0; i < g_resBands; i++) {
+      out.printf("  %lu..%lu Hz\n", (unsigned long)g_resBand[i].lo, (unsigned long)g_resBand[i].hi);
+    }
+    return;
+  }
+  if (!strcmp(p, "res dump")) {
+    // CSV для tools/res_check
+    for (uint16_t i = 0; i < g_scanI; i++) {
+      out.printf("%lu,%lu\n", (unsigned long)g_scanPts[i].hz, (unsigned long)g_scanPts[i].level);
+    }
+    return;
+  }
+  if (!strcmp(p, "res stop"))  { out.println(send({CMD_RES, RES_STOP, 0}) ? "ok" : "ERR"); return; }
+  if (!strcmp(p, "res clear")) { out.println(send({CMD_RES, RES_CLEAR, 0}) ? "ok" : "ERR"); return; }
+  if (!strncmp(p, "res scan ", 9)) {
+    char* e = p + 9;
+    uint32_t f0 = strtoul(e, &e, 10);
+    uint32_t f1 = strtoul(e, &e, 10);
+    uint32_t np = strtoul(e, &e, 10);
+    if (g_scanOn || np < 2 || np > RES_MAX_PTS || f0 < 1 || f1 <= f0 || f1 > FREQ_MAX) { out.println("ERR"); return; }
+    stageLock();
+    g_scanReq = {f0, f1, (uint16_t)np};
+    stageUnlock();
+    out.println(send({CMD_RES, RES_SCAN, 0}) ? "ok" : "ERR");
+    return;
+  }
 
-  if (stepper && stepper->isRunning()) {
-    g_dirPend = true;
-    stepper->stopMove();
-  } else {
-    g_dir = newDir;
-    applyDirPin();
-    if (g_runReq) requestStart();
+  if (!strcmp(p, "pf")) {
+    out.printf("ready=%d saves=%lu save_us=%lu max_us=%lu\n",
+               (int)g_pfOk,
+               (unsigned long)g_pfSaves,
+               (unsigned long)g_pfSaveUs,
+               (unsigned long)g_pfSaveMaxUs);
+    return;
+  }
+  if (!strcmp(p, "pf test")) {
+    // та же аварийная последовательность без пропадания питания — замер
+    // времени; результат — в логе и в `pf`, сессия не ждёт
+    if (!g_pfOk || !s_pfTask) { out.println("ERR"); return; }
+    s_pfTest = true;
+    xTaskNotifyGive(s_pfTask);
+    out.println("ok");
+    return;
   }
-}
 
-static void StepTask(void* arg) {
-  uint32_t lastPollMs = 0;
+  if (!strcmp(p, "arc stop")) { out.println(send({CMD_ARC, 0, 0}) ? "ok" : "ERR"); return; }
+  if (!strncmp(p, "arc feed ", 9)) {
+    g_arcFeed = clamp_u32(strtoul(p + 9, nullptr, 10), 1, FREQ_MAX);
+    out.println("ok");
+    return;
+  }
+  if (!strncmp(p, "arc tol ", 8)) {
+    g_arcTol = clamp_u32(strtoul(p + 8, nullptr, 10), 10, 100000);
+    out.println("ok");
+    return;
+  }
+  if (!strncmp(p, "arc ", 4)) {
+    Arc a;
+    if (g_arcOn || !arcParse(a, p + 4, g_arcTol / 1000.0f)) { out.println("ERR"); return; }
+    stageLock();
+    g_arcNext = a;
+    stageUnlock();
+    out.println(send({CMD_ARC, 1, 0}) ? "ok" : "ERR");
+    return;
+  }
 
-  while (true) {
-    Cmd cmd;
-    while (xQueueReceive(qCmd, &cmd, 0) == pdTRUE) {
-      switch (cmd.type) {
-        case CMD_START:
-          requestStart();
-          break;
+  if (!strncmp(p, "sc prefill ", 11)) {
+    g_scPrefill = (uint16_t)clamp_u32(strtoul(p + 11, nullptr, 10), 1, SC_BUF - 1);
+    out.println("ok");
+    return;
+  }
 
-        case CMD_STOP:
-          requestStop();
-          break;
+  if (!strncmp(p, "pvt prefill ", 12)) {
+    g_pvtPrefill = (uint16_t)clamp_u32(strtoul(p + 12, nullptr, 10), 1, PVT_BUF - 1);
+    out.println("ok");
+    return;
+  }
 
-        case CMD_FREQ:
-          g_userFreq = clamp_u32(cmd.a, 1, FREQ_MAX);
-          applyParamsToStepper();
-          if (stepper && stepper->isRunning()) applyRunDirectionToUpdateSpeed();
-          break;
+  if (!strcmp(p, "shape off")) { out.println(send({CMD_SHAPE, SHAPE_NONE, 0}) ? "ok" : "ERR"); return; }
+  if (!strncmp(p, "shape ", 6)) {
+    char* e = p + 6;
+    uint8_t type = !strncmp(e, "zvd ", 4) ? SHAPE_ZVD :
+                   !strncmp(e, "zv ", 3)  ? SHAPE_ZV  :
+                   !strncmp(e, "ei ", 3)  ? SHAPE_EI  : SHAPE_NONE;
+    if (type == SHAPE_NONE) { out.println("ERR"); return; }
+    while (*e && *e != ' ') e++;
+    uint32_t hz = clamp_u32(strtoul(e, &e, 10), 1, 1000);
+    uint32_t zeta = clamp_u32(strtoul(e, &e, 10), 0, 999);
+    out.println(send({CMD_SHAPE, type | (hz << 16), zeta}) ? "ok" : "ERR");
+    return;
+  }
 
-        case CMD_ACCEL:
-          g_accel = clamp_u32(cmd.a, 1, 2000000);
-          applyParamsToStepper();
-          if (stepper && stepper->isRunning()) applyRunDirectionToUpdateSpeed();
-          break;
+  if (!strncmp(p, "can rate ", 9)) {
+    g_canPeriodMs = clamp_u32(strtoul(p + 9, nullptr, 10), 0, 60000);
+    out.println("ok");
+    return;
+  }
 
-        case CMD_DIR:
-          requestDir(cmd.a ? 1 : 0);
-          break;
+  if (!strcmp(p, "ain on"))  { g_ainRst = true; g_ainOn = true; out.println("ok"); return; }
+  if (!strcmp(p, "ain off")) { g_ainOn = false; out.println("ok"); return; }
+  if (!strncmp(p, "ain cfg ", 8)) {
+    char* e = p + 8;
+    uint32_t sh = strtoul(e, &e, 10);
+    uint32_t db = strtoul(e, &e, 10);
+    uint32_t hy = strtoul(e, &e, 10);
+    uint32_t lo = strtoul(e, &e, 10);
+    uint32_t hi = strtoul(e, &e, 10);
+    g_ainCfg.iirShift = (uint8_t)clamp_u32(sh, 0, 12);
+    g_ainCfg.deadband = (uint16_t)clamp_u32(db, 0, AIN_FULL / 4);
+    g_ainCfg.hyst     = (uint16_t)clamp_u32(hy, 0, AIN_FULL / 4);
+    g_ainCfg.fMin     = clamp_u32(lo, 1, FREQ_MAX);
+    g_ainCfg.fMax     = clamp_u32(hi, 1, FREQ_MAX);
+    g_ainRst = true;
+    out.println("ok");
+    return;
+  }
 
-        case CMD_EN:
-          g_en = cmd.a ? 1 : 0;
-          applyEnablePin();
-          if (!g_en) requestStop();
-          else if (g_runReq && !g_alarm) requestStart();
-          break;
+  if (!strcmp(p, "mpg on"))  { out.println(send({CMD_MPG, MPG_ON, 0}) ? "ok" : "ERR"); return; }
+  if (!strcmp(p, "mpg off")) { out.println(send({CMD_MPG, MPG_OFF, 0}) ? "ok" : "ERR"); return; }
+  if (!strncmp(p, "mpg x", 5)) {
+    out.println(send({CMD_MPG, MPG_SCALE, (uint32_t)strtoul(p + 5, nullptr, 10)}) ? "ok" : "ERR");
+    return;
+  }
 
-        case CMD_RAMP: {
-          uint32_t target = clamp_u32(cmd.a, 1, FREQ_MAX);
-          uint32_t ms = clamp_u32(cmd.b, 50, 60000);
+  if (!strcmp(p, "cam on"))  { out.println(send({CMD_CAM, CAM_ON, 0}) ? "ok" : "ERR"); return; }
+  if (!strcmp(p, "cam off")) { out.println(send({CMD_CAM, CAM_OFF, 0}) ? "ok" : "ERR"); return; }
 
-          uint32_t cur = g_userFreq;
-          uint32_t diff = (target > cur) ? (target - cur) : (cur - target);
-          uint32_t acc = (diff == 0) ? g_accel : (uint32_t)((uint64_t)diff * 1000ULL / ms);
+  if (!strcmp(p, "cam master enc")) { out.println(send({CMD_CAM_MASTER, CAM_MST_ENC, 0}) ? "ok" : "ERR"); return; }
+  if (!strncmp(p, "cam master virt ", 16)) {
+    out.println(send({CMD_CAM_MASTER, CAM_MST_VIRT, (uint32_t)strtol(p + 16, nullptr, 10)}) ? "ok" : "ERR");
+    return;
+  }
 
-          g_userFreq = target;
-          g_accel = clamp_u32(acc, 1, 2000000);
+  if (!strncmp(p, "cam ", 4)) {
+    CamTable t;
+    if (!camParse(t, p + 4)) { out.println("ERR"); return; }
+    stageLock();
+    g_camNext = t;
+    stageUnlock();
+    out.println(send({CMD_CAM, CAM_LOAD, 0}) ? "ok" : "ERR");
+    return;
+  }
 
-          applyParamsToStepper();
-          if (stepper && stepper->isRunning()) applyRunDirectionToUpdateSpeed();
-          if (g_en && !g_alarm) requestStart();
-          break;
-        }
+  if (p[0] == 'f' && (p[1] == ' ' || p[1] == '\t')) {
+    out.println(send({CMD_FREQ, (uint32_t)strtoul(p + 2, nullptr, 10), 0}) ? "ok" : "ERR");
+    return;
+  }
 
-        case CMD_STATUS:
-          break;
-      }
-    }
+  if (!strncmp(p, "acc ", 4)) {
+    out.println(send({CMD_ACCEL, (uint32_t)strtoul(p + 4, nullptr, 10), 0}) ? "ok" : "ERR");
+    return;
+  }
 
-    uint32_t now = millis();
-    if ((uint32_t)(now - lastPollMs) >= 10) {
-      lastPollMs = now;
-      bool al = readAlarm();
-      if (al != g_alarm) {
-        g_alarm = al;
-        if (g_alarm) requestStop();
-        else if (g_runReq && g_en) requestStart();
-      }
-    }
+  if (!strncmp(p, "dir ", 4)) {
+    out.println(send({CMD_DIR, (uint32_t)strtoul(p + 4, nullptr, 10), 0}) ? "ok" : "ERR");
+    return;
+  }
 
-    if (g_dirPend && stepper && !stepper->isRunning()) {
-      g_dirPend = false;
-      g_dir = g_dirNext;
-      applyDirPin();
-      if (g_runReq && g_en && !g_alarm) requestStart();
-    }
+  if (!strncmp(p, "en ", 3)) {
+    out.println(send({CMD_EN, (uint32_t)strtoul(p + 3, nullptr, 10), 0}) ? "ok" : "ERR");
+    return;
+  }
 
-    vTaskDelay(pdMS_TO_TICKS(1));
+  if (!strncmp(p, "ramp ", 5)) {
+    char* a = p + 5;
+    char* b = a;
+    while (*b && *b != ' ' && *b != '\t') b++;
+    if (*b) *b++ = 0;
+    while (*b == ' ' || *b == '\t') b++;
+
+    out.println(send({CMD_RAMP,
+          (uint32_t)strtoul(a, nullptr, 10),
+          (uint32_t)strtoul(b, nullptr, 10)}) ? "ok" : "ERR");
+    return;
   }
+
+  out.println("ERR");
 }
 
 static void ConsoleTask(void* arg) {
@@ -195,23 +3226,12 @@ static void ConsoleTask(void* arg) {
   }
   Serial.println();
 
-  Serial.println("Commands:");
-  Serial.println("  start | stop");
-  Serial.println("  f <hz>");
-  Serial.println("  acc <hz_per_s>");
-  Serial.println("  dir <0|1>");
-  Serial.println("  en <0|1>");
-  Serial.println("  ramp <hz> <ms>");
-  Serial.println("  status");
+  consoleHelp(Serial);
   Serial.println();
 
   char line[96];
   size_t n = 0;
 
-  auto send = [](Cmd c) {
-    xQueueSend(qCmd, &c, portMAX_DELAY);
-  };
-
   while (true) {
     while (Serial.available()) {
       char ch = (char)Serial.read();
@@ -222,64 +3242,7 @@ static void ConsoleTask(void* arg) {
         line[n] = 0;
         n = 0;
 
-        char* p = line;
-        while (*p == ' ' || *p == '\t') p++;
-        if (*p == 0) continue;
-
-        if (!strcmp(p, "start")) { send({CMD_START,0,0}); Serial.println("ok"); continue; }
-        if (!strcmp(p, "stop"))  { send({CMD_STOP,0,0});  Serial.println("ok"); continue; }
-
-        if (!strcmp(p, "status")) {
-          Serial.printf("runReq=%d running=%d freq=%lu dir=%u en=%u alarm=%d acc=%lu\n",
-                        (int)g_runReq,
-                        stepper ? (int)stepper->isRunning() : 0,
-                        (unsigned long)g_userFreq,
-                        (unsigned)g_dir,
-                        (unsigned)g_en,
-                        (int)g_alarm,
-                        (unsigned long)g_accel);
-          continue;
-        }
-
-        if (p[0] == 'f' && (p[1] == ' ' || p[1] == '\t')) {
-          send({CMD_FREQ, (uint32_t)strtoul(p + 2, nullptr, 10), 0});
-          Serial.println("ok");
-          continue;
-        }
-
-        if (!strncmp(p, "acc ", 4)) {
-          send({CMD_ACCEL, (uint32_t)strtoul(p + 4, nullptr, 10), 0});
-          Serial.println("ok");
-          continue;
-        }
-
-        if (!strncmp(p, "dir ", 4)) {
-          send({CMD_DIR, (uint32_t)strtoul(p + 4, nullptr, 10), 0});
-          Serial.println("ok");
-          continue;
-        }
-
-        if (!strncmp(p, "en ", 3)) {
-          send({CMD_EN, (uint32_t)strtoul(p + 3, nullptr, 10), 0});
-          Serial.println("ok");
-          continue;
-        }
-
-        if (!strncmp(p, "ramp ", 5)) {
-          char* a = p + 5;
-          char* b = a;
-          while (*b && *b != ' ' && *b != '\t') b++;
-          if (*b) *b++ = 0;
-          while (*b == ' ' || *b == '\t') b++;
-
-          send({CMD_RAMP,
-                (uint32_t)strtoul(a, nullptr, 10),
-                (uint32_t)strtoul(b, nullptr, 10)});
-          Serial.println("ok");
-          continue;
-        }
-
-        Serial.println("ERR");
+        consoleExec(line, Serial);
       } else {
         if (n < sizeof(line) - 1) line[n++] = ch;
       }
@@ -288,30 +3251,312 @@ static void ConsoleTask(void* arg) {
   }
 }
 
+// ===== TCP console =====
+// Те же команды по TCP (telnet/nc, порт TCON_PORT), до TCON_MAX сессий;
+// буферы и ограничение вывода по сессиям — tcpcon.h.
+struct TconPrint : Print {
+  TconSession& s;
+  explicit TconPrint(TconSession& ss) : s(ss) {}
+  size_t write(uint8_t c) override {
+    tconPut(s, (const char*)&c, 1);
+    return 1;
+  }
+  size_t write(const uint8_t* b, size_t n) override {
+    tconPut(s, (const char*)b, n);
+    return n;
+  }
+};
+
+static void TconTask(void* arg) {
+  if (!tconBegin(s_tcon, TCON_PORT)) {
+    LOGE("tcp console: listen on %u failed", (unsigned)TCON_PORT);
+    vTaskDelete(nullptr);
+  }
+
+  while (true) {
+    tconPoll(s_tcon, millis(), [](TconSession& s, char* line) {
+      TconPrint out(s);
+      if (!line) {
+        out.println("STEP test (FastAccelStepper + WiFi Web)");
+        consoleHelp(out);
+        return;
+      }
+      consoleExec(line, out);
+    });
+    vTaskDelay(pdMS_TO_TICKS(10));
+  }
+}
+
 // ===== Web =====
-static WebServer server(80);
+// WebServer, умеющий отдать текущее соединение. Если обработчик вышел
+// без ответа при живом сокете, сервер ждёт закрытия (HC_WAIT_CLOSE) до
+// HTTP_MAX_CLOSE_WAIT и никого больше не принимает, а потом сам рвёт
+// сокет. После detach() у сервера соединения нет — он сразу берёт
+// следующего клиента; сокет живёт только в отданной копии.
+class DetachServer : public WebServer {
+ public:
+  using WebServer::WebServer;
+  WiFiClient detach() {
+    WiFiClient c = _currentClient;
+    _currentClient = WiFiClient();
+    return c;
+  }
+};
+
+static DetachServer server(80);
+
+// Сколько ждать, пока StepTask применит команду, чтобы ответить
+// результатом, а не "в очереди".
+#ifndef CMD_WAIT_MS
+#define CMD_WAIT_MS 20
+#endif
+
+// X-Cmd-* — одни на ответ, по последней команде запроса: qSend только
+// запоминает, webSend выставляет перед ответом.
+static CmdRec s_cmdHdr;
+static bool   s_cmdHdrDup = false;
+static bool   s_cmdHdrSet = false;
+
+static void cmdHeaders(const CmdRec& r, bool dup) {
+  s_cmdHdr = r;
+  s_cmdHdrDup = dup;
+  s_cmdHdrSet = true;
+}
+
+static void webSend(int code, const char* type, const char* body) {
+  if (s_cmdHdrSet) {
+    char v[12];
+    snprintf(v, sizeof(v), "%lu", (unsigned long)s_cmdHdr.seq);
+    server.sendHeader("X-Cmd-Seq", v);
+    server.sendHeader("X-Cmd-Status", cmdStName(s_cmdHdr.st));
+    if (s_cmdHdrDup) server.sendHeader("X-Cmd-Dup", "1");
+    s_cmdHdrSet = false;
+  }
+  server.send(code, type, body);
+}
 
+// Команда из HTTP. С ?rid=<id> — идемпотентно: повтор той же команды с
+// тем же id, пока она в журнале, не выполняется второй раз, а отвечает
+// результатом первой попытки (потерянная ставится заново, cmdlogClaim).
+// Номер и статус — в заголовках X-Cmd-Seq / X-Cmd-Status.
 static bool qSend(CmdType t, uint32_t a=0, uint32_t b=0) {
   if (!qCmd) return false;
-  Cmd c{t,a,b};
-  return xQueueSend(qCmd, &c, 0) == pdTRUE;
+  uint32_t rid = server.hasArg("rid") ? cmdRid(server.arg("rid").c_str()) : 0;
+
+  portENTER_CRITICAL(&s_cmdMux);
+  CmdRec r;
+  bool dup = cmdlogClaim(s_cmdLog, rid, t, a, r);
+  portEXIT_CRITICAL(&s_cmdMux);
+
+  if (dup) {
+    cmdHeaders(r, true);
+    return r.st != CMD_ST_REFUSED;
+  }
+
+  Cmd c{t, a, b, r.seq};
+  bool ok = xQueueSend(qCmd, &c, 0) == pdTRUE;
+  uint32_t t0 = millis();
+  while (true) {
+    portENTER_CRITICAL(&s_cmdMux);
+    CmdRec* cur = cmdlogBySeq(s_cmdLog, r.seq);
+    if (cur && !ok) cur->st = CMD_ST_LOST;
+    if (cur) r.st = cur->st;
+    portEXIT_CRITICAL(&s_cmdMux);
+    if (r.st != CMD_ST_QUEUED || millis() - t0 >= CMD_WAIT_MS) break;
+    vTaskDelay(1);
+  }
+  cmdHeaders(r, false);
+  return ok && r.st != CMD_ST_REFUSED;
+}
+
+// /api/cmd?seq=N или ?rid=<id> — результат команды, пока она в журнале;
+// без аргументов — последний номер.
+static void handleCmd() {
+  CmdRec r = {0, 0, 0, 0, CMD_ST_NONE};
+  bool found = false;
+  portENTER_CRITICAL(&s_cmdMux);
+  CmdRec* p = server.hasArg("seq") ? cmdlogBySeq(s_cmdLog, strtoul(server.arg("seq").c_str(), nullptr, 10)) :
+              server.hasArg("rid") ? cmdlogByRid(s_cmdLog, cmdRid(server.arg("rid").c_str())) : nullptr;
+  if (p) {
+    r = *p;
+    found = true;
+  }
+  uint32_t last = s_cmdLog.seq, dups = s_cmdLog.dups;
+  portEXIT_CRITICAL(&s_cmdMux);
+
+  char json[128];
+  if (!server.hasArg("seq") && !server.hasArg("rid")) {
+    snprintf(json, sizeof(json), "{\"last\":%lu,\"window\":%u,\"dups\":%lu}",
+             (unsigned long)last, (unsigned)CMDLOG_N, (unsigned long)dups);
+  } else if (!found) {
+    server.send(404, "application/json", "{\"status\":\"unknown\"}");
+    return;
+  } else {
+    snprintf(json, sizeof(json), "{\"seq\":%lu,\"type\":%u,\"status\":\"%s\"}",
+             (unsigned long)r.seq, (unsigned)r.type, cmdStName(r.st));
+  }
+  server.send(200, "application/json", json);
+}
+
+// Все поля /api/status; вызывается из statusRefresh не чаще STATUS_MIN_MS.
+static void statusTake(StatusSnap& s) {
+  s.runReq       = s_mo.want;
+  s.mo           = s_mo.state;
+  s.trig         = g_trigState;
+  s.trigNs       = g_trigStats.lastNs;
+  s.lifeSteps    = g_life.ax[0].steps;
+  s.lifeRunS     = (uint32_t)(g_life.ax[0].runMs / 1000);
+  s.lifeRev      = g_life.ax[0].reversals;
+  s.lifePeakHz   = g_life.ax[0].peakHz;
+  s.lifeAlarms   = g_life.alarms;
+  s.running      = stepper ? stepper->isRunning() : false;
+  s.freq         = g_userFreq;
+  s.acc          = g_accel;
+  s.dir          = g_dir;
+  s.en           = g_en;
+  s.alarm        = g_alarm;
+  s.cam          = g_camOn;
+  s.camMaster    = g_camMaster;
+  s.camPos       = g_camMstPos;
+  s.mpg          = g_mpgOn;
+  s.mpgScale     = g_mpgScale;
+  s.ain          = g_ainOn;
+  s.ainRaw       = g_ainRaw;
+  s.ainSps       = g_ainSps;
+  s.ainUps       = g_ainUps;
+  s.shape        = g_shapeType;
+  s.shapeHz      = g_shapeHz;
+  s.shapeZeta    = g_shapeZeta;
+  s.pvt          = g_pvtState;
+  s.pvtLevel     = pvtLevel(g_pvt);
+  s.pvtUnderflow = g_pvtUnderflow;
+  s.sc           = g_scState;
+  s.scLevel      = scLevel(g_sc);
+  s.scUnderflow  = g_scUnderflow;
+  s.scRate       = g_scRate;
+  s.arc          = g_arcOn ? 1 : 0;
+  s.arcS         = g_arcS;
+  s.arcLen       = s_arc.len;
+  s.scan         = g_scanState;
+  s.scanPts      = g_scanI;
+  s.resBands     = g_resBands;
+  s.tune         = g_tuneState;
+  s.tuneAccel    = g_tuneAccel;
+  s.tuneOldUs    = g_tuneOldUs;
+  s.tuneNewUs    = g_tuneNewUs;
+  s.wifiMs       = g_wifiConnMs;
+  s.wifiFast     = g_wifiFastOk;
+  s.wifiDrops    = g_wifiDrops;
+  s.pos          = stepper ? stepper->getCurrentPosition() : 0;
+  s.restored     = g_restored;
+  s.reset        = g_resetReason;
+  s.pf           = g_pfOk;
+  s.pfRestored   = g_pfRestored;
+  s.pfSaveUs     = g_pfSaveUs;
+  s.pfSaveMaxUs  = g_pfSaveMaxUs;
+}
+
+// ===== Long-poll =====
+// /api/status?since=<gen>&timeout=<ms>: если поколение уже не since —
+// ответ сразу, иначе запрос паркуется. WebServer синхронный, поэтому
+// соединение забирается у сервера (server.detach()) и обработчик выходит
+// без ответа — сервер тут же обслуживает других; lpPoll() из WebTask
+// отвечает сам, когда поколение сдвинулось (200 с телом) или вышел
+// таймаут (304). Проверка на плате — tools/lp_check.cpp.
+#ifndef LP_MAX
+#define LP_MAX 4
+#endif
+#ifndef LP_MAX_MS
+#define LP_MAX_MS 30000
+#endif
+
+struct LongPoll {
+  WiFiClient c;
+  uint32_t since;
+  uint32_t t0;
+  uint32_t ms;
+  bool used;
+};
+
+static LongPoll s_lp[LP_MAX];
+
+static void lpReply(WiFiClient& c, bool changed) {
+  char h[192];
+  int n = snprintf(h, sizeof(h),
+                   "HTTP/1.1 %s\r\nContent-Type: application/json\r\nContent-Length: %u\r\n"
+                   "ETag: %s\r\nCache-Control: no-cache\r\nConnection: close\r\n\r\n",
+                   changed ? "200 OK" : "304 Not Modified",
+                   changed ? (unsigned)s_status.len : 0u,
+                   s_status.etag);
+  c.write((const uint8_t*)h, n);
+  if (changed) c.write((const uint8_t*)s_status.json, s_status.len);
+  c.stop();
+}
+
+// true — запрос припаркован, отвечать не надо.
+static bool lpPark(uint32_t since, uint32_t ms) {
+  for (LongPoll& p : s_lp) {
+    if (p.used) continue;
+    p.c = server.detach();
+    p.since = since;
+    p.t0 = millis();
+    p.ms = ms;
+    p.used = true;
+    g_lpParked++;
+    return true;
+  }
+  g_lpBusy++;
+  return false;
+}
+
+static void lpPoll() {
+  bool any = false;
+  for (LongPoll& p : s_lp) any |= p.used;
+  if (!any) return;
+
+  uint32_t now = millis();
+  statusRefresh(s_status, now, statusTake);
+  for (LongPoll& p : s_lp) {
+    if (!p.used) continue;
+    bool changed = (s_status.gen != p.since);
+    if (!p.c.connected()) {
+      p.c.stop();
+    } else if (changed || now - p.t0 >= p.ms) {
+      if (changed) g_lpWoken++;
+      else g_lpTimeouts++;
+      lpReply(p.c, changed);
+    } else {
+      continue;
+    }
+    p.c = WiFiClient();
+    p.used = false;
+  }
 }
 
 static void handleStatus() {
-  bool running = stepper ? stepper->isRunning() : false;
+  statusRefresh(s_status, millis(), statusTake);
 
-  char json[256];
-  snprintf(json, sizeof(json),
-           "{\"runReq\":%d,\"running\":%d,\"freq\":%lu,\"acc\":%lu,\"dir\":%u,\"en\":%u,\"alarm\":%d}",
-           (int)g_runReq,
-           (int)running,
-           (unsigned long)g_userFreq,
-           (unsigned long)g_accel,
-           (unsigned)g_dir,
-           (unsigned)g_en,
-           (int)g_alarm);
+  if (server.hasArg("since")) {
+    uint32_t since = strtoul(server.arg("since").c_str(), nullptr, 10);
+    uint32_t ms = clamp_u32(strtoul(server.arg("timeout").c_str(), nullptr, 10), 0, LP_MAX_MS);
+    if (since == s_status.gen && ms) {
+      if (lpPark(since, ms)) return;
+      // мест нет — пусть клиент повторит позже, а не крутится вхолостую
+      server.sendHeader("Retry-After", "1");
+      server.send(503, "text/plain", "busy");
+      return;
+    }
+  }
 
-  server.send(200, "application/json", json);
+  server.sendHeader("ETag", s_status.etag);
+  server.sendHeader("Cache-Control", "no-cache");
+  if (server.header("If-None-Match") == s_status.etag) {
+    s_status.notModified++;
+    server.send(304);
+    return;
+  }
+  s_status.hits++;
+  server.send_P(200, "application/json", s_status.json, s_status.len);
 }
 
 static const char INDEX_HTML[] PROGMEM = R"HTML(
@@ -378,6 +3623,7 @@ static const char INDEX_HTML[] PROGMEM = R"HTML(
   <div class="card">
     <div style="margin-bottom:8px"><b>Статусы</b></div>
     <div class="grid">
+      <div><span class="k">state</span> <span class="v" id="s_state">—</span></div>
       <div><span class="k">runReq</span> <span class="v" id="s_runReq">—</span></div>
       <div><span class="k">running</span> <span class="v" id="s_running">—</span></div>
       <div><span class="k">freq</span> <span class="v" id="s_freq">—</span></div>
@@ -406,6 +3652,7 @@ let last = null;
 let initialized = false;
 
 function updateStatus(j){
+  $('s_state').textContent   = j.state;
   $('s_runReq').textContent  = j.runReq;
   $('s_running').textContent = j.running;
   $('s_freq').textContent    = j.freq;
@@ -422,40 +3669,69 @@ function setInputIfChanged(id, val){
   if (cur !== next) el.value = next;
 }
 
-async function refresh(forceInputs){
-  try{
-    const r = await fetch('/api/status');
-    const j = await r.json();
+function show(j, forceInputs){
+  updateStatus(j);
 
-    updateStatus(j);
+  const changed =
+    !last ||
+    last.freq !== j.freq ||
+    last.acc  !== j.acc  ||
+    last.dir  !== j.dir  ||
+    last.en   !== j.en;
 
-    const changed =
-      !last ||
-      last.freq !== j.freq ||
-      last.acc  !== j.acc  ||
-      last.dir  !== j.dir  ||
-      last.en   !== j.en;
+  const shouldUpdateInputs =
+    (!initialized) || (forceInputs === true) || (changed && !isEditing());
 
-    const shouldUpdateInputs =
-      (!initialized) || (forceInputs === true) || (changed && !isEditing());
+  if (shouldUpdateInputs){
+    setInputIfChanged('freq', j.freq);
+    setInputIfChanged('acc',  j.acc);
+    setInputIfChanged('dir',  j.dir);
+    setInputIfChanged('en',   j.en);
+    initialized = true;
+  }
 
-    if (shouldUpdateInputs){
-      setInputIfChanged('freq', j.freq);
-      setInputIfChanged('acc',  j.acc);
-      setInputIfChanged('dir',  j.dir);
-      setInputIfChanged('en',   j.en);
-      initialized = true;
-    }
+  last = j;
+}
 
-    last = j;
+function showErr(){
+  $('s_state').textContent='ERR';
+  $('s_runReq').textContent='ERR';
+  $('s_running').textContent='ERR';
+  $('s_freq').textContent='ERR';
+  $('s_acc').textContent='ERR';
+  $('s_dir').textContent='ERR';
+  $('s_en').textContent='ERR';
+  $('s_alarm').textContent='ERR';
+}
+
+async function refresh(forceInputs){
+  try{
+    const r = await fetch('/api/status');
+    show(await r.json(), forceInputs);
   }catch(e){
-    $('s_runReq').textContent='ERR';
-    $('s_running').textContent='ERR';
-    $('s_freq').textContent='ERR';
-    $('s_acc').textContent='ERR';
-    $('s_dir').textContent='ERR';
-    $('s_en').textContent='ERR';
-    $('s_alarm').textContent='ERR';
+    showErr();
+  }
+}
+
+// long-poll: ответ приходит, только когда состояние изменилось (или через 20 с — 304)
+const sleep = ms => new Promise(f => setTimeout(f, ms));
+async function watch(){
+  let gen = 0;
+  while(true){
+    try{
+      const r = await fetch('/api/status?since='+gen+'&timeout=20000');
+      if (r.status === 200){
+        const j = await r.json();
+        gen = j.gen;
+        show(j, false);
+        await sleep(200);            // едущий станок меняется постоянно — не чаще 5 раз в секунду
+      } else if (r.status !== 304){
+        await sleep(1000);
+      }
+    }catch(e){
+      showErr();
+      await sleep(1000);
+    }
   }
 }
 
@@ -481,8 +3757,8 @@ function ramp(){
   return api('/api/ramp?hz='+encodeURIComponent(hz)+'&ms='+encodeURIComponent(ms));
 }
 
-setInterval(()=>refresh(false), 500);
 refresh(true);
+watch();
 </script>
 </body>
 </html>
@@ -492,40 +3768,337 @@ static void handleRoot() {
   server.send(200, "text/html; charset=utf-8", FPSTR(INDEX_HTML));
 }
 
-static void handleStart() { server.send(200, "text/plain", qSend(CMD_START) ? "ok" : "err"); }
-static void handleStop()  { server.send(200, "text/plain", qSend(CMD_STOP)  ? "ok" : "err"); }
+static void handleStart() { webSend(200, "text/plain", qSend(CMD_START) ? "ok" : "err"); }
+static void handleStop()  { webSend(200, "text/plain", qSend(CMD_STOP)  ? "ok" : "err"); }
 
 static void handleSetF() {
   uint32_t hz = server.hasArg("hz") ? (uint32_t)strtoul(server.arg("hz").c_str(), nullptr, 10) : 0;
   hz = clamp_u32(hz, 1, FREQ_MAX);
-  server.send(200, "text/plain", qSend(CMD_FREQ, hz, 0) ? "ok" : "err");
+  webSend(200, "text/plain", qSend(CMD_FREQ, hz, 0) ? "ok" : "err");
 }
 static void handleSetAcc() {
   uint32_t hz = server.hasArg("hz") ? (uint32_t)strtoul(server.arg("hz").c_str(), nullptr, 10) : 0;
   hz = clamp_u32(hz, 1, 2000000);
-  server.send(200, "text/plain", qSend(CMD_ACCEL, hz, 0) ? "ok" : "err");
+  webSend(200, "text/plain", qSend(CMD_ACCEL, hz, 0) ? "ok" : "err");
 }
 static void handleSetDir() {
   uint32_t v = server.hasArg("v") ? (uint32_t)strtoul(server.arg("v").c_str(), nullptr, 10) : 0;
   v = v ? 1 : 0;
-  server.send(200, "text/plain", qSend(CMD_DIR, v, 0) ? "ok" : "err");
+  webSend(200, "text/plain", qSend(CMD_DIR, v, 0) ? "ok" : "err");
 }
 static void handleSetEn() {
   uint32_t v = server.hasArg("v") ? (uint32_t)strtoul(server.arg("v").c_str(), nullptr, 10) : 0;
   v = v ? 1 : 0;
-  server.send(200, "text/plain", qSend(CMD_EN, v, 0) ? "ok" : "err");
+  webSend(200, "text/plain", qSend(CMD_EN, v, 0) ? "ok" : "err");
 }
 static void handleRamp() {
   uint32_t hz = server.hasArg("hz") ? (uint32_t)strtoul(server.arg("hz").c_str(), nullptr, 10) : 0;
   uint32_t ms = server.hasArg("ms") ? (uint32_t)strtoul(server.arg("ms").c_str(), nullptr, 10) : 0;
   hz = clamp_u32(hz, 1, FREQ_MAX);
   ms = clamp_u32(ms, 50, 60000);
-  server.send(200, "text/plain", qSend(CMD_RAMP, hz, ms) ? "ok" : "err");
+  webSend(200, "text/plain", qSend(CMD_RAMP, hz, ms) ? "ok" : "err");
+}
+
+// /api/cam?pts=m:s,...  |  ?on=0|1  |  ?master=enc|virt&hz=<n>
+static void handleCam() {
+  bool ok = true;
+  if (server.hasArg("pts")) {
+    CamTable t;
+    ok = camParse(t, server.arg("pts").c_str());
+    if (ok) {
+      stageLock();
+      g_camNext = t;
+      stageUnlock();
+      ok = qSend(CMD_CAM, CAM_LOAD);
+    }
+  }
+  if (ok && server.hasArg("master")) {
+    bool virt = server.arg("master") == "virt";
+    int32_t hz = server.hasArg("hz") ? (int32_t)strtol(server.arg("hz").c_str(), nullptr, 10) : 0;
+    ok = qSend(CMD_CAM_MASTER, virt ? CAM_MST_VIRT : CAM_MST_ENC, (uint32_t)hz);
+  }
+  if (ok && server.hasArg("on")) {
+    ok = qSend(CMD_CAM, strtoul(server.arg("on").c_str(), nullptr, 10) ? CAM_ON : CAM_OFF);
+  }
+  webSend(200, "text/plain", ok ? "ok" : "err");
+}
+
+// /api/mpg?on=0|1&scale=1|10|100
+static void handleMpg() {
+  bool ok = true;
+  if (server.hasArg("scale")) {
+    ok = qSend(CMD_MPG, MPG_SCALE, strtoul(server.arg("scale").c_str(), nullptr, 10));
+  }
+  if (ok && server.hasArg("on")) {
+    ok = qSend(CMD_MPG, strtoul(server.arg("on").c_str(), nullptr, 10) ? MPG_ON : MPG_OFF);
+  }
+  webSend(200, "text/plain", ok ? "ok" : "err");
+}
+
+// /api/ain?on=0|1&shift=&db=&hyst=&fmin=&fmax=  (без аргументов — текущие параметры)
+static void handleAin() {
+  auto argU = [](const char* k, uint32_t def) {
+    return server.hasArg(k) ? (uint32_t)strtoul(server.arg(k).c_str(), nullptr, 10) : def;
+  };
+
+  g_ainCfg.iirShift = (uint8_t)clamp_u32(argU("shift", g_ainCfg.iirShift), 0, 12);
+  g_ainCfg.deadband = (uint16_t)clamp_u32(argU("db", g_ainCfg.deadband), 0, AIN_FULL / 4);
+  g_ainCfg.hyst     = (uint16_t)clamp_u32(argU("hyst", g_ainCfg.hyst), 0, AIN_FULL / 4);
+  g_ainCfg.fMin     = clamp_u32(argU("fmin", g_ainCfg.fMin), 1, FREQ_MAX);
+  g_ainCfg.fMax     = clamp_u32(argU("fmax", g_ainCfg.fMax), 1, FREQ_MAX);
+  if (server.hasArg("on")) g_ainOn = argU("on", 0) != 0;
+  g_ainRst = true;
+
+  char json[192];
+  snprintf(json, sizeof(json),
+           "{\"on\":%d,\"shift\":%u,\"db\":%u,\"hyst\":%u,\"fmin\":%lu,\"fmax\":%lu,\"sps\":%lu,\"ups\":%lu}",
+           (int)g_ainOn,
+           (unsigned)g_ainCfg.iirShift,
+           (unsigned)g_ainCfg.deadband,
+           (unsigned)g_ainCfg.hyst,
+           (unsigned long)g_ainCfg.fMin,
+           (unsigned long)g_ainCfg.fMax,
+           (unsigned long)g_ainSps,
+           (unsigned long)g_ainUps);
+  server.send(200, "application/json", json);
+}
+
+// /api/vib?on=0|1 — пики спектра вибрации
+static void handleVib() {
+  if (server.hasArg("on")) g_vibOn = strtoul(server.arg("on").c_str(), nullptr, 10) != 0;
+
+  VibPeak pk[VIB_PEAKS];
+  uint32_t stepHz = 0;
+  uint8_t n = vibSnapshot(pk, stepHz);
+
+  char json[384];
+  int len = snprintf(json, sizeof(json),
+                     "{\"on\":%d,\"fs\":%lu,\"fps\":%lu,\"drops\":%lu,\"us\":%lu,\"stepHz\":%lu,\"peaks\":[",
+                     (int)g_vibOn,
+                     (unsigned long)VIB_FS,
+                     (unsigned long)g_vibFps,
+                     (unsigned long)g_vibDrops,
+                     (unsigned long)g_vibUs,
+                     (unsigned long)stepHz);
+  for (uint8_t i = 0; i < n; i++) {
+    len += snprintf(json + len, sizeof(json) - len, "%s{\"mhz\":%lu,\"amp\":%u,\"ratio\":%lu}",
+                    i ? "," : "",
+                    (unsigned long)pk[i].mhz,
+                    (unsigned)pk[i].amp,
+                    (unsigned long)vibRatio(pk[i].mhz, stepHz));
+  }
+  snprintf(json + len, sizeof(json) - len, "]}");
+  server.send(200, "application/json", json);
+}
+
+// /api/prof?on=0|1&hz=<n>&clear=1 — состояние; /api/prof/dump — отсчёты для tools/prof_fold
+static void handleProf() {
+  if (server.hasArg("hz")) g_profHz = clamp_u32(strtoul(server.arg("hz").c_str(), nullptr, 10), 10, 20000);
+  if (server.hasArg("clear")) profClear();
+  if (server.hasArg("on")) profSet(strtoul(server.arg("on").c_str(), nullptr, 10) != 0);
+  else if (server.hasArg("hz") && g_profOn) profSet(true);
+
+  char json[192];
+  snprintf(json, sizeof(json),
+           "{\"on\":%d,\"hz\":%lu,\"samples\":[%lu,%lu],\"isrCycles\":[%lu,%lu]}",
+           (int)g_profOn,
+           (unsigned long)g_profHz,
+           (unsigned long)s_profHead[0],
+           (unsigned long)s_profHead[1],
+           (unsigned long)profIsrCycles(0),
+           (unsigned long)profIsrCycles(1));
+  server.send(200, "application/json", json);
+}
+
+static void handleProfDump() {
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server.send(200, "text/plain", "");
+  profDump([](const char* s) { server.sendContent(s); });
+}
+
+// /api/trig?arm=1 | ?off=1 — старт по фронту
+static void handleTrig() {
+  bool ok = true;
+  if (server.hasArg("off")) ok = qSend(CMD_TRIG, 0);
+  if (ok && server.hasArg("arm")) ok = qSend(CMD_TRIG, 1);
+  if (!ok) {
+    webSend(200, "text/plain", "err");
+    return;
+  }
+
+  TrigStats s = g_trigStats;
+  char json[256];
+  snprintf(json, sizeof(json),
+           "{\"state\":\"%s\",\"edges\":%lu,\"armUs\":%lu,\"steps\":%lu,"
+           "\"n\":%lu,\"lastNs\":%lu,\"minNs\":%lu,\"maxNs\":%lu,\"avgNs\":%lu}",
+           trigStateName(g_trigState),
+           (unsigned long)g_trigEdges,
+           (unsigned long)g_trigArmUs,
+           (unsigned long)s_trigRamp.steps,
+           (unsigned long)s.n,
+           (unsigned long)s.lastNs,
+           (unsigned long)s.minNs,
+           (unsigned long)s.maxNs,
+           s.n ? (unsigned long)(s.sumNs / s.n) : 0UL);
+  webSend(200, "application/json", json);
+}
+
+// /api/life[?save=1] — счётчики наработки
+static void handleLife() {
+  if (server.hasArg("save") && !qSend(CMD_LIFE, 0)) {
+    webSend(200, "text/plain", "err");
+    return;
+  }
+
+  LifeData d = g_life;
+  const LifeAxis& a = d.ax[0];
+  char json[320];
+  snprintf(json, sizeof(json),
+           "{\"steps\":%llu,\"runS\":%llu,\"reversals\":%lu,\"peakHz\":%lu,"
+           "\"boots\":%lu,\"alarms\":%lu,\"saves\":%lu,\"dirty\":%d,\"ageS\":%lu,"
+           "\"periodS\":%lu,\"saveUs\":%lu}",
+           (unsigned long long)a.steps,
+           (unsigned long long)(a.runMs / 1000),
+           (unsigned long)a.reversals,
+           (unsigned long)a.peakHz,
+           (unsigned long)d.boots,
+           (unsigned long)d.alarms,
+           (unsigned long)d.saves,
+           (int)s_lifeDirty,
+           (unsigned long)((millis() - s_lifeSavedMs) / 1000),
+           (unsigned long)s_lifePeriodS,
+           (unsigned long)g_lifeSaveUs);
+  webSend(200, "application/json", json);
+}
+
+// /api/tune?start=1&dist=<шаги>&tol=<шаги>  |  ?stop=1 — подбор ускорения
+static void handleTune() {
+  bool ok = true;
+  if (server.hasArg("tol")) g_tuneTol = clamp_u32(strtoul(server.arg("tol").c_str(), nullptr, 10), 1, 100000);
+  if (server.hasArg("stop")) ok = qSend(CMD_TUNE, 0);
+  if (ok && server.hasArg("start")) {
+    uint32_t dist = server.hasArg("dist") ? strtoul(server.arg("dist").c_str(), nullptr, 10) : 0;
+    ok = !g_tuneOn && qSend(CMD_TUNE, 1, dist);
+  }
+  if (!ok) {
+    webSend(200, "text/plain", "err");
+    return;
+  }
+
+  char json[256];
+  snprintf(json, sizeof(json),
+           "{\"state\":%u,\"accel\":%lu,\"from\":%lu,\"trial\":%lu,\"trials\":%u,"
+           "\"err\":%ld,\"tol\":%lu,\"dist\":%lu,\"oldUs\":%lu,\"newUs\":%lu}",
+           (unsigned)g_tuneState,
+           (unsigned long)g_accel,
+           (unsigned long)g_tuneFrom,
+           (unsigned long)g_tuneAccel,
+           (unsigned)s_tune.trials,
+           (long)g_tuneMaxErr,
+           (unsigned long)g_tuneTol,
+           (unsigned long)g_tuneDist,
+           (unsigned long)g_tuneOldUs,
+           (unsigned long)g_tuneNewUs);
+  webSend(200, "application/json", json);
+}
+
+// /api/res?scan=1&f0=<hz>&f1=<hz>&n=<точек>  |  ?stop=1  |  ?clear=1 — проход и полосы
+static void handleRes() {
+  bool ok = true;
+  if (server.hasArg("stop"))  ok = qSend(CMD_RES, RES_STOP);
+  if (ok && server.hasArg("clear")) ok = qSend(CMD_RES, RES_CLEAR);
+  if (ok && server.hasArg("scan")) {
+    stageLock();
+    ScanReq cur = g_scanReq;
+    stageUnlock();
+    uint32_t f0 = server.hasArg("f0") ? strtoul(server.arg("f0").c_str(), nullptr, 10) : cur.f0;
+    uint32_t f1 = server.hasArg("f1") ? strtoul(server.arg("f1").c_str(), nullptr, 10) : cur.f1;
+    uint32_t np = server.hasArg("n")  ? strtoul(server.arg("n").c_str(), nullptr, 10)  : cur.n;
+    ok = !g_scanOn && np >= 2 && np <= RES_MAX_PTS && f0 >= 1 && f1 > f0 && f1 <= FREQ_MAX;
+    if (ok) {
+      stageLock();
+      g_scanReq = {f0, f1, (uint16_t)np};
+      stageUnlock();
+      ok = qSend(CMD_RES, RES_SCAN);
+    }
+  }
+  if (!ok) {
+    webSend(200, "text/plain", "err");
+    return;
+  }
+
+  char json[384];
+  int len = snprintf(json, sizeof(json), "{\"scan\":%u,\"pts\":%u,\"n\":%u,\"bands\":[",
+                     (unsigned)g_scanState,
+                     (unsigned)g_scanI,
+                     (unsigned)(g_scanOn ? s_scan.n : g_scanI));
+  for (uint8_t i = 0; i < g_resBands; i++) {
+    len += snprintf(json + len, sizeof(json) - len, "%s[%lu,%lu]",
+                    i ? "," : "",
+                    (unsigned long)g_resBand[i].lo,
+                    (unsigned long)g_resBand[i].hi);
+  }
+  snprintf(json + len, sizeof(json) - len, "]}");
+  webSend(200, "application/json", json);
+}
+
+// /api/arc?p=<x> <y> <z> <i> <j> cw|ccw&feed=<hz>&tol=<миллишаги>  |  ?stop=1
+static void handleArc() {
+  if (server.hasArg("stop")) {
+    webSend(200, "text/plain", qSend(CMD_ARC, 0) ? "ok" : "err");
+    return;
+  }
+  if (server.hasArg("feed")) g_arcFeed = clamp_u32(strtoul(server.arg("feed").c_str(), nullptr, 10), 1, FREQ_MAX);
+  if (server.hasArg("tol"))  g_arcTol  = clamp_u32(strtoul(server.arg("tol").c_str(), nullptr, 10), 10, 100000);
+
+  bool ok = true;
+  if (server.hasArg("p")) {
+    Arc a;
+    ok = !g_arcOn && arcParse(a, server.arg("p").c_str(), g_arcTol / 1000.0f);
+    if (ok) {
+      stageLock();
+      g_arcNext = a;
+      stageUnlock();
+      ok = qSend(CMD_ARC, 1);
+    }
+  }
+  webSend(200, "text/plain", ok ? "ok" : "err");
+}
+
+// /api/shape?type=none|zv|zvd|ei&hz=<n>&zeta=<промилле>  (применяется только на стоящем двигателе)
+static void handleShape() {
+  String t = server.hasArg("type") ? server.arg("type") : String("none");
+  uint8_t type = (t == "zv") ? SHAPE_ZV : (t == "zvd") ? SHAPE_ZVD : (t == "ei") ? SHAPE_EI : SHAPE_NONE;
+  uint32_t hz = server.hasArg("hz") ? strtoul(server.arg("hz").c_str(), nullptr, 10) : g_shapeHz;
+  uint32_t zeta = server.hasArg("zeta") ? strtoul(server.arg("zeta").c_str(), nullptr, 10) : g_shapeZeta;
+  hz = clamp_u32(hz, 1, 1000);
+  zeta = clamp_u32(zeta, 0, 999);
+  webSend(200, "text/plain", qSend(CMD_SHAPE, type | (hz << 16), zeta) ? "ok" : "err");
+}
+
+// /api/can?rate=<ms>
+static void handleCan() {
+  if (server.hasArg("rate")) {
+    g_canPeriodMs = clamp_u32(strtoul(server.arg("rate").c_str(), nullptr, 10), 0, 60000);
+  }
+
+  char json[128];
+  snprintf(json, sizeof(json),
+           "{\"ok\":%d,\"node\":%u,\"rate\":%lu,\"rx\":%lu,\"tx\":%lu}",
+           (int)g_canOk,
+           (unsigned)CAN_NODE,
+           (unsigned long)g_canPeriodMs,
+           (unsigned long)g_canRx,
+           (unsigned long)g_canTx);
+  server.send(200, "application/json", json);
 }
 
 static void WebTask(void* arg) {
   while (true) {
+    wifiPoll();
+    s_cmdHdrSet = false;
     server.handleClient();
+    lpPoll();
     vTaskDelay(pdMS_TO_TICKS(1));
   }
 }
@@ -533,14 +4106,24 @@ static void WebTask(void* arg) {
 static void wifiInit() {
   WiFi.mode(WIFI_STA);
   WiFi.setSleep(false);
-  WiFi.begin(WIFI_SSID_C, WIFI_PASS_C);
+  WiFi.setAutoReconnect(false);    // переподключением управляет wifiPoll()
+  WiFi.onEvent(wifiEvent);
+  wifiCacheLoad();
 
   uint32_t t0 = millis();
-  while (WiFi.status() != WL_CONNECTED && (millis() - t0) < 15000) delay(250);
+  wifiPoll();
+  while (g_wifiState != WIFI_UP && (millis() - t0) < 15000) {
+    delay(20);
+    wifiPoll();
+  }
+
+  static const char* HDRS[] = {"If-None-Match"};
+  server.collectHeaders(HDRS, 1);
 
   server.on("/", HTTP_ANY, handleRoot);
 
   server.on("/api/status", HTTP_ANY, handleStatus);
+  server.on("/api/cmd",    HTTP_ANY, handleCmd);
 
   server.on("/api/start",  HTTP_ANY, handleStart);
   server.on("/api/stop",   HTTP_ANY, handleStop);
@@ -549,16 +4132,29 @@ static void wifiInit() {
   server.on("/api/dir",    HTTP_ANY, handleSetDir);
   server.on("/api/en",     HTTP_ANY, handleSetEn);
   server.on("/api/ramp",   HTTP_ANY, handleRamp);
+  server.on("/api/cam",    HTTP_ANY, handleCam);
+  server.on("/api/mpg",    HTTP_ANY, handleMpg);
+  server.on("/api/ain",    HTTP_ANY, handleAin);
+  server.on("/api/can",    HTTP_ANY, handleCan);
+  server.on("/api/shape",  HTTP_ANY, handleShape);
+  server.on("/api/arc",    HTTP_ANY, handleArc);
+  server.on("/api/vib",    HTTP_ANY, handleVib);
+  server.on("/api/res",    HTTP_ANY, handleRes);
+  server.on("/api/tune",   HTTP_ANY, handleTune);
+  server.on("/api/trig",   HTTP_ANY, handleTrig);
+  server.on("/api/life",   HTTP_ANY, handleLife);
+  server.on("/api/prof",   HTTP_ANY, handleProf);
+  server.on("/api/prof/dump", HTTP_ANY, handleProfDump);
 
   server.onNotFound([](){
     if (server.method() == HTTP_OPTIONS) { server.send(204); return; }
     if (server.uri() == "/favicon.ico")  { server.send(204); return; }
     if (server.uri() == "/robots.txt")   { server.send(204); return; }
 
-    Serial.printf("[HTTP 404] %s %s\n",
-                  (server.method() == HTTP_GET) ? "GET" :
-                  (server.method() == HTTP_POST) ? "POST" : "OTHER",
-                  server.uri().c_str());
+    LOGW("HTTP 404 %s %s",
+         (server.method() == HTTP_GET) ? "GET" :
+         (server.method() == HTTP_POST) ? "POST" : "OTHER",
+         server.uri().c_str());
 
     server.send(404, "text/plain", "404");
   });
@@ -569,6 +4165,9 @@ static void wifiInit() {
 
 void setup() {
   Serial.begin(115200);
+  s_stageLock = xSemaphoreCreateMutex();
+  s_rbLock = xSemaphoreCreateMutex();
+  statusInit(s_status, esp_random());
 
   pinMode(PIN_STEP, OUTPUT);
   pinMode(PIN_DIR, OUTPUT);
@@ -590,15 +4189,39 @@ void setup() {
   }
 
   stepper->setDirectionPin(PIN_DIR);
+  atuneLoad();
+  retainRestore();
+  pfInit();
+  lifeLoad();
+  moInit(s_mo, g_en, g_alarm, g_dir);
+  LOGI("boot: reset %u, restored %u, pf %d", (unsigned)g_resetReason, (unsigned)g_restored, (int)g_pfRestored);
+  resLoad();
   applyParamsToStepper();
+  trigInit();
+  rbInit();
+
+  profInit();
+  pcntInit(s_mstEnc, PCNT_MST, PIN_MST_A, PIN_MST_B);
+  pcntInit(s_mpgEnc, PCNT_MPG, PIN_MPG_A, PIN_MPG_B);
 
   qCmd = xQueueCreate(16, sizeof(Cmd));
 
   wifiInit();
 
-  xTaskCreatePinnedToCore(StepTask,    "StepTask", 4096, nullptr, 3, nullptr, 1);
+  xTaskCreatePinnedToCore(NvsTask,     "Nvs",      4096, nullptr, 1, &s_nvsTask, 0);
+  xTaskCreatePinnedToCore(StepTask,    "StepTask", 4096, nullptr, 3, &s_stepTask, 1);
+  pfStart();
   xTaskCreatePinnedToCore(ConsoleTask, "Console",  4096, nullptr, 2, nullptr, 0);
   xTaskCreatePinnedToCore(WebTask,     "Web",      4096, nullptr, 2, nullptr, 0);
+
+  adcInit();
+  xTaskCreatePinnedToCore(VibTask,     "Vib",      3072, nullptr, 1, &s_vibTask, 1);
+  xTaskCreatePinnedToCore(AdcTask,     "Adc",      3072, nullptr, 2, nullptr, 0);
+  xTaskCreatePinnedToCore(CanTask,     "Can",      3072, nullptr, 2, nullptr, 0);
+  xTaskCreatePinnedToCore(ModbusTask,  "Modbus",   3072, nullptr, 2, nullptr, 0);
+  xTaskCreatePinnedToCore(StreamTask,  "Stream",   4096, nullptr, 2, nullptr, 0);
+  xTaskCreatePinnedToCore(LogTask,     "Log",      3072, nullptr, 1, nullptr, 0);
+  xTaskCreatePinnedToCore(TconTask,    "Tcon",     4096, nullptr, 2, nullptr, 0);
 }
 
 void loop() {
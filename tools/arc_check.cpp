@@ -0,0 +1,97 @@
+// Проверка дуговой интерполяции (include/arc.h) на хосте: случайные
+// дуги и винты, радиальная ошибка вершин, точек на хордах и позиций
+// после округления до шагов, ошибка конечной точки и число хорд,
+// которые иначе пришлось бы слать линиями. Стрелка не больше tol — с
+// ошибкой float вместе, её arcPrepare вычитает из допуска; наружу от
+// радиуса — не дальше ошибки float (arcFloatErr) этой дуги.
+//
+//   g++ -O2 -Iinclude tools/arc_check.cpp -o arc_check
+//   ./arc_check [tol_steps] [arcs]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "arc.h"
+
+static double frand(double lo, double hi) {
+  return lo + (hi - lo) * (rand() / (double)RAND_MAX);
+}
+
+int main(int argc, char** argv) {
+  double tol = argc > 1 ? atof(argv[1]) : 0.5;
+  int arcs = argc > 2 ? atoi(argv[2]) : 2000;
+  srand(1);
+
+  double maxChord = 0, maxStep = 0, maxEnd = 0, maxOut = 0, maxZ = 0, maxOutBound = 0;
+  int outBad = 0;
+  unsigned long segs = 0;
+  int bad = 0, tested = 0;
+
+  for (int k = 0; k < arcs; k++) {
+    double r = exp(frand(log(20.0), log(100000.0)));
+    double a0 = frand(-M_PI, M_PI);
+    double sw = frand(0.05, 2 * M_PI) * (rand() & 1 ? 1 : -1);
+    bool full = (k % 10) == 0;
+    if (full) sw = sw > 0 ? 2 * M_PI : -2 * M_PI;
+    double z = (k % 3) ? 0 : frand(-5 * r, 5 * r);
+
+    // центр относительно старта, конец — в целых шагах, как придёт с хоста
+    double i = -r * cos(a0), j = -r * sin(a0);
+    double x = full ? 0 : rint(i + r * cos(a0 + sw));
+    double y = full ? 0 : rint(j + r * sin(a0 + sw));
+    z = rint(z);
+
+    Arc a;
+    if (!arcPrepare(a, (float)x, (float)y, (float)z, (float)i, (float)j, sw < 0, (float)tol)) {
+      bad++;
+      continue;
+    }
+    tested++;
+    segs += a.n;
+
+    // подача как на устройстве: тик 1 мс
+    ArcFeed f = {0, 0};
+    double feed = frand(1000, 40000), acc = frand(20000, 400000);
+    double dzds = z / a.len;
+    double rLo = fmin(a.r, a.r + a.dr), rHi = fmax(a.r, a.r + a.dr);
+    double fe = arcFloatErr(a.cx, a.cy, (float)rHi);
+    if (fe > maxOutBound) maxOutBound = fe;
+    while (true) {
+      float p[3];
+      arcEval(a, f.s, p);
+      // идеальный радиус — между радиусами старта и конца
+      double rr = hypot(p[0] - a.cx, p[1] - a.cy);
+      double e = rLo - rr;                              // хорда всегда внутри
+      if (e > maxChord) maxChord = e;
+      if (rr - rHi > maxOut) maxOut = rr - rHi;
+      if (rr - rHi > fe) outBad++;
+
+      double q = hypot(rint(p[0]) - a.cx, rint(p[1]) - a.cy);
+      double eq = q < rLo ? rLo - q : q > rHi ? q - rHi : 0;
+      if (eq > maxStep) maxStep = eq;
+
+      double ez = fabs(p[2] - dzds * f.s);
+      if (ez > maxZ) maxZ = ez;
+
+      if (f.s >= a.len) {
+        double ee = fabs(rint(p[0]) - x) + fabs(rint(p[1]) - y) + fabs(rint(p[2]) - z);
+        if (ee > maxEnd) maxEnd = ee;
+        break;
+      }
+      arcFeedTick(f, a.len, (float)feed, (float)acc, 0.001f);
+    }
+  }
+
+  printf("tol %.3f step, %d arcs (%d rejected)\n", tol, tested, bad);
+  printf("chord sag max   %.4f step (bound %.3f)\n", maxChord, tol);
+  printf("outside radius  %.4f step (bound float err, up to %.4f)\n", maxOut, maxOutBound);
+  printf("after rounding  %.4f step (bound %.3f)\n", maxStep, tol + M_SQRT1_2);
+  printf("helix z dev     %.4f step\n", maxZ);
+  printf("end error       %.0f step\n", maxEnd);
+  printf("chords per arc  %.1f avg\n", tested ? (double)segs / tested : 0.0);
+
+  bool ok = maxChord <= tol && outBad == 0 && maxStep <= tol + M_SQRT1_2 && maxEnd == 0;
+  printf("%s\n", ok ? "OK" : "FAIL");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,123 @@
+// Моделирование подбора ускорения (include/atune.h) на хосте.
+// Двигатель с падающей кривой момента: доступное ускорение
+// A0 * (1 - v / vz), от хода к ходу плавает на несколько процентов
+// (трение, напряжение). Команда — трапеция FastAccelStepper, ротор
+// повторяет её, пока хватает момента; не хватило — срыв, ротор
+// останавливается, энкодер это видит. Проверяется, что итог ниже
+// настоящего предела с запасом и что на нём нет срывов, и насколько
+// короче становится ход.
+//
+//   g++ -O2 -Iinclude tools/atune_sim.cpp -o atune_sim
+//   ./atune_sim [speed_hz] [dist_steps] [runs]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "atune.h"
+
+static const double A0     = 1.2e6;   // Гц/с на нуле скорости
+static const double VZ     = 60000;   // скорость, где момента не остаётся
+static const double SPREAD = 0.03;    // разброс предела от хода к ходу (сигма)
+static const int    ENC_NUM = 5, ENC_DEN = 4;   // 4000 отсчётов на 3200 шагов
+static const int32_t TOL   = 32;      // допуск ошибки слежения, шаги
+
+static double gauss() {
+  double u = (rand() + 1.0) / (RAND_MAX + 2.0), v = (rand() + 1.0) / (RAND_MAX + 2.0);
+  return sqrt(-2 * log(u)) * cos(2 * M_PI * v);
+}
+
+static double limitAt(double v) {
+  return A0 * (1 - v / VZ);
+}
+
+// Один ход на dist шагов; true — энкодер не разошёлся с командой.
+static bool trial(uint32_t dist, uint32_t vmax, uint32_t acc) {
+  const double dt = 1e-4;
+  double k = 1 + SPREAD * gauss();
+  double p = 0, v = 0;          // команда
+  double rp = 0, rv = 0;        // ротор
+  bool slip = false;
+  int32_t maxErr = 0;
+
+  double tAcc = (double)vmax / acc;
+  double dAcc = 0.5 * acc * tAcc * tAcc;
+  double vTop = dAcc * 2 <= dist ? vmax : sqrt((double)acc * dist);
+
+  for (int i = 0; i < 1000000 && (p < dist || rv > 0); i++) {
+    // трапеция по оставшемуся пути
+    double left = dist - p;
+    double a = 0;
+    if (v * v / (2.0 * acc) >= left) a = -(double)acc;
+    else if (v < vTop)               a = acc;
+    v += a * dt;
+    if (v < 0) v = 0;
+    if (v > vTop) v = vTop;
+    p += v * dt;
+    if (p >= dist || (a < 0 && v == 0)) { p = dist; v = 0; }
+
+    // ротор: в синхронизме, пока требуемое ускорение в пределах момента
+    if (!slip && fabs(a) > limitAt(v) * k) slip = true;
+    if (!slip) { rp = p; rv = v; }
+    else {
+      rv -= limitAt(rv) * k * dt;
+      if (rv < 0) rv = 0;
+      rp += rv * dt;
+    }
+
+    // опрос энкодера раз в 1 мс, как в StepTask
+    if (i % 10 == 0) {
+      int32_t enc = (int32_t)floor(rp * ENC_NUM / ENC_DEN);
+      int32_t e = atuneErr(enc, (int32_t)floor(p), ENC_NUM, ENC_DEN);
+      if (abs(e) > maxErr) maxErr = abs(e);
+    }
+  }
+  return maxErr <= TOL;
+}
+
+int main(int argc, char** argv) {
+  uint32_t speed = argc > 1 ? (uint32_t)atoi(argv[1]) : 20000;
+  uint32_t dist  = argc > 2 ? (uint32_t)atoi(argv[2]) : 3200;
+  int runs       = argc > 3 ? atoi(argv[3]) : 100;
+  srand(1);
+
+  const AtuneCfg cfg = {100000, 2000000, 1250, 3, 4, 750};
+  double lim = limitAt(speed);
+
+  int fails = 0;
+  long stalls = 0, checks = 0;
+  double worst = 0, best = 1e9, sum = 0;
+  unsigned trials = 0;
+  uint32_t last = 0;
+
+  for (int r = 0; r < runs; r++) {
+    Atune t;
+    atuneBegin(t, cfg);
+    while (atuneNext(t, trial(dist, speed, t.accel))) {}
+    trials += t.trials;
+    if (t.phase != AT_DONE) { fails++; continue; }
+
+    double q = t.result / lim;
+    if (q > worst) worst = q;
+    if (q < best) best = q;
+    sum += q;
+    last = t.result;
+
+    // надёжность итога: ходы с тем же разбросом
+    for (int i = 0; i < 200; i++, checks++) if (!trial(dist, speed, t.result)) stalls++;
+  }
+
+  int ok = runs - fails;
+  printf("speed %u Hz, dist %u steps, true limit %.0f Hz/s (+-%.0f%%)\n", speed, dist, lim, SPREAD * 100);
+  printf("runs %d, failed %d, trials/run %.1f\n", runs, fails, (double)trials / runs);
+  if (ok) {
+    printf("result/limit: min %.3f avg %.3f max %.3f\n", best, sum / ok, worst);
+    printf("stalls at result: %ld of %ld moves\n", stalls, checks);
+    uint32_t t0 = atuneMoveUs(dist, speed, cfg.a0), t1 = atuneMoveUs(dist, speed, last);
+    printf("move time: %.1f ms at %u Hz/s -> %.1f ms at %u Hz/s (%.0f%% shorter)\n",
+           t0 / 1000.0, cfg.a0, t1 / 1000.0, last, 100.0 * (t0 - t1) / t0);
+  }
+  bool pass = fails == 0 && stalls == 0;
+  printf("%s\n", pass ? "OK" : "FAIL");
+  return pass ? 0 : 1;
+}
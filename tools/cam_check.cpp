@@ -0,0 +1,201 @@
+// Проверка электронного кулачка (include/cam.h) на хосте.
+//
+// 1. Точность: для набора таблиц (возвратная, вращательная, неравные и
+//    предельные по длине сегменты, спады) camEval на проходе мастера по
+//    нескольким периодам в обе стороны против идеальной кусочно-линейной
+//    кривой в точной арифметике — не дальше 1 шага.
+// 2. Гладкий кулачок (циклоида по 64 точкам) против аналитической
+//    кривой — в пределах ошибки линейной интерполяции h^2 * max|s''| / 8
+//    плюс шаг.
+// 3. Стык периодов: в m = k * P значение ровно s[0] + k * (s[n-1] - s[0]),
+//    скачок через стык — не больше, чем внутри сегментов.
+// 4. Как в camTick: виртуальный мастер (camVirtualTick, тик 1 мс) ведёт
+//    кулачок — позиция мастера без дрейфа, скачок slave за тик не
+//    больше наклона на путь мастера за тик.
+// 5. Переполнение: счётчик мастера (энкодер, виртуальная ось) и сам путь
+//    от начала профиля (как после нескольких часов на десятках кГц)
+//    проходят через 2^31, период не степень двойки — путь копится
+//    приращениями (camMasterUpdate), кулачок идёт без скачка фазы.
+//
+//   g++ -O2 -Iinclude tools/cam_check.cpp -o cam_check && ./cam_check
+
+#include <stdio.h>
+#include <math.h>
+#include <string.h>
+
+#include "cam.h"
+
+static int g_bad;
+
+// Идеал: тот же кусочно-линейный профиль в double.
+static double ideal(const CamTable& t, double x) {
+  double P = camPeriod(t);
+  double cyc = floor(x / P);
+  double r = x - cyc * P;
+  uint16_t i = 0;
+  while (i + 2 < t.n && t.m[i + 1] <= r) i++;
+  double y = t.s[i] + (double)(t.s[i + 1] - t.s[i]) * (r - t.m[i]) / (t.m[i + 1] - t.m[i]);
+  return y + cyc * (t.s[t.n - 1] - t.s[0]);
+}
+
+// Наибольший |наклон| сегмента, шагов на отсчёт мастера.
+static double maxSlope(const CamTable& t) {
+  double k = 0;
+  for (uint16_t i = 0; i + 1 < t.n; i++) {
+    k = fmax(k, fabs((double)(t.s[i + 1] - t.s[i]) / (t.m[i + 1] - t.m[i])));
+  }
+  return k;
+}
+
+static void table(const char* name, const char* pts) {
+  CamTable t;
+  if (!camParse(t, pts)) {
+    printf("%-10s parse failed\n", name);
+    g_bad++;
+    return;
+  }
+  int32_t P = camPeriod(t);
+  double k = maxSlope(t);
+
+  // 1. проход мастера: -3 .. +3 периода, шаг выбран так, чтобы попадать
+  // и в узлы, и между ними
+  double maxErr = 0;
+  int32_t step = P / 20000 > 0 ? P / 20000 : 1;
+  for (int64_t x = -3LL * P; x <= 3LL * P; x += step) {
+    double e = fabs(camEval(t, (int32_t)x) - ideal(t, (double)x));
+    maxErr = fmax(maxErr, e);
+  }
+
+  // 3. стык периодов
+  int32_t rise = t.s[t.n - 1] - t.s[0];
+  double maxJump = 0;
+  bool exact = true;
+  for (int c = -3; c <= 3; c++) {
+    int32_t x = c * P;
+    if (camEval(t, x) != t.s[0] + c * rise) exact = false;
+    maxJump = fmax(maxJump, fabs((double)camEval(t, x) - camEval(t, x - 1)));
+    maxJump = fmax(maxJump, fabs((double)camEval(t, x + 1) - camEval(t, x)));
+  }
+  double jumpBound = ceil(k) + 1;
+
+  bool ok = maxErr <= 1.0 && exact && maxJump <= jumpBound;
+  printf("%-10s pts %2u period %7ld max_err %.3f  wrap exact %s jump %.0f (<= %.0f) %s\n",
+         name, (unsigned)t.n, (long)P, maxErr, exact ? "yes" : "NO", maxJump, jumpBound, ok ? "ok" : "FAIL");
+  if (!ok) g_bad++;
+}
+
+// 2. циклоида: s(x) = H * (x/P - sin(2 pi x / P) / 2 pi), подъём H за период
+static void cycloid() {
+  const int N = CAM_MAX_POINTS;
+  const int32_t P = 63 * 1000;
+  const double H = 20000;
+  CamTable t;
+  t.n = N;
+  for (int i = 0; i < N; i++) {
+    double x = (double)P * i / (N - 1);
+    t.m[i] = (int32_t)lround(x);
+    t.s[i] = (int32_t)lround(H * (x / P - sin(2 * M_PI * x / P) / (2 * M_PI)));
+  }
+  if (!camPrepare(t)) {
+    printf("cycloid    prepare failed\n");
+    g_bad++;
+    return;
+  }
+  double h = (double)P / (N - 1);
+  double bound = h * h * (2 * M_PI * H / ((double)P * P)) / 8 + 1.0;
+  double maxErr = 0;
+  for (int32_t x = -P; x <= 2 * P; x++) {
+    double cyc = floor((double)x / P);
+    double r = x - cyc * P;
+    double s = H * (r / P - sin(2 * M_PI * r / P) / (2 * M_PI)) + cyc * H;
+    maxErr = fmax(maxErr, fabs(camEval(t, x) - s));
+  }
+  bool ok = maxErr <= bound;
+  printf("%-10s pts %2u period %7ld max_err %.3f vs analytic (<= %.3f) %s\n",
+         "cycloid", (unsigned)t.n, (long)P, maxErr, bound, ok ? "ok" : "FAIL");
+  if (!ok) g_bad++;
+}
+
+// 4. виртуальный мастер, как camTick
+static void virtualSweep() {
+  CamTable t;
+  camParse(t, "0:0,1000:800,2500:800,4000:-300,6000:0");
+  double k = maxSlope(t);
+  const int32_t rates[] = {1, 997, 50000, -12345, 400000};
+  for (int32_t rate : rates) {
+    CamVirtualAxis v = {0, rate, 0};
+    int32_t last = camEval(t, 0);
+    double maxErr = 0, maxJump = 0, drift = 0;
+    const int TICKS = 200000;
+    for (int i = 1; i <= TICKS; i++) {
+      camVirtualTick(v, 1000);
+      int32_t x = camVirtualPos(v);
+      int32_t s = camEval(t, x);
+      maxErr = fmax(maxErr, fabs(s - ideal(t, x)));
+      maxJump = fmax(maxJump, fabs((double)(s - last)));
+      last = s;
+      drift = fmax(drift, fabs(x - (double)rate * i / 1000.0));
+    }
+    double jumpBound = ceil(k * (fabs((double)rate) / 1000.0 + 1)) + 1;
+    bool ok = maxErr <= 1.0 && drift <= 1.0 && maxJump <= jumpBound;
+    printf("virtual %7ld cnt/s: max_err %.3f drift %.3f jump/tick %.0f (<= %.0f) %s\n",
+           (long)rate, maxErr, drift, maxJump, jumpBound, ok ? "ok" : "FAIL");
+    if (!ok) g_bad++;
+  }
+}
+
+// 5. как camTick, но счётчик мастера и путь — у самого края int32
+static void masterWrap() {
+  CamTable t;
+  camParse(t, "0:0,1000:800,2500:800,4000:-300,6007:0");
+  double k = maxSlope(t);
+  struct Src { const char* name; bool virt; int32_t rate; };
+  const Src srcs[] = {{"encoder", false, 60000}, {"encoder", false, -60000}, {"virtual", true, 400000}};
+  for (const Src& src : srcs) {
+    CamVirtualAxis v = {((int64_t)INT32_MAX - 3000000) << 16, src.rate, 0};
+    int32_t enc = src.rate > 0 ? INT32_MAX - 3000000 : INT32_MIN + 3000000;
+    auto cnt = [&]() { return src.virt ? camVirtualPos(v) : enc; };
+    CamMasterPath m;
+    camMasterStart(m, cnt());
+    int64_t x0 = src.rate > 0 ? INT32_MAX - 3000000LL : INT32_MIN + 3000000LL;
+    m.x = x0;
+    int32_t last = camEval(t, x0);
+    double maxErr = 0, maxJump = 0;
+    bool crossed = false;
+    int32_t prev = cnt();
+    const int TICKS = 100000;
+    for (int i = 1; i <= TICKS; i++) {
+      if (src.virt) camVirtualTick(v, 1000);
+      else enc = (int32_t)((uint32_t)enc + (uint32_t)(src.rate / 1000));
+      int32_t c = cnt();
+      if ((c < 0) != (prev < 0)) crossed = true;
+      prev = c;
+      int64_t x = camMasterUpdate(m, c);
+      int32_t s = camEval(t, x);
+      maxErr = fmax(maxErr, fabs(s - ideal(t, (double)x)));
+      maxJump = fmax(maxJump, fabs((double)(s - last)));
+      last = s;
+    }
+    double jumpBound = ceil(k * (fabs((double)src.rate) / 1000.0 + 1)) + 1;
+    bool ok = crossed && maxErr <= 1.0 && maxJump <= jumpBound && m.x == x0 + (int64_t)src.rate * TICKS / 1000 &&
+              (m.x > INT32_MAX || m.x < INT32_MIN);
+    printf("wrap %-7s %7ld cnt/s: crossed %s max_err %.3f jump/tick %.0f (<= %.0f) path %lld %s\n",
+           src.name, (long)src.rate, crossed ? "yes" : "NO", maxErr, maxJump, jumpBound, (long long)m.x,
+           ok ? "ok" : "FAIL");
+    if (!ok) g_bad++;
+  }
+}
+
+int main() {
+  table("linear", "0:0,1000:1000");
+  table("return", "0:0,250:400,500:400,750:0,1000:0");
+  table("rotary", "0:0,300:100,900:900,1200:1000");
+  table("uneven", "0:0,1:5,7:-3,40000:12345,40003:12345,105000:-77");
+  table("long-seg", "0:0,65535:1000000,131070:-1000000,196605:0");
+  table("steep", "0:0,10:30000,20:0,30:-30000,40:0");
+  cycloid();
+  virtualSweep();
+  masterWrap();
+  printf("%s\n", g_bad ? "FAIL" : "OK");
+  return g_bad ? 1 : 0;
+}
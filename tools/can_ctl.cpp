@@ -0,0 +1,118 @@
+// Управление узлом по CAN с Linux (SocketCAN). Проверка протокола без
+// железа: поднять vcan0 и смотреть кадры через candump.
+//
+//   sudo ip link add dev vcan0 type vcan && sudo ip link set up vcan0
+//   g++ -O2 -Iinclude tools/can_ctl.cpp -o can_ctl
+//   ./can_ctl vcan0 1 f 20000 [acc]
+//   ./can_ctl vcan0 1 start | stop | dir <0|1> | en <0|1> | ramp <hz> <ms> | rate <ms>
+//   ./can_ctl vcan0 1 sync          — SYNC и ожидание STATUS
+//   ./can_ctl vcan0 1 listen        — печать STATUS всех узлов
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <net/if.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <linux/can.h>
+#include <linux/can/raw.h>
+
+#include "canproto.h"
+
+static int canOpen(const char* ifname) {
+  int s = socket(PF_CAN, SOCK_RAW, CAN_RAW);
+  if (s < 0) { perror("socket"); exit(1); }
+
+  struct ifreq ifr;
+  memset(&ifr, 0, sizeof(ifr));
+  strncpy(ifr.ifr_name, ifname, IFNAMSIZ - 1);
+  if (ioctl(s, SIOCGIFINDEX, &ifr) < 0) { perror(ifname); exit(1); }
+
+  struct sockaddr_can addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.can_family = AF_CAN;
+  addr.can_ifindex = ifr.ifr_ifindex;
+  if (bind(s, (struct sockaddr*)&addr, sizeof(addr)) < 0) { perror("bind"); exit(1); }
+  return s;
+}
+
+static void canTx(int s, const CanFrame& f) {
+  struct can_frame cf;
+  memset(&cf, 0, sizeof(cf));
+  cf.can_id = f.id;
+  cf.can_dlc = f.dlc;
+  memcpy(cf.data, f.data, f.dlc);
+  if (write(s, &cf, sizeof(cf)) != sizeof(cf)) perror("write");
+}
+
+static bool canRx(int s, CanFrame& f) {
+  struct can_frame cf;
+  if (read(s, &cf, sizeof(cf)) != sizeof(cf)) return false;
+  f.id = cf.can_id & CAN_SFF_MASK;
+  f.dlc = cf.can_dlc;
+  memcpy(f.data, cf.data, 8);
+  return true;
+}
+
+static void printStatus(int s, int onlyNode, int count) {
+  CanFrame f;
+  while (count != 0 && canRx(s, f)) {
+    uint8_t node;
+    CanStatus st;
+    if (!canDecodeStatus(f, node, st)) continue;
+    if (onlyNode >= 0 && node != onlyNode) continue;
+    printf("node=%u runReq=%d running=%d dir=%d en=%d alarm=%d freq=%u pos=%d\n",
+           node,
+           !!(st.flags & CAN_ST_RUNREQ),
+           !!(st.flags & CAN_ST_RUNNING),
+           !!(st.flags & CAN_ST_DIR),
+           !!(st.flags & CAN_ST_EN),
+           !!(st.flags & CAN_ST_ALARM),
+           st.freq,
+           st.pos);
+    fflush(stdout);
+    if (count > 0) count--;
+  }
+}
+
+int main(int argc, char** argv) {
+  if (argc < 4) {
+    fprintf(stderr, "usage: %s <if> <node> <cmd> [args]\n", argv[0]);
+    return 2;
+  }
+
+  int s = canOpen(argv[1]);
+  uint8_t node = (uint8_t)strtoul(argv[2], nullptr, 0);
+  const char* cmd = argv[3];
+  uint32_t a = argc > 4 ? strtoul(argv[4], nullptr, 0) : 0;
+  uint32_t b = argc > 5 ? strtoul(argv[5], nullptr, 0) : 0;
+
+  CanFrame f;
+  if (!strcmp(cmd, "f"))          canEncodeSetpoint(f, node, a, b);
+  else if (!strcmp(cmd, "start")) canEncodeControl(f, node, CAN_OP_START, 0, 0);
+  else if (!strcmp(cmd, "stop"))  canEncodeControl(f, node, CAN_OP_STOP, 0, 0);
+  else if (!strcmp(cmd, "dir"))   canEncodeControl(f, node, CAN_OP_DIR, a, 0);
+  else if (!strcmp(cmd, "en"))    canEncodeControl(f, node, CAN_OP_EN, a, 0);
+  else if (!strcmp(cmd, "ramp"))  canEncodeControl(f, node, CAN_OP_RAMP, a, (uint16_t)b);
+  else if (!strcmp(cmd, "rate"))  canEncodeControl(f, node, CAN_OP_RATE, a, 0);
+  else if (!strcmp(cmd, "sync")) {
+    struct timeval tv = {1, 0};
+    setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    canEncodeSync(f, 0);
+    canTx(s, f);
+    printStatus(s, node, 1);
+    return 0;
+  } else if (!strcmp(cmd, "listen")) {
+    printStatus(s, -1, -1);
+    return 0;
+  } else {
+    fprintf(stderr, "unknown cmd: %s\n", cmd);
+    return 2;
+  }
+
+  canTx(s, f);
+  close(s);
+  return 0;
+}
@@ -0,0 +1,117 @@
+// Журнал команд HTTP (include/cmdlog.h) на хосте.
+//
+// Модель qSend: cmdlogClaim, постановка в очередь (может не влезть —
+// LOST), StepTask отмечает DONE/REFUSED. Проверяется:
+// 1. Запрос с несколькими командами под одним rid (как /api/cam с pts и
+//    on, /api/res со stop и clear) ставит в очередь каждую.
+// 2. Повтор того же запроса ничего не ставит и отвечает результатами
+//    первой попытки.
+// 3. Повтор после LOST ставится заново и проходит; REFUSED — отвечается
+//    из журнала.
+// 4. Без rid каждая команда новая; rid, вытесненный из окна, — тоже.
+//
+//   g++ -O2 -Iinclude tools/cmdlog_check.cpp -o cmdlog_check && ./cmdlog_check
+
+#include <stdio.h>
+#include <vector>
+
+#include "cmdlog.h"
+
+struct Sent {
+  uint32_t seq;
+  uint8_t type;
+  uint32_t a;
+};
+
+static CmdLog g_log;
+static std::vector<Sent> g_queue;
+static bool g_full;              // очередь полна — следующая команда теряется
+static bool g_refuse;            // StepTask отказывает
+
+// Как qSend: true — команда принята (новая или повтор не-отказанной).
+static bool send(uint32_t rid, uint8_t type, uint32_t a, bool* dupOut = nullptr) {
+  CmdRec r;
+  bool dup = cmdlogClaim(g_log, rid, type, a, r);
+  if (dupOut) *dupOut = dup;
+  if (dup) return r.st != CMD_ST_REFUSED;
+  CmdRec* cur = cmdlogBySeq(g_log, r.seq);
+  if (g_full) {
+    cur->st = CMD_ST_LOST;
+    return false;
+  }
+  g_queue.push_back({r.seq, type, a});
+  return true;
+}
+
+// StepTask разбирает очередь.
+static void drain() {
+  for (const Sent& s : g_queue) {
+    CmdRec* r = cmdlogBySeq(g_log, s.seq);
+    if (r) r->st = g_refuse ? CMD_ST_REFUSED : CMD_ST_DONE;
+  }
+  g_queue.clear();
+}
+
+static int g_bad;
+
+static void expect(bool c, const char* what) {
+  printf("  %-58s %s\n", what, c ? "ok" : "FAIL");
+  if (!c) g_bad++;
+}
+
+int main() {
+  enum { T_CAM = 4, T_RES = 7 };
+  uint32_t rid = cmdRid("req-1");
+
+  // 1. одна HTTP-просьба — две команды
+  bool d1, d2;
+  bool ok = send(rid, T_CAM, 2, &d1) && send(rid, T_CAM, 1, &d2);
+  expect(ok && !d1 && !d2 && g_queue.size() == 2, "multi-command request queues every command");
+  drain();
+
+  // 2. повтор запроса целиком
+  size_t seqBefore = g_log.seq;
+  ok = send(rid, T_CAM, 2, &d1) && send(rid, T_CAM, 1, &d2);
+  expect(ok && d1 && d2 && g_queue.empty() && g_log.seq == seqBefore, "retry of the request replays both, queues nothing");
+
+  // тот же rid, другая команда — это не повтор
+  ok = send(rid, T_RES, 0, &d1);
+  expect(ok && !d1 && g_queue.size() == 1, "same rid, different command is queued");
+  drain();
+
+  // 3. первая попытка потерялась
+  uint32_t rid2 = cmdRid("req-2");
+  g_full = true;
+  ok = send(rid2, T_RES, 1);
+  expect(!ok && g_queue.empty(), "full queue: command lost, reported as error");
+  g_full = false;
+  ok = send(rid2, T_RES, 1, &d1);
+  expect(ok && !d1 && g_queue.size() == 1, "retry after LOST is queued again");
+  drain();
+  ok = send(rid2, T_RES, 1, &d1);
+  expect(ok && d1 && g_queue.empty(), "next retry replays DONE");
+
+  // отказ отвечается из журнала, не повторяется
+  uint32_t rid3 = cmdRid("req-3");
+  g_refuse = true;
+  send(rid3, T_CAM, 1);
+  drain();
+  g_refuse = false;
+  ok = send(rid3, T_CAM, 1, &d1);
+  expect(!ok && d1 && g_queue.empty(), "retry after REFUSED replays the refusal");
+
+  // 4. без rid и после вытеснения
+  send(0, T_CAM, 1, &d1);
+  send(0, T_CAM, 1, &d2);
+  expect(!d1 && !d2 && g_queue.size() == 2, "no rid: every command is new");
+  drain();
+  for (int i = 0; i < CMDLOG_N; i++) send(0, T_RES, 0);
+  drain();
+  send(rid, T_CAM, 2, &d1);
+  expect(!d1 && g_queue.size() == 1, "rid evicted from the window is queued again");
+  drain();
+
+  printf("%lu commands, %lu replayed\n", (unsigned long)g_log.seq, (unsigned long)g_log.dups);
+  printf("%s\n", g_bad ? "FAIL" : "OK");
+  return g_bad ? 1 : 0;
+}
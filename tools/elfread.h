@@ -0,0 +1,112 @@
+#pragma once
+
+// Минимальное чтение ELF прошивки для хостовых утилит: функции из
+// .symtab (для символизации адресов) и данные загружаемых секций
+// (строки формата лога лежат во .flash.rodata). ELF32 и ELF64 —
+// последний для проверки утилит на самом хосте.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <elf.h>
+#include <cxxabi.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+struct ElfSym {
+  uint64_t addr;
+  uint64_t size;
+  std::string name;
+};
+
+struct ElfSec {
+  uint64_t addr;
+  uint64_t size;
+  uint64_t off;
+};
+
+struct ElfImage {
+  std::vector<uint8_t> f;
+  std::vector<ElfSec>  secs;     // SHF_ALLOC с данными в файле
+  std::vector<ElfSym>  syms;     // по возрастанию адреса
+};
+
+static inline std::string elfDemangle(const char* s) {
+  int st = 0;
+  char* d = abi::__cxa_demangle(s, nullptr, nullptr, &st);
+  std::string r = (st == 0 && d) ? d : s;
+  free(d);
+  size_t p = r.find('(');        // без списка параметров: короче и без ';'
+  if (p != std::string::npos && p > 0) r.resize(p);
+  std::replace(r.begin(), r.end(), ';', ':');
+  std::replace(r.begin(), r.end(), ' ', '_');
+  return r;
+}
+
+template <typename Ehdr, typename Shdr, typename Sym>
+static inline bool elfParse(ElfImage& e) {
+  const std::vector<uint8_t>& f = e.f;
+  const Ehdr* eh = (const Ehdr*)f.data();
+  if (eh->e_shoff == 0 || eh->e_shoff + (uint64_t)eh->e_shnum * sizeof(Shdr) > f.size()) return false;
+  const Shdr* sh = (const Shdr*)(f.data() + eh->e_shoff);
+
+  for (unsigned i = 0; i < eh->e_shnum; i++) {
+    if ((sh[i].sh_flags & SHF_ALLOC) && sh[i].sh_type == SHT_PROGBITS && sh[i].sh_offset + sh[i].sh_size <= f.size()) {
+      e.secs.push_back({(uint64_t)sh[i].sh_addr, (uint64_t)sh[i].sh_size, (uint64_t)sh[i].sh_offset});
+    }
+    if (sh[i].sh_type != SHT_SYMTAB || sh[i].sh_link >= eh->e_shnum) continue;
+    const Shdr& strs = sh[sh[i].sh_link];
+    if (sh[i].sh_offset + sh[i].sh_size > f.size() || strs.sh_offset + strs.sh_size > f.size()) return false;
+
+    const Sym* s = (const Sym*)(f.data() + sh[i].sh_offset);
+    size_t n = sh[i].sh_size / sizeof(Sym);
+    const char* names = (const char*)(f.data() + strs.sh_offset);
+    for (size_t k = 0; k < n; k++) {
+      if ((s[k].st_info & 0xF) != STT_FUNC || !s[k].st_value || s[k].st_name >= strs.sh_size) continue;
+      e.syms.push_back({(uint64_t)s[k].st_value, (uint64_t)s[k].st_size, elfDemangle(names + s[k].st_name)});
+    }
+  }
+  std::sort(e.syms.begin(), e.syms.end(), [](const ElfSym& a, const ElfSym& b) { return a.addr < b.addr; });
+  return true;
+}
+
+static inline bool elfLoad(ElfImage& e, const char* path) {
+  FILE* fp = fopen(path, "rb");
+  if (!fp) return false;
+  uint8_t b[65536];
+  size_t n;
+  while ((n = fread(b, 1, sizeof(b), fp)) > 0) e.f.insert(e.f.end(), b, b + n);
+  fclose(fp);
+
+  if (e.f.size() < sizeof(Elf64_Ehdr) || memcmp(e.f.data(), ELFMAG, SELFMAG)) return false;
+  if (e.f[EI_CLASS] == ELFCLASS32) return elfParse<Elf32_Ehdr, Elf32_Shdr, Elf32_Sym>(e);
+  if (e.f[EI_CLASS] == ELFCLASS64) return elfParse<Elf64_Ehdr, Elf64_Shdr, Elf64_Sym>(e);
+  return false;
+}
+
+// Имя функции по адресу; вне известных — "0x...".
+static inline std::string elfFunc(const ElfImage& e, uint64_t a) {
+  auto it = std::upper_bound(e.syms.begin(), e.syms.end(), a, [](uint64_t v, const ElfSym& s) { return v < s.addr; });
+  if (it != e.syms.begin()) {
+    const ElfSym& s = *(it - 1);
+    if (a < s.addr + (s.size ? s.size : 1)) return s.name;
+  }
+  char hex[24];
+  snprintf(hex, sizeof(hex), "0x%08llx", (unsigned long long)a);
+  return hex;
+}
+
+// Строка по адресу в загружаемой секции; nullptr — адрес не в образе
+// или строка не завершена внутри секции.
+static inline const char* elfStr(const ElfImage& e, uint64_t a) {
+  for (const ElfSec& s : e.secs) {
+    if (a < s.addr || a >= s.addr + s.size) continue;
+    const char* p = (const char*)e.f.data() + s.off + (a - s.addr);
+    if (!memchr(p, 0, s.addr + s.size - a)) return nullptr;
+    return p;
+  }
+  return nullptr;
+}
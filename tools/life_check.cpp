@@ -0,0 +1,102 @@
+// Счётчики наработки (include/life.h) на хосте.
+//
+// 1. Приращения: синтетическое движение (ходы туда-обратно разной длины
+//    и скорости, паузы, опрос раз в 1 мс) — шаги, смены направления и
+//    время в движении сходятся с заданными.
+// 2. Цена lifeTick() на проход.
+// 3. Период записи в NVS для разных размеров раздела и сроков службы:
+//    записей в сутки, стираний страницы за срок против LIFE_CYCLES.
+//
+//   g++ -O2 -Iinclude tools/life_check.cpp -o life_check && ./life_check
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <random>
+
+#include "life.h"
+
+static int checkCounts() {
+  std::mt19937 rng(7);
+  LifeData d;
+  lifeReset(d);
+  LifeTrack t = {};
+  int32_t pos = 0;
+  uint32_t now = 0;
+  uint64_t wantSteps = 0, wantRunMs = 0;
+  uint32_t wantRev = 0;
+  int lastDir = 0;
+  bool still = true;             // перед ходом была пауза
+
+  for (int move = 0; move < 2000; move++) {
+    int dir = (rng() & 1) ? 1 : -1;
+    if (rng() % 4 == 0) dir = lastDir ? lastDir : 1;      // и подряд в ту же сторону
+    uint32_t len = 1 + rng() % 50000;
+    uint32_t perMs = 1 + rng() % 400;                       // шагов за проход: до 400 кГц
+    if (lastDir && dir != lastDir) wantRev++;
+    lastDir = dir;
+
+    // проход, в котором ход начался после паузы, в движение не засчитывается
+    lifeTick(d.ax[0], t, pos, true, ++now);
+    if (!still) wantRunMs++;
+    uint32_t left = len;
+    while (left) {
+      uint32_t k = left < perMs ? left : perMs;
+      pos += dir * (int32_t)k;
+      left -= k;
+      lifeTick(d.ax[0], t, pos, true, ++now);
+      wantRunMs++;
+    }
+    wantSteps += len;
+    uint32_t dwell = rng() % 200;
+    still = dwell > 0;
+    for (uint32_t i = 0; i < dwell; i++) lifeTick(d.ax[0], t, pos, false, ++now);
+  }
+
+  const LifeAxis& a = d.ax[0];
+  bool ok = a.steps == wantSteps && a.reversals == wantRev && a.runMs == wantRunMs;
+  printf("counts: steps %llu/%llu reversals %lu/%lu run_ms %llu/%llu %s\n",
+         (unsigned long long)a.steps, (unsigned long long)wantSteps,
+         (unsigned long)a.reversals, (unsigned long)wantRev,
+         (unsigned long long)a.runMs, (unsigned long long)wantRunMs, ok ? "ok" : "MISMATCH");
+  return ok ? 0 : 1;
+}
+
+static void benchTick() {
+  LifeData d;
+  lifeReset(d);
+  LifeTrack t = {};
+  const int N = 20000000;
+  int32_t pos = 0;
+  auto t0 = std::chrono::steady_clock::now();
+  for (int i = 0; i < N; i++) {
+    pos += (i & 1023) < 900 ? 40 : 0;
+    lifeTick(d.ax[0], t, pos, (i & 1023) < 900, (uint32_t)i);
+  }
+  double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / N;
+  printf("lifeTick: %.2f ns/pass on host (steps %llu)\n", ns, (unsigned long long)d.ax[0].steps);
+}
+
+static void periods() {
+  size_t blob = sizeof(LifeData);
+  printf("blob %zu bytes = %zu NVS entries per write; cycles %d, margin %d\n",
+         blob, lifeEntriesPerWrite(blob), LIFE_CYCLES, LIFE_MARGIN);
+  printf("%8s %6s %9s %10s %14s\n", "nvs", "years", "period_s", "writes/day", "erases/page");
+  const size_t sizes[] = {0x3000, 0x5000, 0x6000, 0x10000};
+  for (size_t nvs : sizes) {
+    uint32_t p = lifeFlushPeriodS(nvs, blob);
+    size_t pages = nvs / LIFE_NVS_PAGE - 1;
+    double writes = LIFE_YEARS * 365.25 * 86400.0 / p;
+    double erases = writes * lifeEntriesPerWrite(blob) / (pages * LIFE_NVS_ENTRIES);
+    printf("%#8zx %6d %9lu %10.0f %14.0f%s\n", nvs, LIFE_YEARS, (unsigned long)p, 86400.0 / p, erases,
+           nvs == LIFE_NVS_BYTES ? "   <- partitions.csv" : "");
+  }
+}
+
+int main() {
+  int bad = checkCounts();
+  benchTick();
+  periods();
+  printf("%s\n", bad ? "FAIL" : "OK");
+  return bad;
+}
@@ -0,0 +1,146 @@
+// Проверка отложенного лога (include/dlog.h) на хосте: разбор записей
+// совпадает с printf того же формата; несколько потоков пишут
+// одновременно, один читает — ничего не теряется и не портится, пока
+// хватает места; цена вызова LOGI против snprintf той же строки.
+//
+//   g++ -O2 -pthread -Iinclude tools/log_bench.cpp -o log_bench
+//   ./log_bench [threads] [records_per_thread]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#define LOG_LEVEL LOG_L_INFO
+#include "dlog.h"
+
+static Dlog g_q;
+static std::atomic<uint32_t> g_clock(0);
+
+#define DLOG_Q     g_q
+#define DLOG_NOW() g_clock.fetch_add(1, std::memory_order_relaxed)
+
+// Запись из кольца -> строка формата и текст (на хосте адрес формата — указатель).
+static bool decode(const uint32_t* w, uint32_t words, const char** fmt, char* out, size_t outN) {
+  uint64_t f = 0;
+  for (uint32_t i = 0; i < DLOG_PTRW; i++) f |= (uint64_t)w[2 + i] << (32 * i);
+  *fmt = (const char*)(uintptr_t)f;
+  if (!*fmt) return false;
+  dlogFormat(*fmt, (const uint8_t*)(w + DLOG_HDRW), (words - DLOG_HDRW) * 4, sizeof(long), out, outN);
+  return true;
+}
+
+static int roundTrip() {
+  char expect[16][128];
+  int n = 0, bad = 0;
+#define CASE(fmt, ...) do { LOGI(fmt, __VA_ARGS__); snprintf(expect[n++], 128, fmt, __VA_ARGS__); } while (0)
+  CASE("HTTP 404 %s %s", "GET", "/favicon.png");
+  CASE("freq=%lu acc=%lu dir=%u", (unsigned long)40000, (unsigned long)200000, 1u);
+  CASE("pos=%ld err=%d", -123456789L, -7);
+  CASE("x=%08x y=%-6d|%5u", 0xBEEFu, 42, 7u);
+  CASE("t=%.3f v=%g", 1.25, -3.5e-4);
+  CASE("c=%c %% ll=%lld ull=%llu", 'Z', -9000000000LL, 18000000000ULL);
+  CASE("short %hu/%hhd", (unsigned short)65000, (signed char)-5);
+  CASE("saved in %lu us, seq %lu", (unsigned long)412, (unsigned long)77);
+#undef CASE
+
+  uint32_t w[DLOG_RECW];
+  char got[256];
+  for (int i = 0; i < n; i++) {
+    uint32_t words = dlogGet(g_q, w);
+    const char* fmt;
+    if (!words || !decode(w, words, &fmt, got, sizeof(got)) || strcmp(got, expect[i])) {
+      printf("  mismatch %d: '%s' vs '%s'\n", i, words ? got : "(none)", expect[i]);
+      bad++;
+    }
+  }
+  printf("round trip: %d formats, %d mismatches\n", n, bad);
+  return bad;
+}
+
+static const char* const STRESS_FMT = "thread %u seq %lu";
+
+static int stress(unsigned threads, unsigned long per) {
+  std::vector<unsigned long> next(threads, 0);
+  std::atomic<bool> done(false);
+  unsigned long got = 0, corrupt = 0, order = 0;
+
+  std::thread reader([&] {
+    uint32_t w[DLOG_RECW];
+    while (true) {
+      uint32_t words = dlogGet(g_q, w);
+      if (!words) {
+        if (done.load()) {
+          if (!dlogGet(g_q, w)) break;
+          continue;
+        }
+        std::this_thread::yield();
+        continue;
+      }
+      // аргументы прямо из записи: %u — 4 байта, %lu — sizeof(long)
+      uint64_t f = 0;
+      for (uint32_t i = 0; i < DLOG_PTRW; i++) f |= (uint64_t)w[2 + i] << (32 * i);
+      unsigned t = w[DLOG_HDRW];
+      unsigned long s = 0;
+      memcpy(&s, &w[DLOG_HDRW + 1], sizeof(s));
+      if ((const char*)(uintptr_t)f != STRESS_FMT || words != DLOG_HDRW + (4 + sizeof(long) + 3) / 4 || t >= threads) {
+        corrupt++;
+        continue;
+      }
+      if (s < next[t]) order++;
+      next[t] = s + 1;
+      got++;
+    }
+  });
+
+  std::vector<std::thread> ws;
+  for (unsigned t = 0; t < threads; t++) {
+    ws.emplace_back([t, per] {
+      for (unsigned long s = 0; s < per; s++) {
+        LOGI(STRESS_FMT, t, s);
+        if ((s & 31) == 31) std::this_thread::yield();
+      }
+    });
+  }
+  for (auto& th : ws) th.join();
+  done = true;
+  reader.join();
+
+  uint32_t drops = g_q.drops.load();
+  printf("stress: %u threads x %lu, read %lu, dropped %u, corrupt %lu, out of order %lu\n",
+         threads, per, got, drops, corrupt, order);
+  return (corrupt || order || got + drops != threads * per) ? 1 : 0;
+}
+
+int main(int argc, char** argv) {
+  unsigned threads = argc > 1 ? (unsigned)atoi(argv[1]) : 4;
+  unsigned long per = argc > 2 ? strtoul(argv[2], nullptr, 10) : 200000;
+
+  int bad = roundTrip();
+
+  // цена места вызова: LOGI против форматирования той же строки
+  const int N = 200000;
+  uint32_t w[DLOG_RECW];
+  char buf[128];
+  volatile size_t sink = 0;
+  auto t0 = std::chrono::steady_clock::now();
+  for (int i = 0; i < N; i++) {
+    LOGI("HTTP 404 %s %s freq=%lu pos=%ld", "GET", "/api/unknown", (unsigned long)i, (long)-i);
+    if ((i & 15) == 15) while (dlogGet(g_q, w)) {}
+  }
+  auto t1 = std::chrono::steady_clock::now();
+  for (int i = 0; i < N; i++) {
+    sink = sink + snprintf(buf, sizeof(buf), "HTTP 404 %s %s freq=%lu pos=%ld", "GET", "/api/unknown", (unsigned long)i, (long)-i);
+  }
+  auto t2 = std::chrono::steady_clock::now();
+  while (dlogGet(g_q, w)) {}
+  double nsLog = std::chrono::duration<double, std::nano>(t1 - t0).count() / N;
+  double nsFmt = std::chrono::duration<double, std::nano>(t2 - t1).count() / N;
+  printf("per call (host): LOGI %.0f ns incl. drain, snprintf %.0f ns (x%.1f)\n", nsLog, nsFmt, nsFmt / nsLog);
+
+  g_q.drops = 0;
+  bad += stress(threads, per);
+  printf("%s\n", bad ? "FAIL" : "OK");
+  return bad ? 1 : 0;
+}
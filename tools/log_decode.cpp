@@ -0,0 +1,101 @@
+// Приём и разбор отложенного лога устройства (include/dlog.h).
+// Подписка — любая датаграмма на LOG_PORT, повторяется каждые 2 с;
+// устройство шлёт записи на адрес последней подписки. Строки формата
+// берутся из ELF прошивки по адресу (id записи), аргументы
+// подставляются dlogFormat() — тем же кодом, что проверяет log_bench.
+//
+//   g++ -O2 -Iinclude -Itools tools/log_decode.cpp -o log_decode
+//   ./log_decode .pio/build/esp32dev/firmware.elf 192.168.1.50 [5006]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+
+#include "dlog.h"
+#include "elfread.h"
+
+static const uint32_t DEV_HDRW = 3;      // на ESP32 адрес формата — одно слово
+static const uint8_t  DEV_LONG = 4;
+
+static ElfImage g_elf;
+
+static void printRecord(const uint32_t* w, uint32_t words) {
+  static const char LV[] = "-EWID";
+  uint8_t level = (w[0] >> 16) & 0xFF;
+  uint32_t us = w[1];
+  const char* fmt = elfStr(g_elf, w[2]);
+
+  char text[512];
+  if (fmt) dlogFormat(fmt, (const uint8_t*)(w + DEV_HDRW), (words - DEV_HDRW) * 4, DEV_LONG, text, sizeof(text));
+  else snprintf(text, sizeof(text), "<format 0x%08x not in ELF>", w[2]);
+  printf("[%6u.%06u] %c %s\n", us / 1000000, us % 1000000, level < 5 ? LV[level] : '?', text);
+}
+
+int main(int argc, char** argv) {
+  if (argc < 3) {
+    fprintf(stderr, "usage: log_decode firmware.elf <device_ip> [port]\n");
+    return 2;
+  }
+  if (!elfLoad(g_elf, argv[1]) || g_elf.secs.empty()) {
+    fprintf(stderr, "%s: cannot read ELF\n", argv[1]);
+    return 1;
+  }
+
+  sockaddr_in dev = {};
+  dev.sin_family = AF_INET;
+  dev.sin_port = htons(argc > 3 ? atoi(argv[3]) : 5006);
+  if (inet_pton(AF_INET, argv[2], &dev.sin_addr) != 1) {
+    fprintf(stderr, "bad address %s\n", argv[2]);
+    return 1;
+  }
+
+  int s = socket(AF_INET, SOCK_DGRAM, 0);
+  timeval tv = {0, 200000};
+  setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+  uint8_t pkt[1500];
+  uint32_t words[1500 / 4];
+  bool haveSeq = false;
+  uint32_t lastSeq = 0, lastDrops = 0;
+  time_t lastSub = 0;
+
+  while (true) {
+    time_t now = time(nullptr);
+    if (now - lastSub >= 2) {
+      sendto(s, "DL", 2, 0, (sockaddr*)&dev, sizeof(dev));
+      lastSub = now;
+    }
+
+    ssize_t n = recv(s, pkt, sizeof(pkt), 0);
+    if (n < DLOG_PKT_HDR || pkt[0] != 'D' || pkt[1] != 'L' || pkt[2] != DLOG_VER) continue;
+
+    uint32_t seq, drops;
+    memcpy(&seq, pkt + 4, 4);
+    memcpy(&drops, pkt + 8, 4);
+    if (haveSeq && seq != lastSeq + 1) {
+      printf("--- %u packet(s) lost in transit\n", seq - lastSeq - 1);
+    }
+    if (drops != lastDrops) printf("--- %u record(s) dropped on device (buffer full)\n", drops - lastDrops);
+    haveSeq = true;
+    lastSeq = seq;
+    lastDrops = drops;
+
+    size_t len = (size_t)(n - DLOG_PKT_HDR) / 4;
+    memcpy(words, pkt + DLOG_PKT_HDR, len * 4);
+    for (size_t i = 0; i < len;) {
+      uint32_t rw = words[i] & 0xFFFF;
+      if (rw < DEV_HDRW || i + rw > len) {
+        printf("--- malformed record\n");
+        break;
+      }
+      printRecord(words + i, rw);
+      i += rw;
+    }
+    fflush(stdout);
+  }
+}
@@ -0,0 +1,132 @@
+// Long-poll /api/status на плате: пока запросы припаркованы, веб-задача
+// обслуживает остальных без задержки, а припаркованные отвечает сама
+// lpPoll() по своему таймауту, а не сервер по HTTP_MAX_CLOSE_WAIT (2 с).
+//
+// 1. Узнаёт текущее поколение, паркует `polls` запросов
+//    since=<gen>&timeout=<ms> (по умолчанию 3 шт. на 5000 мс — больше 2 с).
+// 2. Пока они висят, шлёт подряд простые GET /api/status и /api/life —
+//    каждый должен ответить 200 быстрее 300 мс.
+// 3. Каждый припаркованный должен получить 304 не раньше своего таймаута
+//    (или 200, если состояние за это время изменилось — станок лучше
+//    остановить, тогда проверяется именно таймаут).
+//
+//   g++ -O2 -pthread -Iinclude tools/lp_check.cpp -o lp_check
+//   ./lp_check <ip> [timeout_ms] [polls]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+static const char* g_ip;
+
+static double nowMs() {
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct Reply {
+  int code;           // 0 — нет соединения или ответа
+  double ms;
+  std::string body;
+};
+
+// GET и чтение до закрытия (сервер отвечает с Connection: close).
+static Reply get(const std::string& path, int waitS) {
+  Reply r = {0, 0, ""};
+  double t0 = nowMs();
+  int s = socket(AF_INET, SOCK_STREAM, 0);
+  if (s < 0) return r;
+  timeval tv = {waitS, 0};
+  setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+  sockaddr_in a;
+  memset(&a, 0, sizeof(a));
+  a.sin_family = AF_INET;
+  a.sin_port = htons(80);
+  inet_pton(AF_INET, g_ip, &a.sin_addr);
+  if (connect(s, (sockaddr*)&a, sizeof(a)) < 0) {
+    close(s);
+    return r;
+  }
+  std::string req = "GET " + path + " HTTP/1.1\r\nHost: " + g_ip + "\r\nConnection: close\r\n\r\n";
+  send(s, req.data(), req.size(), 0);
+  std::string resp;
+  char buf[1024];
+  ssize_t n;
+  while ((n = recv(s, buf, sizeof(buf), 0)) > 0) resp.append(buf, n);
+  close(s);
+  r.ms = nowMs() - t0;
+  if (resp.compare(0, 9, "HTTP/1.1 ") == 0) r.code = atoi(resp.c_str() + 9);
+  size_t b = resp.find("\r\n\r\n");
+  if (b != std::string::npos) r.body = resp.substr(b + 4);
+  return r;
+}
+
+static unsigned long genOf(const std::string& body) {
+  size_t p = body.find("\"gen\":");
+  return p == std::string::npos ? 0 : strtoul(body.c_str() + p + 6, nullptr, 10);
+}
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s <ip> [timeout_ms] [polls]\n", argv[0]);
+    return 2;
+  }
+  g_ip = argv[1];
+  int tmo = argc > 2 ? atoi(argv[2]) : 5000;
+  int polls = argc > 3 ? atoi(argv[3]) : 3;
+  int bad = 0;
+
+  Reply st = get("/api/status", 5);
+  if (st.code != 200) {
+    printf("no /api/status (code %d)\n", st.code);
+    return 1;
+  }
+  unsigned long gen = genOf(st.body);
+  printf("gen %lu, parking %d polls for %d ms\n", gen, polls, tmo);
+
+  std::vector<Reply> lp(polls);
+  std::vector<std::thread> th;
+  char path[96];
+  snprintf(path, sizeof(path), "/api/status?since=%lu&timeout=%d", gen, tmo);
+  for (int i = 0; i < polls; i++) {
+    th.emplace_back([&, i] { lp[i] = get(path, tmo / 1000 + 5); });
+  }
+  usleep(300 * 1000);
+
+  // остальные запросы, пока опросы висят
+  double maxMs = 0;
+  int n = 0;
+  double t0 = nowMs();
+  while (nowMs() - t0 < tmo - 500) {
+    Reply r = get(n & 1 ? "/api/life" : "/api/status", 5);
+    n++;
+    if (r.ms > maxMs) maxMs = r.ms;
+    if (r.code != 200) {
+      printf("  request %d while parked: code %d\n", n, r.code);
+      bad++;
+    }
+    usleep(50 * 1000);
+  }
+  bool fast = maxMs < 300;
+  printf("%d requests while parked, max %.0f ms (< 300) %s\n", n, maxMs, fast ? "ok" : "FAIL");
+  if (!fast) bad++;
+
+  for (std::thread& t : th) t.join();
+  for (int i = 0; i < polls; i++) {
+    const Reply& r = lp[i];
+    // 304 — ровно по своему таймауту; 200 — состояние изменилось раньше
+    bool ok = (r.code == 304 && r.ms >= tmo - 50 && r.ms <= tmo + 1000) || r.code == 200;
+    printf("poll %d: code %d after %.0f ms %s\n", i, r.code, r.ms, ok ? "ok" : "FAIL");
+    if (!ok) bad++;
+  }
+  printf("%s\n", bad ? "FAIL" : "OK");
+  return bad ? 1 : 0;
+}
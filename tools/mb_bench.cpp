@@ -0,0 +1,122 @@
+// Прогон ядра Modbus RTU (include/modbus.h) на хосте через пару псевдотерминалов:
+// поток-slave крутит mbProcess на одном конце, master на другом шлёт
+// чередующиеся FC03 (статус) и FC16 (FREQ) и меряет транзакции в секунду.
+//
+//   g++ -O2 -pthread -Iinclude tools/mb_bench.cpp -o mb_bench && ./mb_bench [N]
+
+#define _XOPEN_SOURCE 700
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "modbus.h"
+
+static const uint8_t SLAVE = 1;
+static const int GAP_MS = 1;   // пауза, после которой кадр считается законченным
+
+static RegMap g_regs;
+static uint32_t g_lastFreq;
+static volatile bool g_stop;
+
+static void applyStub(uint8_t op, uint32_t a, uint32_t) {
+  if (op == REG_OP_FREQ) g_lastFreq = a;
+}
+
+static void rawMode(int fd) {
+  struct termios t;
+  tcgetattr(fd, &t);
+  cfmakeraw(&t);
+  tcsetattr(fd, TCSANOW, &t);
+}
+
+// Чтение кадра до паузы GAP_MS (аналог таймаута приёма UART).
+static size_t readFrame(int fd, uint8_t* buf, size_t cap, int firstTimeoutMs) {
+  size_t n = 0;
+  struct pollfd p = {fd, POLLIN, 0};
+  int to = firstTimeoutMs;
+  while (n < cap && poll(&p, 1, to) > 0) {
+    ssize_t k = read(fd, buf + n, cap - n);
+    if (k <= 0) break;
+    n += (size_t)k;
+    to = GAP_MS;
+  }
+  return n;
+}
+
+static void* slaveThread(void* arg) {
+  int fd = *(int*)arg;
+  uint8_t q[MB_ADU_MAX], r[MB_ADU_MAX];
+  RegStatus st = {REG_ST_EN, 10000, 200000, 0};
+
+  while (!g_stop) {
+    size_t n = readFrame(fd, q, sizeof(q), 100);
+    if (!n) continue;
+    st.pos++;
+    size_t len = mbProcess(g_regs, st, SLAVE, q, n, r, applyStub);
+    if (len && write(fd, r, len) != (ssize_t)len) perror("slave write");
+  }
+  return nullptr;
+}
+
+static size_t buildRead(uint8_t* q, uint16_t a, uint16_t cnt) {
+  q[0] = SLAVE; q[1] = 0x04;
+  q[2] = a >> 8; q[3] = (uint8_t)a; q[4] = cnt >> 8; q[5] = (uint8_t)cnt;
+  return mbFinish(q, 6);
+}
+
+static size_t buildWriteFreq(uint8_t* q, uint32_t hz) {
+  q[0] = SLAVE; q[1] = 0x10;
+  q[2] = 0; q[3] = REG_FREQ; q[4] = 0; q[5] = 2; q[6] = 4;
+  q[7] = (uint8_t)(hz >> 8);  q[8] = (uint8_t)hz;
+  q[9] = (uint8_t)(hz >> 24); q[10] = (uint8_t)(hz >> 16);
+  return mbFinish(q, 11);
+}
+
+static double nowS() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main(int argc, char** argv) {
+  int n = argc > 1 ? atoi(argv[1]) : 2000;
+
+  int master = posix_openpt(O_RDWR | O_NOCTTY);
+  if (master < 0 || grantpt(master) || unlockpt(master)) { perror("pty"); return 1; }
+  int slave = open(ptsname(master), O_RDWR | O_NOCTTY);
+  if (slave < 0) { perror("pts"); return 1; }
+  rawMode(master);
+  rawMode(slave);
+
+  pthread_t th;
+  pthread_create(&th, nullptr, slaveThread, &slave);
+
+  uint8_t q[MB_ADU_MAX], r[MB_ADU_MAX];
+  int ok = 0, bad = 0;
+  double t0 = nowS();
+
+  for (int i = 0; i < n; i++) {
+    size_t len = (i & 1) ? buildWriteFreq(q, 1000 + i) : buildRead(q, REG_ST_FLAGS, 7);
+    if (write(master, q, len) != (ssize_t)len) { perror("write"); return 1; }
+
+    size_t got = readFrame(master, r, sizeof(r), 1000);
+    bool valid = got >= 5 && mbCrc(r, got - 2) == (uint16_t)(r[got - 2] | (r[got - 1] << 8)) &&
+                 r[1] == q[1];
+    if (valid && (i & 1) && g_lastFreq != (uint32_t)(1000 + i)) valid = false;
+    if (valid) ok++; else bad++;
+  }
+
+  double dt = nowS() - t0;
+  g_stop = true;
+  pthread_join(th, nullptr);
+
+  printf("transactions=%d ok=%d bad=%d time=%.3fs tps=%.0f (gap %d ms)\n",
+         n, ok, bad, dt, n / dt, GAP_MS);
+  return bad ? 1 : 0;
+}
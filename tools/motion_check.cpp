@@ -0,0 +1,227 @@
+// Проверка автомата движения (include/motion.h) на хосте.
+//
+// 1. Полный перебор: каждое состояние x каждое событие x все сочетания
+//    входов (запрос, en, авария, вращается, быстрее, ждёт направление,
+//    аргумент направления), из согласованных исходных. После события
+//    состояние обязано остаться согласованным, направление не меняется
+//    на ходу, вращать не велят без en или при аварии. Заодно — что
+//    каждая строка таблицы хоть раз сработала.
+// 2. Случайные последовательности с моделью двигателя (скорость тянется
+//    к заданной с ограниченным ускорением): те же свойства во времени,
+//    и после stop автомат за конечное время приходит в Idle (или
+//    Disabled/Fault, если они случились раньше).
+//
+//   g++ -O2 -Iinclude tools/motion_check.cpp -o motion_check && ./motion_check [steps]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <random>
+
+#include "motion.h"
+
+// ---- фиксация действий ----
+struct Log {
+  int run, stop, halt, setDir;
+  bool dirWhileMoving;
+};
+
+static Log g_log;
+static bool g_moving;          // модель: двигатель вращается
+static uint32_t g_clock;
+
+static void hRun()              { g_log.run++; }
+static void hStop()             { g_log.stop++; }
+static void hHalt()             { g_log.halt++; }
+static void hSetDir(uint8_t)    { g_log.setDir++; if (g_moving) g_log.dirWhileMoving = true; }
+static uint32_t hUs()           { return g_clock++; }
+
+static const MoHooks H = {hRun, hStop, hHalt, hSetDir, hUs};
+
+// Согласованность состояния со входами.
+static const char* consistent(const Motion& m) {
+  if ((m.state == MO_FAULT) != m.alarm) return "fault <-> alarm";
+  if (!m.alarm && (m.state == MO_DISABLED) != !m.en) return "disabled <-> !en";
+  if ((m.state == MO_ACCEL || m.state == MO_CRUISE) && !m.want) return "accel/cruise without request";
+  if ((m.state == MO_IDLE || m.state == MO_DISABLED || m.state == MO_FAULT) && m.want) return "request while stopped state";
+  return nullptr;
+}
+
+static int exhaustive() {
+  int bad = 0, cases = 0, transitions = 0;
+  static unsigned rowHits[MO_NROWS];
+  int matrix[MO_STATES][MO_EVENTS];
+  for (auto& r : matrix) for (int& x : r) x = -1;
+
+  for (int s = 0; s < MO_STATES; s++) {
+    for (int e = 0; e < MO_EVENTS; e++) {
+      for (int bits = 0; bits < 128; bits++) {
+        Motion m;
+        moInit(m, true, false, 0);
+        m.state   = (uint8_t)s;
+        m.want    = bits & 1;
+        m.en      = bits & 2;
+        m.alarm   = bits & 4;
+        m.moving  = bits & 8;
+        m.faster  = bits & 16;
+        m.dirNext = (bits & 32) ? 1 : 0;
+        uint32_t arg = (bits & 64) ? 1 : 0;
+        if (consistent(m)) continue;
+        // STOPPED приходит только от стоящего, AT_SPEED — от вращающегося
+        if (e == MO_EV_STOPPED && m.moving) continue;
+        if (e == MO_EV_AT_SPEED && !m.moving) continue;
+        if (e == MO_EV_STOPPED) g_moving = m.moving = false;
+        g_moving = m.moving;
+        cases++;
+
+        g_log = Log();
+        Motion before = m;
+        bool moved = moPost(m, (uint8_t)e, arg, H);
+        transitions += moved;
+        if (moved) {
+          for (size_t i = 0; i < MO_NROWS; i++) {
+            const MoRow& r = MO_ROWS[i];
+            if (r.from == s && r.ev == e && r.to == m.state) {
+              rowHits[i]++;
+              matrix[s][e] = r.to;
+              break;
+            }
+          }
+        }
+
+        const char* why = consistent(m);
+        if (!why && g_log.dirWhileMoving) why = "direction changed while moving";
+        if (!why && g_log.run && (!m.en || m.alarm)) why = "run without enable / in alarm";
+        if (!why && g_log.run && !(m.state == MO_ACCEL || (m.state == MO_DECEL && m.want))) why = "run outside accel";
+        if (!why && e == MO_EV_ALARM && s != MO_FAULT && !g_log.halt) why = "alarm without halt";
+        if (!why && e == MO_EV_DISABLE && s != MO_FAULT && s != MO_DISABLED && !g_log.halt) why = "disable without halt";
+        if (!why && m.dir != before.dir && before.moving) why = "dir applied while moving";
+        if (why) {
+          if (bad < 10) {
+            printf("  %s: %s + %s (want=%d en=%d alarm=%d moving=%d faster=%d dirNext=%d arg=%u) -> %s\n",
+                   why, moStateName(s), moEventName(e), before.want, before.en, before.alarm,
+                   before.moving, before.faster, before.dirNext, arg, moStateName(m.state));
+          }
+          bad++;
+        }
+      }
+    }
+  }
+
+  printf("exhaustive: %d cases, %d transitions, %d violations\n", cases, transitions, bad);
+  printf("%-9s", "");
+  for (int e = 0; e < MO_EVENTS; e++) printf(" %-8.8s", moEventName(e));
+  printf("\n");
+  for (int s = 0; s < MO_STATES; s++) {
+    printf("%-9s", moStateName(s));
+    for (int e = 0; e < MO_EVENTS; e++) printf(" %-8.8s", matrix[s][e] < 0 ? "." : moStateName(matrix[s][e]));
+    printf("\n");
+  }
+  for (size_t i = 0; i < MO_NROWS; i++) {
+    if (!rowHits[i]) {
+      printf("  dead row %zu: %s + %s\n", i, moStateName(MO_ROWS[i].from), moEventName(MO_ROWS[i].ev));
+      bad++;
+    }
+  }
+  return bad;
+}
+
+// ---- модель двигателя ----
+struct Motor {
+  int v, target;               // знаковая скорость, единицы модели
+  int freq;                    // заданная
+  uint8_t dirPin;
+};
+
+static Motor g_mot;
+static Motion* g_m;
+
+static void mRun()           { g_log.run++; g_mot.target = g_m->dir ? -g_mot.freq : g_mot.freq; }
+static void mStop()          { g_log.stop++; g_mot.target = 0; }
+static void mHalt()          { g_log.halt++; g_mot.target = 0; }
+static void mSetDir(uint8_t d) {
+  g_log.setDir++;
+  if (g_mot.v != 0) g_log.dirWhileMoving = true;
+  g_mot.dirPin = d;
+}
+
+static const MoHooks M = {mRun, mStop, mHalt, mSetDir, hUs};
+
+static int randomWalk(unsigned long steps) {
+  std::mt19937 rng(12345);
+  Motion m;
+  moInit(m, true, false, 0);
+  g_m = &m;
+  g_mot = {0, 0, 100, 0};
+  g_log = Log();
+  int bad = 0;
+  unsigned long stopAt = 0, stopWorst = 0, stops = 0;
+  unsigned long counts[MO_STATES][MO_STATES] = {};
+  uint32_t lastN = 0;
+
+  for (unsigned long t = 0; t < steps; t++) {
+    // команды
+    int r = rng() % 1000;
+    bool en = m.en, al = m.alarm;
+    if (r < 8)       moPost(m, MO_EV_START, 0, M);
+    else if (r < 14) { moPost(m, MO_EV_STOP, 0, M); if (!stopAt) stopAt = t + 1; }
+    else if (r < 20) { int f = 20 + rng() % 200; bool up = f > abs(g_mot.v); g_mot.freq = f; moPost(m, MO_EV_SPEED, up, M); }
+    else if (r < 24) moPost(m, MO_EV_DIR, rng() & 1, M);
+    else if (r < 26) moPost(m, en ? MO_EV_DISABLE : MO_EV_ENABLE, 0, M);
+    else if (r < 27) moPost(m, al ? MO_EV_CLEAR : MO_EV_ALARM, 0, M);
+    if (m.want) stopAt = 0;
+
+    // двигатель: без en или при аварии — только тормозит
+    int tgt = (m.en && !m.alarm) ? g_mot.target : 0;
+    if (g_mot.v < tgt) g_mot.v += std::min(3, tgt - g_mot.v);
+    if (g_mot.v > tgt) g_mot.v -= std::min(3, g_mot.v - tgt);
+    g_moving = g_mot.v != 0;
+    if (g_mot.target && g_mot.v && (g_mot.v < 0) != (g_mot.dirPin != 0)) {
+      // вращение против выставленного направления возможно только при торможении
+      if ((g_mot.target < 0) != (g_mot.dirPin != 0)) bad++;
+    }
+    int want = m.dir ? -g_mot.freq : g_mot.freq;
+    moFeed(m, g_moving, g_mot.v == want, M);
+
+    const char* why = consistent(m);
+    if (!why && g_log.dirWhileMoving) why = "direction changed while moving";
+    if (!why && m.state == MO_IDLE && stopAt && g_mot.target) why = "idle with motor commanded";
+    if (why) {
+      if (bad < 10) printf("  step %lu: %s in %s\n", t, why, moStateName(m.state));
+      bad++;
+      g_log.dirWhileMoving = false;
+    }
+
+    bool still = m.state == MO_IDLE || m.state == MO_DISABLED || m.state == MO_FAULT;
+    if (stopAt && still) {
+      unsigned long d = t + 1 - stopAt;
+      if (d > stopWorst) stopWorst = d;
+      stops++;
+      stopAt = 0;
+    }
+
+    for (; lastN < m.transitions; lastN++) {
+      const MoTrace& x = m.trace[lastN % MO_TRACE];
+      counts[x.from][x.to]++;
+    }
+  }
+
+  printf("random walk: %lu steps, %lu transitions, %lu ignored, %lu stops (worst %lu steps to still), %d violations\n",
+         steps, (unsigned long)m.transitions, (unsigned long)m.ignored, stops, stopWorst, bad);
+  printf("  transitions from -> to:\n");
+  for (int a = 0; a < MO_STATES; a++) {
+    for (int b = 0; b < MO_STATES; b++) {
+      if (counts[a][b]) printf("    %-8s -> %-8s %lu\n", moStateName(a), moStateName(b), counts[a][b]);
+    }
+  }
+  // торможение с макс. скорости 220 по 3 за шаг — не больше ~75 шагов
+  if (stopWorst > 100) bad++;
+  return bad;
+}
+
+int main(int argc, char** argv) {
+  unsigned long steps = argc > 1 ? strtoul(argv[1], nullptr, 10) : 2000000;
+  int bad = exhaustive();
+  bad += randomWalk(steps);
+  printf("%s\n", bad ? "FAIL" : "OK");
+  return bad ? 1 : 0;
+}
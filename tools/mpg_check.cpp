@@ -0,0 +1,162 @@
+// Проверка сглаживания маховичка (include/mpg.h) на хосте. Тик 1 мс,
+// как mpgTick в StepTask.
+//
+// 1. Ступенька: колесо разом накрутило d шагов. Выход приходит точно в
+//    цель, без перерегулирования, за время не дольше оптимального по
+//    ограничениям скорости и ускорения плюс пары тиков.
+// 2. Задержка: один отсчёт на стоящей оси — через сколько тиков
+//    сдвинется выход. Вместе с опросом PCNT (до 1 тика) и очередью FAS
+//    (~1 мс) — бюджет 5 мс; фильтр тут упирается в ускорение: первый шаг
+//    не раньше sqrt(1/a), поэтому бюджет выполняется при a >= ~100000
+//    шаг/с^2 (по умолчанию 200000), ниже — печатается для справки.
+// 3. Рампа: колесо крутится равномерно медленнее vmax — отставание
+//    выходит на постоянное ~v^2/2a и не растёт.
+// 4. Пределы масштаба: x100 и прокрут много быстрее vmax, туда и
+//    обратно — отставание не больше maxLag (на реверсе — плюс путь
+//    торможения с набранной скорости), скорость не больше vmax,
+//    после остановки колеса выход не проскакивает цель и встаёт точно.
+//
+//   g++ -O2 -Iinclude tools/mpg_check.cpp -o mpg_check && ./mpg_check
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "mpg.h"
+
+static const uint32_t TICK_US = 1000;
+static int g_bad;
+
+static MpgFilter make(int32_t scale, uint32_t vmax, uint32_t accel, int32_t maxLag) {
+  MpgFilter f = {scale, vmax, accel, maxLag, 0, 0, 0};
+  mpgReset(f, 0);
+  return f;
+}
+
+static void step() {
+  printf("step:\n%8s %8s %8s %8s %8s %9s %9s\n", "d", "vmax", "accel", "ticks", "best", "overshoot", "final");
+  const int32_t ds[] = {1, 10, 100, 2000, -1500};
+  const uint32_t accs[] = {10000, 200000, 2000000};
+  for (int32_t d : ds) {
+    for (uint32_t a : accs) {
+      MpgFilter f = make(1, 20000, a, 2000);
+      mpgFeed(f, d);
+      int ticks = 0;
+      int32_t over = 0;
+      while (ticks < 100000) {
+        mpgStep(f, TICK_US);
+        ticks++;
+        int32_t p = mpgPos(f);
+        int32_t o = d > 0 ? p - d : d - p;
+        if (o > over) over = o;
+        if (f.vel == 0 && p == d) break;
+      }
+      // оптимум: разгон-торможение, с полкой на vmax, если успевает
+      double ad = fabs((double)d);
+      double vp = sqrt(ad * a);
+      double best = vp <= f.vmax ? 2 * ad / vp : ad / f.vmax + (double)f.vmax / a;
+      double bestTicks = best * 1e6 / TICK_US;
+      bool ok = over == 0 && mpgPos(f) == d && ticks <= bestTicks * 1.05 + 3;
+      printf("%8ld %8lu %8lu %8d %8.1f %9ld %9ld %s\n", (long)d, (unsigned long)f.vmax, (unsigned long)a,
+             ticks, bestTicks, (long)over, (long)mpgPos(f), ok ? "ok" : "FAIL");
+      if (!ok) g_bad++;
+    }
+  }
+}
+
+static void latency() {
+  printf("latency (1 count, x1):\n%8s %12s %10s\n", "accel", "first_ticks", "budget_ms");
+  const uint32_t accs[] = {1000, 10000, 100000, 200000, 2000000};
+  for (uint32_t a : accs) {
+    MpgFilter f = make(1, 20000, a, 2000);
+    mpgFeed(f, 1);
+    int ticks = 0;
+    while (mpgPos(f) == 0 && ticks < 1000) {
+      mpgStep(f, TICK_US);
+      ticks++;
+    }
+    // опрос PCNT до 1 тика + фильтр + очередь FAS ~1 мс
+    int budget = 1 + ticks + 1;
+    bool inBudget = budget <= 5;
+    printf("%8lu %12d %10d %s\n", (unsigned long)a, ticks, budget,
+           inBudget ? "ok" : (a >= 100000 ? "FAIL" : "(accel-limited)"));
+    if (!inBudget && a >= 100000) g_bad++;
+  }
+}
+
+static void ramp() {
+  printf("ramp:\n%8s %8s %10s %10s %10s\n", "v", "accel", "lag", "lag_end", "bound");
+  const uint32_t vs[] = {100, 1000, 10000, 19000};
+  for (uint32_t v : vs) {
+    MpgFilter f = make(1, 20000, 200000, 4000);
+    double acc = 0;
+    int32_t lagMid = 0, lagEnd = 0;
+    const int TICKS = 4000;
+    for (int i = 0; i < TICKS; i++) {
+      acc += v * (TICK_US / 1e6);
+      int32_t c = (int32_t)acc;
+      acc -= c;
+      mpgFeed(f, c);
+      mpgStep(f, TICK_US);
+      int32_t lag = f.target - mpgPos(f);
+      if (i == TICKS / 2) lagMid = lag;
+      if (i == TICKS - 1) lagEnd = lag;
+    }
+    double bound = (double)v * v / (2.0 * f.accel) + v * TICK_US / 1e6 + 2;
+    bool ok = lagEnd <= bound && lagEnd <= lagMid + 1;
+    printf("%8lu %8lu %10ld %10ld %10.1f %s\n", (unsigned long)v, (unsigned long)f.accel,
+           (long)lagMid, (long)lagEnd, bound, ok ? "ok" : "FAIL");
+    if (!ok) g_bad++;
+  }
+}
+
+static void limits() {
+  printf("limits (x100, wheel far above vmax):\n");
+  const uint32_t vmaxs[] = {1000, 20000, 400000};
+  for (uint32_t vmax : vmaxs) {
+    MpgFilter f = make(100, vmax, 2000000, 2000);
+    int32_t maxLag = 0;
+    int64_t maxV = 0;
+    double lagBound = f.maxLag + 1;
+    int32_t over = 0;
+    // туда 300 мс по 50 отсчётов/мс, обратно 200 мс, стоп
+    for (int i = 0; i < 500; i++) {
+      mpgFeed(f, i < 300 ? 50 : -50);
+      mpgStep(f, TICK_US);
+      int32_t lag = f.target - mpgPos(f);
+      if (lag < 0) lag = -lag;
+      if (lag > maxLag) maxLag = lag;
+      int64_t v = (f.vel < 0 ? -f.vel : f.vel) >> 16;
+      if (v > maxV) maxV = v;
+      double brake = (double)v * v / (2.0 * f.accel) + v * TICK_US / 2e6;
+      if (f.maxLag + brake + 1 > lagBound) lagBound = f.maxLag + brake + 1;
+    }
+    int32_t stopTarget = f.target, stopPos = mpgPos(f);
+    int dir = stopTarget > stopPos ? 1 : -1;
+    int ticks = 0;
+    while ((f.vel != 0 || mpgPos(f) != f.target) && ticks < 100000) {
+      mpgStep(f, TICK_US);
+      ticks++;
+      int32_t o = dir > 0 ? mpgPos(f) - stopTarget : stopTarget - mpgPos(f);
+      if (o > over) over = o;
+      int64_t v = (f.vel < 0 ? -f.vel : f.vel) >> 16;
+      if (v > maxV) maxV = v;
+    }
+    int32_t travel = abs(mpgPos(f) - stopPos);
+    bool ok = maxLag <= lagBound && maxV <= (int64_t)vmax && over == 0 &&
+              mpgPos(f) == stopTarget && travel <= f.maxLag;
+    printf("  vmax %6lu: max_lag %ld (<= %.0f) max_v %lld overshoot %ld after_stop %ld in %d ticks %s\n",
+           (unsigned long)vmax, (long)maxLag, lagBound, (long long)maxV, (long)over,
+           (long)travel, ticks, ok ? "ok" : "FAIL");
+    if (!ok) g_bad++;
+  }
+}
+
+int main() {
+  step();
+  latency();
+  ramp();
+  limits();
+  printf("%s\n", g_bad ? "FAIL" : "OK");
+  return g_bad ? 1 : 0;
+}
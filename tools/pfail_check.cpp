@@ -0,0 +1,114 @@
+// Проверка лога аварийного сохранения (include/pfail.h) на хосте.
+// Два сектора моделируются с семантикой NOR-флеша (запись только
+// 1 -> 0, стирание в 0xFF). Цикл: загрузка (разбор, план, стирание,
+// отметка «применено»), затем авария — запись может оборваться на
+// любом байте. После каждой загрузки найденная запись должна совпасть
+// с последней дописанной целиком, а стирание — не трогать её.
+//
+//   g++ -O2 -Iinclude tools/pfail_check.cpp -o pfail_check
+//   ./pfail_check [cycles] [torn_percent]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+
+#include "pfail.h"
+
+static uint8_t g_flash[2][PF_SECTOR];
+static unsigned long g_erases[2];
+
+static void flashErase(uint8_t sec) {
+  memset(g_flash[sec], 0xFF, PF_SECTOR);
+  g_erases[sec]++;
+}
+
+// NOR: бит можно только сбросить. n < len — питание пропало посреди записи.
+static void flashWrite(uint8_t sec, size_t off, const void* data, size_t len, size_t n) {
+  const uint8_t* p = (const uint8_t*)data;
+  for (size_t i = 0; i < len && i < n; i++) g_flash[sec][off + i] &= p[i];
+}
+
+int main(int argc, char** argv) {
+  long cycles = argc > 1 ? atol(argv[1]) : 200000;
+  int tornPct = argc > 2 ? atoi(argv[2]) : 20;
+  srand(1);
+
+  flashErase(0);
+  flashErase(1);
+
+  bool have = false;
+  PfRecord good = {};            // последняя целиком записанная
+  long torn = 0, errors = 0, lost = 0;
+
+  for (long c = 0; c < cycles; c++) {
+    // ---- загрузка ----
+    PfSector s[2];
+    pfScan(g_flash[0], s[0]);
+    pfScan(g_flash[1], s[1]);
+    PfPlan p = {};
+    pfPlan(s, p);
+
+    if (have != p.found) {
+      lost++;
+    } else if (have) {
+      if (p.rec.seq != good.seq || p.rec.pos != good.pos || p.rec.freq != good.freq ||
+          p.rec.accel != good.accel || p.rec.dir != good.dir || p.rec.flags != good.flags) {
+        errors++;
+      }
+      // отметка «применено» — один байт, вне CRC
+      uint8_t z = 0;
+      flashWrite(p.recSec, p.recSlot * PF_REC + offsetof(PfRecord, used), &z, 1, 1);
+    }
+
+    if (p.erase) {
+      if (p.found && p.sec == p.recSec) errors++;    // стёрли бы последнюю запись
+      flashErase(p.sec);
+    }
+
+    // ---- авария ----
+    PfRecord r;
+    memset(&r, 0xFF, sizeof(r));
+    r.magic = PF_MAGIC;
+    r.seq = p.seq;
+    r.pos = (int32_t)(rand() * 2654435761u);
+    r.dir = rand() & 1;
+    r.flags = rand() & 7;
+    r.freq = rand() % 400000;
+    r.accel = rand() % 2000000;
+    r.sum = pfSum(r);
+
+    size_t off = (size_t)p.slot * PF_REC;
+    size_t body = offsetof(PfRecord, saveUs);
+    if (rand() % 100 < tornPct) {
+      flashWrite(p.sec, off, &r, body, rand() % body);
+      torn++;
+      // недописанные байты и так были 0xFF — запись на деле целая
+      if (!memcmp(&g_flash[p.sec][off], &r, body)) {
+        good = r;
+        have = true;
+      }
+    } else {
+      flashWrite(p.sec, off, &r, body, body);
+      uint32_t us = 100;
+      flashWrite(p.sec, off + body, &us, 4, 4);
+      good = r;
+      have = true;
+    }
+  }
+
+  // время подготовки записи (CRC) — основная работа процессора при аварии
+  PfRecord r = {};
+  r.magic = PF_MAGIC;
+  auto t0 = std::chrono::steady_clock::now();
+  volatile uint32_t sink = 0;
+  const int N = 1000000;
+  for (int i = 0; i < N; i++) { r.pos = i; sink = sink + pfSum(r); }
+  double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / N;
+
+  printf("cycles %ld, torn writes %ld, erases %lu/%lu\n", cycles, torn, g_erases[0], g_erases[1]);
+  printf("record mismatches %ld, lost records %ld\n", errors, lost);
+  printf("crc of record: %.0f ns (host)\n", ns);
+  bool ok = errors == 0 && lost == 0;
+  printf("%s\n", ok ? "OK" : "FAIL");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,87 @@
+// Символизация дампа профилировщика (prof dump / /api/prof/dump) по ELF
+// прошивки и свёртка в формат flamegraph.pl: "core0;Web;f1;f2;leaf N".
+// Символы — из .symtab (STT_FUNC), без внешних утилит. Адреса возврата
+// Xtensa несут инкремент окна в двух старших битах: восстанавливаем
+// 0x40000000 | (a & 0x3FFFFFFF) и отступаем на 3 байта, на сам call.
+//
+//   g++ -O2 -Itools tools/prof_fold.cpp -o prof_fold
+//   ./prof_fold .pio/build/esp32dev/firmware.elf dump.txt > prof.folded
+//   flamegraph.pl prof.folded > prof.svg
+//
+//   -n  адреса как есть (ELF не для Xtensa, проверка на хосте)
+//   -t  сводка по функциям (самостоятельное время) вместо свёртки
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <map>
+
+#include "elfread.h"
+
+static ElfImage g_elf;
+
+int main(int argc, char** argv) {
+  bool raw = false, top = false;
+  const char* args[2];
+  int na = 0;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "-n")) raw = true;
+    else if (!strcmp(argv[i], "-t")) top = true;
+    else if (na < 2) args[na++] = argv[i];
+  }
+  if (na < 1) {
+    fprintf(stderr, "usage: prof_fold [-n] [-t] firmware.elf [dump.txt]\n");
+    return 2;
+  }
+  if (!elfLoad(g_elf, args[0]) || g_elf.syms.empty()) {
+    fprintf(stderr, "%s: no function symbols\n", args[0]);
+    return 1;
+  }
+  FILE* in = na > 1 ? fopen(args[1], "r") : stdin;
+  if (!in) {
+    perror(args[1]);
+    return 1;
+  }
+
+  std::map<std::string, unsigned long> folded, self;
+  unsigned long total = 0, unknown = 0;
+  char line[512];
+  while (fgets(line, sizeof(line), in)) {
+    if (line[0] == '#') {
+      fputs(line, stderr);
+      continue;
+    }
+    unsigned core;
+    char task[32];
+    int off = 0;
+    if (sscanf(line, "%u %31s%n", &core, task, &off) != 2) continue;
+
+    std::vector<std::string> fr;
+    unsigned long long a;
+    int used = 0;
+    for (const char* p = line + off; sscanf(p, " %llx%n", &a, &used) == 1; p += used) {
+      if (!raw && !fr.empty()) a = ((a & 0x3FFFFFFFull) | 0x40000000ull) - 3;
+      fr.push_back(elfFunc(g_elf, a));
+      if (fr.back()[0] == '0') unknown++;
+    }
+    if (fr.empty()) fr.push_back("[" + std::string(task) + "]");
+
+    std::string k = "core" + std::to_string(core) + ";" + task;
+    for (auto it = fr.rbegin(); it != fr.rend(); ++it) k += ";" + *it;
+    folded[k]++;
+    self[fr.front()]++;
+    total++;
+  }
+
+  if (top) {
+    std::vector<std::pair<unsigned long, std::string>> v;
+    for (auto& e : self) v.push_back({e.second, e.first});
+    std::sort(v.rbegin(), v.rend());
+    for (auto& e : v) printf("%6.2f%% %8lu  %s\n", 100.0 * e.first / total, e.first, e.second.c_str());
+  } else {
+    for (auto& e : folded) printf("%s %lu\n", e.first.c_str(), e.second);
+  }
+  fprintf(stderr, "samples %lu, unresolved frames %lu, symbols %zu\n", total, unknown, g_elf.syms.size());
+  return 0;
+}
@@ -0,0 +1,219 @@
+// Шаги PVT-потока (include/pvt.h) на хосте: поток точек идёт через тот же
+// буфер и pvtGenSlice, что в StepTask, записи FAS разворачиваются в
+// моменты шагов (шаг — в конце своего периода, как отсчитывает очередь).
+//
+// 1. В момент каждой точки двигатель стоит ровно в её позиции (кроме
+//    точек ближе PVT_SLICE_MIN_US к предыдущей — их срез перешагивает).
+// 2. Между точками — от кривой Эрмита не дальше a * срез^2 / 8 + 2 шага,
+//    a — наибольшее ускорение самой кривой на отрезке (у кубики — на
+//    концах), 2 шага — округление концов среза и счёт шагов.
+// 3. Время не уплывает: конец каждого среза — в его время с точностью до
+//    недоданного остатка периода (< SC_GROUP_MAX тиков).
+// 4. Все записи годятся для очереди FAS: шагов не больше SC_GROUP_MAX,
+//    период не меньше SC_MIN_IVL, запись не короче SC_MIN_TICKS.
+// 5. Точки подаются порциями, как по UDP, с паузами — генератор ждёт
+//    (PVT_GEN_WAIT) и продолжает без сдвига; поток быстрее SC_MIN_IVL —
+//    PVT_GEN_FAST.
+//
+//   g++ -O2 -Iinclude tools/pvt_check.cpp -o pvt_check && ./pvt_check
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <algorithm>
+#include <vector>
+
+#include "pvt.h"
+
+static int g_bad;
+
+struct Step {
+  uint64_t tk;       // тики от начала потока
+  int32_t pos;       // позиция после шага
+};
+
+struct Profile {
+  const char* name;
+  std::vector<PvtPoint> pts;
+};
+
+// Наибольшее |p''| кубики Эрмита на отрезке a..b, шаг/с^2.
+static double hermiteAccel(const PvtPoint& a, const PvtPoint& b) {
+  double h = (b.t - a.t) * 1e-6;
+  if (h <= 0) return 0;
+  double dp = b.p - a.p;
+  double a0 = (6 * dp / h - 4 * a.v - 2 * b.v) / h;
+  double a1 = (-6 * dp / h + 2 * a.v + 4 * b.v) / h;
+  return fmax(fabs(a0), fabs(a1));
+}
+
+static Profile sine(const char* name, double amp, double hz, std::vector<uint32_t> ts) {
+  Profile pr = {name, {}};
+  for (uint32_t t : ts) {
+    double w = 2 * M_PI * hz, s = t * 1e-6;
+    pr.pts.push_back({t, (int32_t)lround(amp * sin(w * s)), (int32_t)lround(amp * w * cos(w * s))});
+  }
+  return pr;
+}
+
+static std::vector<uint32_t> grid(uint32_t dt, uint32_t total) {
+  std::vector<uint32_t> ts;
+  for (uint32_t t = 0; t <= total; t += dt) ts.push_back(t);
+  return ts;
+}
+
+// Трапеция: разгон до vmax, ход, торможение, стоянка; точки через dt.
+static Profile trapezoid(double dist, double vmax, double acc, uint32_t dt) {
+  Profile pr = {"trapezoid", {}};
+  double ta = vmax / acc, da = vmax * ta / 2;
+  double tc = (dist - 2 * da) / vmax, T = 2 * ta + tc;
+  for (uint32_t t = 0; t * 1e-6 <= T + 0.05; t += dt) {
+    double s = t * 1e-6, p, v;
+    if (s < ta) { p = acc * s * s / 2; v = acc * s; }
+    else if (s < ta + tc) { p = da + vmax * (s - ta); v = vmax; }
+    else if (s < T) { double r = T - s; p = dist - acc * r * r / 2; v = acc * r; }
+    else { p = dist; v = 0; }
+    pr.pts.push_back({t, (int32_t)lround(p), (int32_t)lround(v)});
+  }
+  return pr;
+}
+
+// Проход потока; точки подаются порциями по chunk через pause пустых проходов.
+static int run(const Profile& pr, int chunk, int pause, bool verbose) {
+  static PvtBuffer b;
+  b.head = b.tail = 0;
+  b.ended = false;
+  size_t fed = 0;
+  auto feed = [&](int n) {
+    while (n-- > 0 && fed < pr.pts.size() && pvtFree(b)) pvtPush(b, pr.pts[fed++]);
+    if (fed == pr.pts.size()) b.ended = true;
+  };
+  feed(chunk);
+
+  PvtGen g;
+  pvtGenStart(g, b);
+  int32_t p0 = pr.pts[0].p;
+  std::vector<Step> steps;
+  uint64_t tk = 0;                               // конец выданных записей
+  int32_t pos = p0;
+  uint32_t entries = 0, waits = 0, idle = 0;
+  int32_t entryBad = 0;
+  double maxDrift = 0;
+  int r;
+  while (true) {
+    r = pvtGenSlice(g, b);
+    if (r == PVT_GEN_WAIT) {
+      // следующая порция приходит через pause пустых проходов
+      waits++;
+      if (++idle >= (uint32_t)pause) {
+        feed(chunk);
+        idle = 0;
+      }
+      if (waits > 10000000) break;
+      continue;
+    }
+    if (r != PVT_GEN_SLICE) break;
+    for (uint8_t k = 0; k < g.n; k++) {
+      const PvtEntry& e = g.e[k];
+      entries++;
+      if (e.steps) {
+        if (e.steps > SC_GROUP_MAX || e.ticks < SC_MIN_IVL || (uint32_t)e.ticks * e.steps < SC_MIN_TICKS) entryBad++;
+        for (uint8_t s = 0; s < e.steps; s++) {
+          tk += e.ticks;
+          pos += e.up ? 1 : -1;
+          steps.push_back({tk, pos});
+        }
+      } else {
+        if (e.ticks < SC_MIN_TICKS) entryBad++;
+        tk += e.ticks;
+      }
+    }
+    double drift = fabs((double)tk - (double)g.t * PVT_TICKS_US);
+    if (drift > maxDrift) maxDrift = drift;
+  }
+
+  auto posAt = [&](uint64_t t) {
+    auto it = std::upper_bound(steps.begin(), steps.end(), t, [](uint64_t v, const Step& s) { return v < s.tk; });
+    return it == steps.begin() ? p0 : (it - 1)->pos;
+  };
+
+  // 1. в моменты точек
+  int32_t maxPt = 0;
+  uint32_t skipped = 0;
+  for (size_t i = 0; i < pr.pts.size(); i++) {
+    if (i && pr.pts[i].t - pr.pts[i - 1].t < PVT_SLICE_MIN_US) {
+      skipped++;
+      continue;
+    }
+    int32_t e = abs(posAt((uint64_t)pr.pts[i].t * PVT_TICKS_US) - pr.pts[i].p);
+    if (e > maxPt) maxPt = e;
+  }
+
+  // 2. между точками, каждые 20 мкс; срез перешагивает близкие точки,
+  // поэтому ускорение берётся по соседним отрезкам тоже
+  double maxCurve = 0, curveBound = 0, maxOver = -1e9;
+  double slice = (PVT_SLICE_US + PVT_SLICE_US / 2) * 1e-6;
+  for (size_t i = 0; i + 1 < pr.pts.size(); i++) {
+    double a = hermiteAccel(pr.pts[i], pr.pts[i + 1]);
+    if (i) a = fmax(a, hermiteAccel(pr.pts[i - 1], pr.pts[i]));
+    if (i + 2 < pr.pts.size()) a = fmax(a, hermiteAccel(pr.pts[i + 1], pr.pts[i + 2]));
+    double bound = a * slice * slice / 8 + 2;
+    for (uint32_t t = pr.pts[i].t; t < pr.pts[i + 1].t; t += 20) {
+      double e = fabs((double)posAt((uint64_t)t * PVT_TICKS_US) - pvtHermite(pr.pts[i], pr.pts[i + 1], t));
+      if (e > maxCurve) maxCurve = e;
+      if (e - bound > maxOver) {
+        maxOver = e - bound;
+        curveBound = bound;
+      }
+    }
+  }
+
+  bool ok = r == PVT_GEN_DONE && maxPt == 0 && maxOver < 0 && maxDrift < SC_GROUP_MAX && entryBad == 0 &&
+            pos == pr.pts.back().p;
+  if (verbose || !ok) {
+    printf("%-10s chunk %3d: pts %5zu (skipped %u) entries %6u waits %6u at_point %ld curve %.2f (tightest bound %.2f) drift %.0f tk %s\n",
+           pr.name, chunk, pr.pts.size(), skipped, entries, waits, (long)maxPt, maxCurve, curveBound, maxDrift,
+           ok ? "ok" : "FAIL");
+  }
+  if (!ok) g_bad++;
+  return r;
+}
+
+int main() {
+  std::vector<Profile> prs;
+  prs.push_back(sine("sine-5ms", 20000, 1, grid(5000, 2000000)));
+  prs.push_back(sine("sine-1ms", 4000, 5, grid(1000, 400000)));
+  prs.push_back(sine("sine-20ms", 30000, 0.5, grid(20000, 4000000)));
+  prs.push_back(trapezoid(50000, 20000, 200000, 2000));
+  prs.push_back(trapezoid(200000, 150000, 2000000, 3000));
+
+  // неравномерные, с точками ближе PVT_SLICE_MIN_US
+  srand(1);
+  std::vector<uint32_t> ts;
+  for (uint32_t t = 0; t < 1000000; t += 100 + rand() % 8000) ts.push_back(t);
+  prs.push_back(sine("irregular", 10000, 2, ts));
+
+  // стоянка: все точки в одной позиции
+  Profile hold = {"hold", {}};
+  for (uint32_t t = 0; t <= 100000; t += 4000) hold.pts.push_back({t, 123, 0});
+  prs.push_back(hold);
+
+  for (const Profile& pr : prs) {
+    run(pr, 250, 1, true);
+    run(pr, 3, 2, true);
+  }
+
+  // 5. быстрее SC_MIN_IVL (16 МГц / 40 = 400 кГц): 600 шагов за 1 мс
+  Profile fast = {"too-fast", {{0, 0, 600000}, {1000, 600, 600000}, {2000, 1200, 600000}}};
+  static PvtBuffer b;
+  for (const PvtPoint& p : fast.pts) pvtPush(b, p);
+  b.ended = true;
+  PvtGen g;
+  pvtGenStart(g, b);
+  int r = pvtGenSlice(g, b);
+  printf("too-fast (600 kHz): %s\n", r == PVT_GEN_FAST ? "PVT_GEN_FAST ok" : "FAIL");
+  if (r != PVT_GEN_FAST) g_bad++;
+
+  printf("%s\n", g_bad ? "FAIL" : "OK");
+  return g_bad ? 1 : 0;
+}
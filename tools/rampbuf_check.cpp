@@ -0,0 +1,99 @@
+// Пакетная генерация периодов (include/rampbuf.h) на хосте.
+//
+// 1. Общий набор rbCheck(): скалярное ядро и модель ядра PIE (по 8 слов,
+//    с насыщением вместо обрезки — вне rbFirst это разрешено) против
+//    скалярного слово в слово. Хэш — тот же, что печатает `rb` на плате:
+//    совпал — плата считает те же случаи и получает те же слова.
+// 2. Точность: масштабированная единичная таблица против точных
+//    периодов в double, от rbFirst.
+// 3. Скорость скалярного ядра на хосте (с автовекторизацией и без);
+//    скалярное против PIE на самой плате — `rb bench`.
+//
+//   g++ -O2 -Iinclude tools/rampbuf_check.cpp -o rampbuf_check && ./rampbuf_check
+
+#include <stdio.h>
+#include <math.h>
+#include <chrono>
+
+#include "rampbuf.h"
+
+static uint16_t s_buf[RB_CHECK_N] RB_ALIGNED, s_ref[RB_CHECK_N] RB_ALIGNED, s_out[RB_CHECK_N] RB_ALIGNED;
+
+// Как ee.vmul.u16 с SAR: блоками по RB_LANES, хвост не трогается.
+static void laneModel(uint16_t* out, const uint16_t* in, size_t n, RbScale s) {
+  for (size_t b = 0; b + RB_LANES <= n; b += RB_LANES) {
+    for (int l = 0; l < RB_LANES; l++) {
+      uint32_t v = rbWide(in[b + l], s);
+      out[b + l] = v > 0xFFFF ? 0xFFFF : (uint16_t)v;
+    }
+  }
+}
+
+__attribute__((optimize("no-tree-vectorize")))
+static void scalarNoVec(uint16_t* out, const uint16_t* in, size_t n, RbScale s) {
+  for (size_t i = 0; i < n; i++) out[i] = (uint16_t)rbWide(in[i], s);
+}
+
+static int check(const char* name, RbKernel k) {
+  RbResult r = rbCheck(k, s_buf, s_ref, s_out);
+  printf("%-10s cases %lu words %lu mismatches %lu hash %08lx\n", name,
+         (unsigned long)r.cases, (unsigned long)r.words, (unsigned long)r.mismatches, (unsigned long)r.hash);
+  return r.mismatches ? 1 : 0;
+}
+
+static int accuracy() {
+  const uint32_t acc[] = {100, 1000, 10000, 50000, 200000, 2000000};
+  const uint32_t e0s[] = {0, 1000, 100000};
+  int bad = 0;
+  printf("%8s %8s %6s %6s %6s %10s %9s\n", "accel", "e0", "mul", "sh", "first", "err_ticks", "err_rel");
+  for (uint32_t a : acc) {
+    RbScale s = rbScaleFor(a);
+    double k = RB_TICKS_S * sqrt(2.0 / a);
+    for (uint32_t e0 : e0s) {
+      rbUnitFill(s_buf, e0, RB_CHECK_N);
+      rbScaleC(s_out, s_buf, RB_CHECK_N, s);
+      size_t first = rbFirst(s_buf, RB_CHECK_N, s);
+      double errT = 0, errR = 0;
+      for (size_t i = first; i < RB_CHECK_N; i++) {
+        double e = (double)e0 + i;
+        double t = k / (sqrt(e + 1.0) + sqrt(e));
+        double d = fabs(s_out[i] - t);
+        errT = fmax(errT, d);
+        errR = fmax(errR, d / t);
+      }
+      // единица квантования u16 в таблице и в выходе — не больше 1%
+      // или пары тиков
+      if (first < RB_CHECK_N && errR > 0.01 && errT > 2.0) bad++;
+      printf("%8lu %8lu %6u %6u %6zu %10.2f %9.5f\n", (unsigned long)a, (unsigned long)e0,
+             (unsigned)s.mul, (unsigned)s.sh, first, errT, errR);
+    }
+  }
+  return bad;
+}
+
+static void bench(const char* name, RbKernel k) {
+  rbUnitFill(s_buf, 1000, RB_CHECK_N);
+  RbScale s = rbScaleFor(50000);
+  const int REPS = 200000;
+  volatile uint32_t sink = 0;
+  auto t0 = std::chrono::steady_clock::now();
+  for (int r = 0; r < REPS; r++) {
+    s.mul ^= (uint16_t)(r & 1);    // не даём вынести из цикла
+    k(s_out, s_buf, RB_CHECK_N, s);
+    sink = sink + s_out[r & (RB_CHECK_N - 1)];
+  }
+  double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() /
+              ((double)REPS * RB_CHECK_N);
+  printf("%-12s %.3f ns/word on host\n", name, ns);
+}
+
+int main() {
+  int bad = 0;
+  bad += check("scalar", rbScaleC);
+  bad += check("pie-model", laneModel);
+  bad += accuracy();
+  bench("scalar", rbScaleC);
+  bench("scalar-novec", scalarNoVec);
+  printf("%s\n", bad ? "FAIL" : "OK");
+  return bad ? 1 : 0;
+}
@@ -0,0 +1,96 @@
+// Проверка поиска резонансных полос (include/resscan.h) на хосте.
+// С файлом — разбор записанного прохода (вывод "res dump": строки hz,level);
+// без файла — синтетический проход: вибрация растёт со скоростью,
+// поверх — резонансы с известными частотами и шум. Проверяется, что
+// каждый резонанс попал в полосу, а лишних полос нет.
+//
+//   g++ -O2 -Iinclude tools/res_check.cpp -o res_check
+//   ./res_check [scan.csv]
+//   ./res_check -n <noise>      синтетика с заданным шумом (доля, по умолчанию 0.08 —
+//                               как у среднего по RES_FRAMES кадрам)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "resscan.h"
+
+static const ResParams PARAMS = {448, 20, 30};
+
+static double gauss() {
+  double u = (rand() + 1.0) / (RAND_MAX + 2.0), v = (rand() + 1.0) / (RAND_MAX + 2.0);
+  return sqrt(-2 * log(u)) * cos(2 * M_PI * v);
+}
+
+static void printBands(const ResBand* b, uint8_t n) {
+  printf("bands: %u\n", n);
+  for (uint8_t i = 0; i < n; i++) printf("  %lu..%lu Hz\n", (unsigned long)b[i].lo, (unsigned long)b[i].hi);
+}
+
+int main(int argc, char** argv) {
+  static ResPoint pts[RES_MAX_PTS];
+  ResBand bands[RES_MAX_BANDS];
+
+  double noise = 0.08;
+  if (argc > 2 && argv[1][0] == '-' && argv[1][1] == 'n') noise = atof(argv[2]);
+  else if (argc > 1) {
+    FILE* f = fopen(argv[1], "r");
+    if (!f) { perror(argv[1]); return 1; }
+    uint16_t n = 0;
+    unsigned long hz, lv;
+    char line[128];
+    while (n < RES_MAX_PTS && fgets(line, sizeof(line), f)) {
+      if (sscanf(line, "%lu,%lu", &hz, &lv) == 2) pts[n++] = {(uint32_t)hz, (uint32_t)lv};
+    }
+    fclose(f);
+    printBands(bands, resAnalyze(pts, n, PARAMS, bands));
+    return 0;
+  }
+
+  // резонансы: частота шагов, добротность, подъём над фоном
+  struct Res { double hz, q, gain; } res[] = {{1150, 12, 4}, {3300, 20, 3}, {7800, 8, 2.5}};
+  const int NR = sizeof(res) / sizeof(res[0]);
+  const double f0 = 200, f1 = 20000;
+  const uint16_t N = 96;
+
+  int missed = 0, extra = 0, runs = 200;
+  uint8_t lastN = 0;
+  for (int r = 0; r < runs; r++) {
+    srand(r + 1);
+    for (uint16_t i = 0; i < N; i++) {
+      double hz = f0 * pow(f1 / f0, (double)i / (N - 1));
+      double base = 40 + 60 * hz / f1;
+      double lv = base;
+      for (int k = 0; k < NR; k++) {
+        double x = (hz / res[k].hz - res[k].hz / hz) * res[k].q;
+        lv += base * (res[k].gain - 1) / (1 + x * x);
+      }
+      lv *= 1 + noise * gauss();
+      pts[i] = {(uint32_t)lrint(hz), (uint32_t)(lv < 0 ? 0 : lrint(lv))};
+    }
+
+    uint8_t n = resAnalyze(pts, N, PARAMS, bands);
+    lastN = n;
+    for (int k = 0; k < NR; k++) {
+      bool in = false;
+      for (uint8_t b = 0; b < n; b++) in |= res[k].hz >= bands[b].lo && res[k].hz <= bands[b].hi;
+      if (!in) missed++;
+    }
+    for (uint8_t b = 0; b < n; b++) {
+      bool near = false;
+      for (int k = 0; k < NR; k++) near |= res[k].hz >= bands[b].lo * 0.9 && res[k].hz <= bands[b].hi * 1.1;
+      if (!near) extra++;
+    }
+  }
+
+  printf("synthetic: %d runs, %d resonances each, noise %.0f%%\n", runs, NR, noise * 100);
+  printBands(bands, lastN);
+  for (int k = 0; k < NR; k++) {
+    uint32_t a = resAvoid(bands, lastN, (uint32_t)res[k].hz);
+    printf("  avoid %.0f -> %lu Hz\n", res[k].hz, (unsigned long)a);
+  }
+  printf("missed %d, extra bands %d\n", missed, extra);
+  bool ok = missed == 0 && extra <= runs / 20;
+  printf("%s\n", ok ? "OK" : "FAIL");
+  return ok ? 0 : 1;
+}
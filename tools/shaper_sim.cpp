@@ -0,0 +1,121 @@
+// Моделирование input shaping (include/shaper.h) на хосте: двигатель
+// ведёт груз через пружину (масса-пружина-демпфер). Профиль — разгон,
+// ход и торможение с одинаковым g_accel; сравниваются остаточная
+// вибрация после остановки и время успокоения для NONE/ZV/ZVD/EI.
+//
+// 1. Настроенный на резонанс ZV и ZVD оставляют меньше 5 % остаточной
+//    вибрации без формирования, EI — меньше 2 * SHAPE_EI_V (допуск EI
+//    плюс дискретность тика).
+// 2. Формированный ход успокаивается не позже несформированного.
+// 3. Остановка запаздывает не больше длины формирователя плюс тик.
+// 4. Резонанс ушёл на ±15 % от настройки: ZVD и EI — меньше 25 %.
+// Ошибка — FAIL и код 1.
+//
+//   g++ -O2 -Iinclude tools/shaper_sim.cpp -o shaper_sim
+//   ./shaper_sim [f_res_hz] [zeta] [freq_hz] [accel_hz_s]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "shaper.h"
+
+static const uint32_t TICK_US = 1000;
+static const double   SIM_DT  = 1e-5;
+
+struct Result {
+  double residual;   // шаги, пик |x - p| после остановки команды
+  double settle;     // с, до |x - p| < tol навсегда
+  double moveEnd;    // с, когда двигатель остановился
+};
+
+static Shaper g_sh;
+static int g_bad;
+
+// fcfg — на что настроен формирователь, fres — резонанс модели.
+static Result simulate(uint8_t type, double fcfg, double fres, double zeta, int32_t freq, uint32_t acc, double tol) {
+  shaperConfig(g_sh, type, (float)fcfg, (float)zeta, TICK_US);
+  shaperReset(g_sh, 0);
+
+  double wn = 2 * M_PI * fres;
+  double p = 0, x = 0, xv = 0;
+  int32_t vcmd = 0, vs = 0;
+
+  const double holdS = 0.2;
+  double tAccel = (double)freq / acc;
+  double tStop = tAccel + holdS;    // команда на торможение
+  double total = tStop + tAccel + 1.5;
+
+  Result r = {0, 0, 0};
+  bool stopped = false;
+  double lastBad = 0;
+  int ticksPerSim = (int)(TICK_US * 1e-6 / SIM_DT);
+
+  for (long i = 0; i * SIM_DT < total; i++) {
+    double t = i * SIM_DT;
+    if (i % ticksPerSim == 0) {
+      int32_t target = (t < tStop) ? freq : 0;
+      vcmd = shapeRamp(vcmd, target, acc, TICK_US);
+      vs = shaperPush(g_sh, vcmd);
+      if (!stopped && t > tStop && vs == 0) { stopped = true; r.moveEnd = t; }
+    }
+
+    p += vs * SIM_DT;
+    double a = wn * wn * (p - x) - 2 * zeta * wn * xv;
+    xv += a * SIM_DT;
+    x += xv * SIM_DT;
+
+    if (stopped) {
+      double e = fabs(x - p);
+      if (e > r.residual) r.residual = e;
+      if (e >= tol) lastBad = t;
+    }
+  }
+  r.settle = stopped ? (lastBad > r.moveEnd ? lastBad - r.moveEnd : 0) : -1;
+  return r;
+}
+
+int main(int argc, char** argv) {
+  double fres = argc > 1 ? atof(argv[1]) : 40;
+  double zeta = argc > 2 ? atof(argv[2]) : 0.05;
+  int32_t freq = argc > 3 ? atoi(argv[3]) : 20000;
+  uint32_t acc = argc > 4 ? (uint32_t)atoi(argv[4]) : 200000;
+  double tol = 1.0;
+
+  printf("resonance %.1f Hz zeta %.3f, move %d Hz @ %u Hz/s, settle tol %.1f step\n",
+         fres, zeta, freq, acc, tol);
+  printf("%-5s %12s %12s %12s\n", "type", "residual", "settle_ms", "stop_ms");
+
+  const char* names[] = {"none", "zv", "zvd", "ei"};
+  // длина формирователя в периодах затухающих колебаний
+  const double span[] = {0, 0.5, 1, 1};
+  double td = 1 / (fres * sqrt(1 - zeta * zeta));
+  Result r0 = {0, 0, 0};
+  for (uint8_t t = SHAPE_NONE; t <= SHAPE_EI; t++) {
+    Result r = simulate(t, fres, fres, zeta, freq, acc, tol);
+    if (t == SHAPE_NONE) r0 = r;
+    double lim = t == SHAPE_EI ? 2 * SHAPE_EI_V : 0.05;
+    bool ok = t == SHAPE_NONE ||
+              (r.residual < lim * r0.residual && r.settle >= 0 && r.settle <= r0.settle &&
+               r.moveEnd - r0.moveEnd <= span[t] * td + 2 * TICK_US * 1e-6);
+    printf("%-5s %12.2f %12.1f %12.1f %s\n", names[t], r.residual, r.settle * 1000, r.moveEnd * 1000,
+           t == SHAPE_NONE ? "" : ok ? "ok" : "FAIL");
+    if (!ok) g_bad++;
+  }
+
+  // 4. резонанс не там, где настроено
+  const double off[] = {0.85, 1.15};
+  for (double k : off) {
+    double f = fres * k;
+    Result n = simulate(SHAPE_NONE, fres, f, zeta, freq, acc, tol);
+    for (uint8_t t = SHAPE_ZVD; t <= SHAPE_EI; t++) {
+      Result r = simulate(t, fres, f, zeta, freq, acc, tol);
+      bool ok = r.residual < 0.25 * n.residual;
+      printf("%-5s at %.1f Hz: residual %.2f of %.2f %s\n", names[t], f, r.residual, n.residual, ok ? "ok" : "FAIL");
+      if (!ok) g_bad++;
+    }
+  }
+
+  printf("%s\n", g_bad ? "FAIL" : "OK");
+  return g_bad ? 1 : 0;
+}
@@ -0,0 +1,118 @@
+// Цена /api/status при многих опрашивающих (include/status.h): каждый
+// запрос кодирует JSON заново против общего кэша по поколению + ETag.
+// Время модельное (шаг 1 мс), N клиентов опрашивают каждые 500 мс со
+// сдвигом; меряется только работа обработчика на хосте. Сценарии: станок
+// стоит (раз в 5 с меняется счётчик АЦП) и станок едет
+// (позиция меняется каждую миллисекунду). Напоследок — перезагрузка: то же
+// состояние после загрузки с другим seed не должно дать старый ETag.
+//
+//   g++ -O2 -Iinclude tools/status_bench.cpp -o status_bench && ./status_bench
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <vector>
+
+#include "status.h"
+
+struct Machine {
+  bool running;
+  int32_t pos;
+  uint32_t ainSps;
+};
+
+static Machine g_m;
+static volatile size_t g_sink;
+
+static void take(StatusSnap& s) {
+  s.runReq = s.running = g_m.running;
+  s.freq = 40000;
+  s.acc = 200000;
+  s.en = 1;
+  s.mpgScale = 1;
+  s.ainSps = g_m.ainSps;
+  s.wifiMs = 812;
+  s.pos = g_m.pos;
+  s.pfSaveUs = 412;
+}
+
+struct Result {
+  double usPerReq;
+  unsigned long requests, encodes, bodies;
+  unsigned long long bytes;
+};
+
+// cached=false — как было: снимок и snprintf на каждый запрос.
+static Result run(int pollers, bool running, bool cached) {
+  const uint32_t SIM_MS = 60000, PERIOD_MS = 500;
+  StatusCache c;
+  memset(&c, 0, sizeof(c));
+  statusInit(c, 0);
+  std::vector<uint32_t> seen(pollers, 0);      // ETag, который клиент пришлёт
+  g_m = {running, 0, 1000};
+  Result r = {0, 0, 0, 0, 0};
+  double ns = 0;
+
+  for (uint32_t t = 0; t < SIM_MS; t++) {
+    if (running) g_m.pos += 40;
+    if (t % 5000 == 0) g_m.ainSps = 1000 + (t / 5000) % 3;
+
+    for (int p = 0; p < pollers; p++) {
+      if ((t + (uint32_t)p * PERIOD_MS / pollers) % PERIOD_MS) continue;
+      auto t0 = std::chrono::steady_clock::now();
+      size_t body;
+      if (cached) {
+        if (statusRefresh(c, t, take)) r.encodes++;
+        if (seen[p] == c.gen) {
+          body = 0;
+        } else {
+          seen[p] = c.gen;
+          body = c.len;
+          g_sink = g_sink + c.json[body / 2];
+        }
+      } else {
+        StatusSnap s;
+        memset(&s, 0, sizeof(s));
+        take(s);
+        char json[STATUS_JSON_MAX];
+        body = statusJson(s, r.encodes + 1, json, sizeof(json));
+        g_sink = g_sink + json[body / 2];
+        r.encodes++;
+      }
+      ns += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count();
+      r.requests++;
+      if (body) r.bodies++;
+      r.bytes += body;
+    }
+  }
+  r.usPerReq = ns / 1000.0 / r.requests;
+  return r;
+}
+
+int main() {
+  printf("%-8s %7s  %-9s %9s %8s %8s %10s %9s\n",
+         "machine", "pollers", "mode", "requests", "encodes", "bodies", "body_kB", "us/req");
+  for (int running = 0; running < 2; running++) {
+    for (int pollers : {1, 10, 50}) {
+      for (int cached = 0; cached < 2; cached++) {
+        Result r = run(pollers, running, cached);
+        printf("%-8s %7d  %-9s %9lu %8lu %8lu %10.1f %9.3f\n",
+               running ? "running" : "idle", pollers, cached ? "cached" : "per-req",
+               r.requests, r.encodes, r.bodies, r.bytes / 1024.0, r.usPerReq);
+      }
+    }
+  }
+
+  // тот же снимок до и после перезагрузки
+  StatusCache a, b;
+  memset(&a, 0, sizeof(a));
+  memset(&b, 0, sizeof(b));
+  g_m = {false, 0, 1000};
+  statusInit(a, 0x1234567u);
+  statusRefresh(a, 0, take);
+  statusInit(b, 0x89abcdefu);
+  statusRefresh(b, 0, take);
+  bool ok = strcmp(a.etag, b.etag) != 0 && a.gen != b.gen;
+  printf("reboot: etag %s -> %s %s\n", a.etag, b.etag, ok ? "ok" : "FAIL");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,121 @@
+// Бенчмарк сжатия шагов (include/stepcomp.h): трапеция и синусоида,
+// степень сжатия, максимальная ошибка времени шага после обратного
+// разворачивания, скорость компрессора и разворачивания в записи FAS
+// (тот же код, что крутится в StepTask).
+//
+// 1. Ни один шаг после разворачивания не дальше tol тиков от исходного.
+// 2. Разворачивание в записи FAS даёт ровно столько же шагов.
+// 3. Команды короче сырых u32-времён; при tol от 16 тиков — не меньше
+//    min шагов на команду для профиля.
+// Ошибка — FAIL и код 1.
+//
+//   g++ -O2 -Iinclude tools/stepcomp_bench.cpp -o stepcomp_bench
+//   ./stepcomp_bench [tol_ticks]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include <vector>
+
+#include "stepcomp.h"
+
+static const double TPS = 16e6;
+static const uint32_t TOL_RATIO = 16;   // с этого допуска проверяется min
+
+static int g_bad;
+
+static double nowS() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Трапеция: разгон accel до vmax, ход, торможение; всего steps шагов.
+static std::vector<uint64_t> trapezoid(uint32_t steps, double vmax, double accel) {
+  std::vector<uint64_t> t;
+  double da = vmax * vmax / (2 * accel);
+  if (2 * da > steps) da = steps / 2.0;
+  double ta = sqrt(2 * da / accel), vpk = accel * ta;
+  double tc = (steps - 2 * da) / vpk;
+  for (uint32_t k = 1; k <= steps; k++) {
+    double s;
+    if (k <= da) s = sqrt(2 * k / accel);
+    else if (k <= steps - da) s = ta + (k - da) / vpk;
+    else s = ta + tc + ta - sqrt(2 * (steps - k) / accel);
+    t.push_back((uint64_t)(s * TPS + 0.5) + 4000);
+  }
+  return t;
+}
+
+// Синусоидальная скорость: v = v0 * (1.5 + sin(2*pi*f*t)) / 2.5
+static std::vector<uint64_t> sine(uint32_t steps, double v0, double f) {
+  std::vector<uint64_t> t;
+  double s = 0, pos = 0, dt = 1e-7;
+  for (uint32_t k = 1; k <= steps; k++) {
+    while (pos < k) { pos += v0 * (1.5 + sin(2 * M_PI * f * s)) / 2.5 * dt; s += dt; }
+    t.push_back((uint64_t)(s * TPS + 0.5) + 4000);
+  }
+  return t;
+}
+
+static void bench(const char* name, const std::vector<uint64_t>& t, uint32_t tol, double minRatio) {
+  std::vector<StepCmd> out(t.size());
+
+  double t0 = nowS();
+  size_t m = scCompress(t.data(), t.size(), 0, 1, tol, out.data(), out.size());
+  double tc = nowS() - t0;
+  if (!m) {
+    printf("%-10s compress failed FAIL\n", name);
+    g_bad++;
+    return;
+  }
+
+  // обратное разворачивание по шагам и сравнение времён
+  int64_t base = 0, maxErr = 0;
+  size_t k = 0;
+  for (size_t i = 0; i < m; i++) {
+    int64_t ivl = out[i].interval;
+    for (uint16_t j = 0; j < out[i].count; j++, k++) {
+      base += ivl;
+      ivl += out[i].add;
+      int64_t e = llabs(base - (int64_t)t[k]);
+      if (e > maxErr) maxErr = e;
+    }
+  }
+
+  // разворачивание в записи очереди FAS, как на устройстве
+  static StepCmdBuffer b;
+  size_t groups = 0, steps = 0, pushed = 0;
+  StepIter it = {};
+  double t1 = nowS();
+  b.head = b.tail = 0;
+  while (pushed < m || scLevel(b) || it.left) {
+    while (pushed < m && scPush(b, out[pushed])) pushed++;
+    uint16_t ticks; uint8_t n, dir;
+    if (!scNextGroup(it, b, ticks, n, dir)) break;
+    groups++;
+    steps += n;
+  }
+  double te = nowS() - t1;
+
+  double ratio = (double)t.size() / m;
+  bool ok = maxErr <= (int64_t)tol && steps == t.size() && m * SC_CMD_BYTES < t.size() * 4 &&
+            (tol < TOL_RATIO || ratio >= minRatio);
+  printf("%-10s steps=%zu cmds=%zu ratio=%.1f steps/cmd (min %.0f) bytes=%.2f%% of raw u32 "
+         "maxErr=%lld ticks compress=%.1f Msteps/s expand=%.2f Mcmds/s groups=%zu %s\n",
+         name, t.size(), m, ratio, minRatio, 100.0 * m * SC_CMD_BYTES / (t.size() * 4.0),
+         (long long)maxErr, t.size() / tc / 1e6, m / te / 1e6, groups, ok ? "ok" : "FAIL");
+  if (steps != t.size()) printf("  expand mismatch: %zu steps\n", steps);
+  if (!ok) g_bad++;
+}
+
+int main(int argc, char** argv) {
+  uint32_t tol = argc > 1 ? (uint32_t)atoi(argv[1]) : 16;
+  printf("tolerance %u ticks (%.2f us)\n", tol, tol / 16.0);
+  bench("trap-50k", trapezoid(200000, 50000, 200000), tol, 8);
+  bench("trap-300k", trapezoid(1000000, 300000, 2000000), tol, 5);
+  bench("sine", sine(200000, 40000, 5), tol, 6);
+  printf("%s\n", g_bad ? "FAIL" : "OK");
+  return g_bad ? 1 : 0;
+}
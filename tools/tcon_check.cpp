@@ -0,0 +1,169 @@
+// Проверка консоли по TCP (include/tcpcon.h) на loopback: сервер в своём
+// потоке крутит tconPoll, как TconTask на устройстве. Несколько клиентов
+// одновременно получают ответы на свои команды по порядку; клиент,
+// который шлёт команды с большим выводом и ничего не читает, не
+// задерживает остальных и через TCON_STALL_MS закрывается; сессия сверх
+// TCON_MAX получает "busy".
+//
+//   g++ -O2 -pthread -Iinclude tools/tcon_check.cpp -o tcon_check && ./tcon_check
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define TCON_OUT      1024
+#define TCON_STALL_MS 500
+#include "tcpcon.h"
+
+static Tcon g_t;
+static std::atomic<bool> g_stop(false);
+
+static uint32_t nowMs() {
+  return (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void server() {
+  while (!g_stop) {
+    tconPoll(g_t, nowMs(), [](TconSession& s, char* line) {
+      if (!line) { tconPuts(s, "hello\n"); return; }
+      if (!strcmp(line, "big")) {
+        std::string b(4000, 'x');
+        b += '\n';
+        tconPut(s, b.data(), b.size());
+        return;
+      }
+      char r[TCON_LINE + 8];
+      snprintf(r, sizeof(r), "ok %s\n", line);
+      tconPuts(s, r);
+    });
+    usleep(1000);
+  }
+}
+
+static int dial(uint16_t port, int rcvbuf = 0) {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (rcvbuf) setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+  sockaddr_in a = {};
+  a.sin_family = AF_INET;
+  a.sin_port = htons(port);
+  a.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (connect(fd, (sockaddr*)&a, sizeof(a)) < 0) {
+    close(fd);
+    return -1;
+  }
+  timeval tv = {2, 0};
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+  return fd;
+}
+
+// Строка без CRLF; false — таймаут или закрыто.
+static bool readLine(int fd, std::string& l) {
+  l.clear();
+  char c;
+  while (recv(fd, &c, 1, 0) == 1) {
+    if (c == '\n') return true;
+    if (c != '\r') l += c;
+  }
+  return false;
+}
+
+// n команд по одной, ответ — по порядку; худшая задержка, мс.
+static double roundTrips(uint16_t port, int id, int n, int* bad) {
+  int fd = dial(port);
+  std::string l;
+  if (fd < 0 || !readLine(fd, l) || l != "hello") {
+    (*bad)++;
+    if (fd >= 0) close(fd);
+    return 0;
+  }
+  double worst = 0;
+  for (int i = 0; i < n; i++) {
+    char q[32];
+    int k = snprintf(q, sizeof(q), "c%d %d\n", id, i);
+    auto t0 = std::chrono::steady_clock::now();
+    send(fd, q, k, 0);
+    q[k - 1] = 0;
+    if (!readLine(fd, l) || l != std::string("ok ") + q) {
+      (*bad)++;
+      break;
+    }
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    if (ms > worst) worst = ms;
+  }
+  close(fd);
+  return worst;
+}
+
+int main() {
+  if (!tconBegin(g_t, 0)) {
+    perror("tconBegin");
+    return 1;
+  }
+  sockaddr_in a = {};
+  socklen_t al = sizeof(a);
+  getsockname(g_t.lfd, (sockaddr*)&a, &al);
+  uint16_t port = ntohs(a.sin_port);
+  std::thread srv(server);
+  int bad = 0;
+
+  // 1. TCON_MAX клиентов одновременно
+  {
+    std::vector<std::thread> cs;
+    std::vector<double> worst(TCON_MAX);
+    for (int i = 0; i < TCON_MAX; i++) cs.emplace_back([&, i] { worst[i] = roundTrips(port, i, 300, &bad); });
+    for (auto& c : cs) c.join();
+    double w = 0;
+    for (double x : worst) w = x > w ? x : w;
+    printf("parallel: %d sessions x 300 commands, worst %.1f ms, errors %d\n", TCON_MAX, w, bad);
+  }
+  while (tconCount(g_t)) usleep(1000);
+
+  // 2. клиент не читает: шлёт команды с выводом больше кольца
+  {
+    uint32_t t0 = nowMs();
+    int st = dial(port, 2048);
+    std::string cmds;
+    for (int i = 0; i < 8000; i++) cmds += "big\n";
+    send(st, cmds.data(), cmds.size(), MSG_DONTWAIT);
+    usleep(50000);
+
+    int b0 = bad;
+    double w = roundTrips(port, 9, 300, &bad);
+    printf("beside a stalled session: 300 commands, worst %.1f ms, errors %d\n", w, bad - b0);
+    if (w > 100) bad++;
+
+    while (g_t.kicked == 0 && nowMs() - t0 < 20 * TCON_STALL_MS) usleep(10000);
+    printf("stalled session closed %lu ms after connect (stall limit %d), output dropped %lu bytes\n",
+           (unsigned long)(nowMs() - t0), TCON_STALL_MS, (unsigned long)g_t.lost);
+    if (g_t.kicked != 1) bad++;
+    close(st);
+  }
+
+  // 3. сессия сверх TCON_MAX
+  {
+    std::vector<int> hold;
+    std::string l;
+    for (int i = 0; i < TCON_MAX; i++) {
+      hold.push_back(dial(port));
+      readLine(hold.back(), l);
+    }
+    int x = dial(port);
+    bool busy = readLine(x, l) && l == "busy";
+    printf("session %d: %s\n", TCON_MAX + 1, busy ? "busy" : l.c_str());
+    if (!busy) bad++;
+    close(x);
+    for (int fd : hold) close(fd);
+  }
+
+  g_stop = true;
+  srv.join();
+  printf("accepted %lu rejected %lu kicked %lu\n%s\n",
+         (unsigned long)g_t.accepted, (unsigned long)g_t.rejected, (unsigned long)g_t.kicked, bad ? "FAIL" : "OK");
+  return bad ? 1 : 0;
+}
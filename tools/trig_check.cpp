@@ -0,0 +1,129 @@
+// Проверка генератора рампы старта по фронту (include/trig.h) на хосте.
+//
+// Для набора (скорость, ускорение): разгон с нуля, ход, затем stop —
+// записи очереди {ticks, steps} разворачиваются во времена шагов (шаг —
+// в начале своего периода, как в очереди FAS; первый — в момент запуска)
+// и сравниваются с точным профилем, посчитанным по шагу в double.
+// Проверяется: число шагов совпадает, записи в пределах очереди FAS
+// (шагов 0..SC_GROUP_MAX, 0 — пауза; период >= SC_MIN_IVL, запись не
+// короче SC_MIN_TICKS, кроме последней), ошибка времени шага мала. Заодно —
+// сколько движения покрывают TRIG_PRIME + 1 записей, заготовленных до
+// фронта, и сколько стоит их расчёт.
+//
+//   g++ -O2 -Iinclude tools/trig_check.cpp -o trig_check && ./trig_check
+
+#include <stdio.h>
+#include <math.h>
+#include <chrono>
+#include <vector>
+
+#include "trig.h"
+
+// Точный профиль: время каждого шага, тики, по той же модели e = v^2/2a;
+// первый шаг — в 0.
+static std::vector<double> exact(uint32_t hz, uint32_t accel, uint32_t cruiseSteps) {
+  std::vector<double> t(1, 0.0);
+  double a = accel, eT = (double)hz * hz / (2.0 * a), k = TRIG_TICKS_S * sqrt(2.0 / a);
+  double now = 0;
+  uint32_t e = 0;
+  while (e + 1.0 <= eT) { now += k * (sqrt(e + 1.0) - sqrt((double)e)); e++; t.push_back(now); }
+  for (uint32_t i = 0; i < cruiseSteps; i++) { now += TRIG_TICKS_S / hz; t.push_back(now); }
+  while (e) { now += k * (sqrt((double)e) - sqrt(e - 1.0)); e--; t.push_back(now); }
+  t.pop_back();            // после последнего периода шага уже нет
+  return t;
+}
+
+struct Case {
+  uint32_t hz, accel;
+};
+
+int main() {
+  const Case cases[] = {
+    {1000, 2000},  {5000, 20000},  {10000, 200000}, {40000, 200000},
+    {100000, 500000}, {250000, 2000000}, {400000, 2000000}, {400000, 50000},
+  };
+  const uint32_t CRUISE = 20000;
+  int bad = 0;
+
+  printf("%8s %8s %8s %7s %6s %9s %6s %9s %10s %9s\n",
+         "hz", "accel", "steps", "entries", "pauses", "err_us", "short", "prime_ms", "prime_us", "fill_ns");
+
+  for (const Case& c : cases) {
+    size_t accelSteps = exact(c.hz, c.accel, 0).size() / 2;
+
+    TrigRamp r;
+    trigRampInit(r, c.hz, c.accel);
+    std::vector<double> t;
+    double now = 0, maxErr = 0, primeTicks = 0;
+    uint32_t entries = 0, pauses = 0, shortEntries = 0, viol = 0;
+    bool stopped = false;
+    size_t cruise = 0;
+    uint16_t ticks;
+    uint8_t steps;
+
+    while (true) {
+      // stop — когда отработано не меньше CRUISE шагов хода
+      if (!stopped && t.size() >= accelSteps + CRUISE) {
+        cruise = t.size() - accelSteps;
+        trigRampTarget(r, 0);
+        stopped = true;
+      }
+      if (!trigRampNext(r, ticks, steps)) break;
+      entries++;
+      if (steps > SC_GROUP_MAX || ticks < SC_MIN_IVL) viol++;
+      if ((uint32_t)ticks * (steps ? steps : 1) < SC_MIN_TICKS) shortEntries++;
+      if (!steps) {
+        pauses++;
+        now += ticks;
+      }
+      for (uint8_t i = 0; i < steps; i++) {
+        t.push_back(now);
+        now += ticks;
+      }
+      if (entries == TRIG_PRIME + 1) primeTicks = now;
+    }
+    std::vector<double> ref = exact(c.hz, c.accel, (uint32_t)cruise);
+
+    if (t.size() != ref.size()) {
+      printf("  %lu Hz: %zu steps, expected %zu\n", (unsigned long)c.hz, t.size(), ref.size());
+      bad++;
+    } else {
+      for (size_t i = 0; i < t.size(); i++) maxErr = fmax(maxErr, fabs(t[i] - ref[i]));
+    }
+    // короче SC_MIN_TICKS допустима только последняя запись
+    if (shortEntries > 1 || viol) bad++;
+    double errUs = maxErr / 16.0;
+    // ошибка времени шага — в пределах одного периода шага на ходу и 50 мкс
+    if (errUs > 50 && errUs > 1e6 / c.hz) bad++;
+
+    // цена заготовки до фронта
+    auto t0 = std::chrono::steady_clock::now();
+    const int REPS = 10000;
+    volatile uint32_t sink = 0;
+    for (int k = 0; k < REPS; k++) {
+      TrigRamp p;
+      trigRampInit(p, c.hz, c.accel);
+      for (int i = 0; i <= TRIG_PRIME; i++) {
+        if (trigRampNext(p, ticks, steps)) sink = sink + ticks;
+      }
+    }
+    double primeUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count() / REPS;
+
+    // доливка на ходу: нс на запись
+    TrigRamp f;
+    trigRampInit(f, c.hz, c.accel);
+    t0 = std::chrono::steady_clock::now();
+    const int N = 200000;
+    for (int i = 0; i < N; i++) {
+      if (trigRampNext(f, ticks, steps)) sink = sink + ticks;
+    }
+    double fillNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / N;
+
+    printf("%8lu %8lu %8zu %7lu %6lu %9.2f %6lu %9.2f %10.3f %9.1f\n",
+           (unsigned long)c.hz, (unsigned long)c.accel, t.size(), (unsigned long)entries,
+           (unsigned long)pauses, errUs, (unsigned long)shortEntries, primeTicks / 16000.0, primeUs, fillNs);
+  }
+
+  printf("%s\n", bad ? "FAIL" : "OK");
+  return bad ? 1 : 0;
+}
@@ -0,0 +1,142 @@
+// Бенчмарк спектра вибрации (include/vibfft.h) на хосте тем же
+// целочисленным кодом, что на устройстве. Синтетический сигнал
+// акселерометра — несколько синусов на 12-битном АЦП с шумом;
+// сравнение с эталонным БПФ в double (тот же кадр, то же окно),
+// точность найденных пиков и время кадра.
+//
+// 1. Спектр совпадает с эталоном: SNR не меньше 25 дБ, наибольшая ошибка
+//    бина — не больше 2 % наибольшего пика.
+// 2. Найдены все тоны, каждый ровно одним пиком не дальше четверти бина,
+//    наибольший пик — на самом сильном тоне.
+// 3. Кадр на хосте считается быстрее десятой части своего сигнала.
+// Ошибка — FAIL и код 1.
+//
+//   g++ -O2 -Iinclude tools/vib_bench.cpp -o vib_bench
+//   ./vib_bench [fs_hz] [noise_lsb]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <complex>
+#include <chrono>
+
+#include "vibfft.h"
+
+struct Tone {
+  double hz;
+  double amp;    // LSB АЦП
+};
+
+static VibFft g_f;
+
+static double gauss() {
+  double u = (rand() + 1.0) / (RAND_MAX + 2.0), v = (rand() + 1.0) / (RAND_MAX + 2.0);
+  return sqrt(-2 * log(u)) * cos(2 * M_PI * v);
+}
+
+// Эталон: прямое ДПФ в double того же кадра, нормировка 1/N как у vibFft.
+static void reference(const uint16_t* x, double* mag) {
+  double dc = 0;
+  for (int i = 0; i < VIB_N; i++) dc += x[i];
+  dc = floor(dc / VIB_N);
+  std::complex<double> w[VIB_N];
+  for (int i = 0; i < VIB_N; i++) {
+    double win = 0.5 - 0.5 * cos(2 * M_PI * i / VIB_N);
+    w[i] = (x[i] - dc) * 16.0 * win;
+  }
+  for (int k = 0; k < VIB_N / 2; k++) {
+    std::complex<double> s = 0;
+    for (int i = 0; i < VIB_N; i++) s += w[i] * std::polar(1.0, -2 * M_PI * (double)k * i / VIB_N);
+    mag[k] = std::abs(s) / VIB_N;
+  }
+}
+
+int main(int argc, char** argv) {
+  uint32_t fs = argc > 1 ? (uint32_t)atoi(argv[1]) : 20000;
+  double noise = argc > 2 ? atof(argv[2]) : 3.0;
+  srand(1);
+
+  // шаги 2400 Гц при 1/16: полный шаг 150 Гц, его гармоника, резонанс рамы, подшипник
+  const double stepHz = 2400;
+  Tone tones[] = {{150, 60}, {300, 25}, {412.5, 120}, {1873, 15}};
+  const int NT = sizeof(tones) / sizeof(tones[0]);
+
+  static uint16_t x[VIB_N];
+  for (int i = 0; i < VIB_N; i++) {
+    double v = 2048 + noise * gauss();
+    for (int t = 0; t < NT; t++) v += tones[t].amp * sin(2 * M_PI * tones[t].hz * i / fs + t);
+    long q = lrint(v);
+    x[i] = (uint16_t)(q < 0 ? 0 : q > 4095 ? 4095 : q);
+  }
+
+  vibInit(g_f);
+  vibLoad(g_f, x);
+  vibFft(g_f);
+  vibMag(g_f);
+  VibPeak pk[VIB_PEAKS];
+  uint8_t n = vibPeaks(g_f, fs, pk);
+
+  static double ref[VIB_N / 2];
+  reference(x, ref);
+  double sig = 0, err = 0, maxErr = 0;
+  for (int k = 1; k < VIB_N / 2; k++) {
+    double e = g_f.mag[k] - ref[k];
+    sig += ref[k] * ref[k];
+    err += e * e;
+    if (fabs(e) > maxErr) maxErr = fabs(e);
+  }
+
+  int bad = 0;
+  double refPeak = 0;
+  for (int k = 1; k < VIB_N / 2; k++) if (ref[k] > refPeak) refPeak = ref[k];
+  double snr = 10 * log10(sig / (err > 0 ? err : 1e-12));
+  bool specOk = snr >= 25 && maxErr <= 0.02 * refPeak;
+  printf("fs %u Hz, N %d, bin %.2f Hz, noise %.1f LSB\n", fs, VIB_N, (double)fs / VIB_N, noise);
+  printf("vs double DFT: SNR %.1f dB (>= 25), max |err| %.1f (<= 2%% of peak %.0f) %s\n",
+         snr, maxErr, refPeak, specOk ? "ok" : "FAIL");
+  if (!specOk) bad++;
+
+  double bin = (double)fs / VIB_N;
+  int hits[NT] = {};
+  int strongest = 0;
+  for (int t = 1; t < NT; t++) if (tones[t].amp > tones[strongest].amp) strongest = t;
+  printf("%-10s %10s %8s %10s %10s\n", "peak", "hz", "amp", "ratio", "true_err");
+  for (uint8_t i = 0; i < n; i++) {
+    double hz = pk[i].mhz / 1000.0;
+    double best = 1e9;
+    int bt = 0;
+    for (int t = 0; t < NT; t++) {
+      if (fabs(tones[t].hz - hz) < fabs(best)) {
+        best = hz - tones[t].hz;
+        bt = t;
+      }
+    }
+    bool ok = fabs(best) <= bin / 4 && (i || bt == strongest);
+    if (ok) hits[bt]++;
+    else bad++;
+    printf("%-10u %10.2f %8u %10.4f %+10.2f %s\n", i, hz, pk[i].amp, hz / stepHz, best, ok ? "ok" : "FAIL");
+  }
+  for (int t = 0; t < NT; t++) {
+    if (hits[t] == 1) continue;
+    printf("tone %.1f Hz: %d peaks FAIL\n", tones[t].hz, hits[t]);
+    bad++;
+  }
+
+  // время кадра: загрузка + БПФ + модуль + пики
+  const int R = 20000;
+  auto t0 = std::chrono::steady_clock::now();
+  for (int r = 0; r < R; r++) {
+    vibLoad(g_f, x);
+    vibFft(g_f);
+    vibMag(g_f);
+    n = vibPeaks(g_f, fs, pk);
+  }
+  double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count() / R;
+  double frameUs = 1e6 * VIB_N / fs;
+  bool fast = us < frameUs / 10;
+  printf("frame: %.1f us host (%.1f ms of signal per frame) %s\n", us, frameUs / 1000, fast ? "ok" : "FAIL");
+  if (!fast) bad++;
+
+  printf("%s\n", bad ? "FAIL" : "OK");
+  return bad ? 1 : 0;
+}